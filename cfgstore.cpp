@@ -0,0 +1,252 @@
+#include "cfgstore.h"
+#include <nvs.h>
+#include "config.h"
+#include "logx.h"
+
+// Tipo NVS de cada clave (el que usaba Preferences: putInt/putLong -> i32,
+// putUShort -> u16, putUChar -> u8, putFloat -> blob de 4 bytes)
+enum CfgType : uint8_t { T_I32, T_U16, T_U8, T_F32, T_BLOB };
+
+struct CfgDef {
+  const char* ns;
+  const char* key;
+  const char* name;
+  CfgType     type;
+};
+
+static const CfgDef DEFS[CFG_KEY_COUNT] = {
+  { "motor",  "velBase",     "motor/velBase",     T_I32 },
+  { "light",  "max",         "light/max",         T_U16 },
+  { "garage", "limitA",      "garage/limitA",     T_F32 },
+  { "garage", "vZero",       "garage/vZero",      T_F32 },
+  { "hall",   "last_end",    "hall/last_end",     T_U8  },
+  { "hall",   "open_pulses", "hall/open_pulses",  T_I32 },
+  { "hall",   "res",         "hall/res",          T_U8  },
+  { "params", "blob",        "params/blob",       T_BLOB },
+  { "wifi",   "cache",       "wifi/cache",        T_BLOB },
+  { "ienv",   "env",         "ienv/env",          T_BLOB },
+  { "garage", "adcLut",      "garage/adcLut",     T_BLOB },
+};
+
+union CfgVal {
+  int32_t i;
+  float   f;
+};
+
+struct CfgEntry {
+  CfgVal      val;
+  const void* blob;      // solo T_BLOB
+  size_t      blobLen;
+  bool     has;
+  bool     dirty;
+  uint32_t writes;
+};
+
+static CfgEntry entries[CFG_KEY_COUNT];
+static portMUX_TYPE cfgMux = portMUX_INITIALIZER_UNLOCKED;
+static bool     anyDirty    = false;
+static uint32_t tFirstDirty = 0;
+static uint32_t tLastChange = 0;
+static uint32_t flushes     = 0;
+
+// ---------------- Carga ----------------
+
+static bool nvs_read(nvs_handle_t h, const CfgDef& d, CfgVal& out) {
+  switch (d.type) {
+    case T_I32: { int32_t v;  if (nvs_get_i32(h, d.key, &v) != ESP_OK) return false; out.i = v; } break;
+    case T_U16: { uint16_t v; if (nvs_get_u16(h, d.key, &v) != ESP_OK) return false; out.i = v; } break;
+    case T_U8:  { uint8_t v;  if (nvs_get_u8(h, d.key, &v)  != ESP_OK) return false; out.i = v; } break;
+    case T_F32: {
+      float v; size_t len = sizeof(v);
+      if (nvs_get_blob(h, d.key, &v, &len) != ESP_OK || len != sizeof(v)) return false;
+      out.f = v;
+    } break;
+    case T_BLOB: {
+      size_t len = 0;   // solo comprobar que existe; se lee con cfg_get_blob()
+      return nvs_get_blob(h, d.key, nullptr, &len) == ESP_OK;
+    }
+  }
+  return true;
+}
+
+static esp_err_t nvs_write(nvs_handle_t h, const CfgDef& d, const CfgVal& v, const CfgEntry& e) {
+  switch (d.type) {
+    case T_I32: return nvs_set_i32(h, d.key, v.i);
+    case T_U16: return nvs_set_u16(h, d.key, (uint16_t)v.i);
+    case T_U8:  return nvs_set_u8(h, d.key, (uint8_t)v.i);
+    case T_F32: return nvs_set_blob(h, d.key, &v.f, sizeof(v.f));
+    case T_BLOB: return e.blob ? nvs_set_blob(h, d.key, e.blob, e.blobLen) : ESP_FAIL;
+  }
+  return ESP_FAIL;
+}
+
+void cfg_begin() {
+  memset(entries, 0, sizeof(entries));
+  for (int k = 0; k < CFG_KEY_COUNT; ++k) {
+    if (entries[k].has) continue;
+    nvs_handle_t h;
+    if (nvs_open(DEFS[k].ns, NVS_READONLY, &h) != ESP_OK) continue;   // namespace aún no existe
+    // Todas las claves del mismo namespace con una sola apertura
+    for (int j = k; j < CFG_KEY_COUNT; ++j) {
+      if (strcmp(DEFS[j].ns, DEFS[k].ns) != 0) continue;
+      entries[j].has = nvs_read(h, DEFS[j], entries[j].val);
+    }
+    nvs_close(h);
+  }
+}
+
+// ---------------- Acceso ----------------
+
+bool cfg_has(CfgKey k) {
+  return entries[k].has;
+}
+
+int32_t cfg_get_i(CfgKey k, int32_t def) {
+  portENTER_CRITICAL(&cfgMux);
+  int32_t v = entries[k].has ? entries[k].val.i : def;
+  portEXIT_CRITICAL(&cfgMux);
+  return v;
+}
+
+float cfg_get_f(CfgKey k, float def) {
+  portENTER_CRITICAL(&cfgMux);
+  float v = entries[k].has ? entries[k].val.f : def;
+  portEXIT_CRITICAL(&cfgMux);
+  return v;
+}
+
+static void mark_dirty(CfgEntry& e) {
+  uint32_t now = millis();
+  e.has = true;
+  e.dirty = true;
+  if (!anyDirty) tFirstDirty = now;
+  anyDirty = true;
+  tLastChange = now;
+}
+
+void cfg_set_i(CfgKey k, int32_t v) {
+  portENTER_CRITICAL(&cfgMux);
+  CfgEntry& e = entries[k];
+  if (!e.has || e.val.i != v) {
+    e.val.i = v;
+    mark_dirty(e);
+  }
+  portEXIT_CRITICAL(&cfgMux);
+}
+
+void cfg_set_f(CfgKey k, float v) {
+  portENTER_CRITICAL(&cfgMux);
+  CfgEntry& e = entries[k];
+  if (!e.has || e.val.f != v) {
+    e.val.f = v;
+    mark_dirty(e);
+  }
+  portEXIT_CRITICAL(&cfgMux);
+}
+
+size_t cfg_get_blob(CfgKey k, void* out, size_t cap) {
+  nvs_handle_t h;
+  if (DEFS[k].type != T_BLOB || nvs_open(DEFS[k].ns, NVS_READONLY, &h) != ESP_OK) return 0;
+  size_t len = cap;
+  esp_err_t err = nvs_get_blob(h, DEFS[k].key, out, &len);
+  nvs_close(h);
+  return (err == ESP_OK) ? len : 0;
+}
+
+size_t cfg_get_blob_len(CfgKey k) {
+  nvs_handle_t h;
+  if (DEFS[k].type != T_BLOB || nvs_open(DEFS[k].ns, NVS_READONLY, &h) != ESP_OK) return 0;
+  size_t len = 0;
+  esp_err_t err = nvs_get_blob(h, DEFS[k].key, nullptr, &len);
+  nvs_close(h);
+  return (err == ESP_OK) ? len : 0;
+}
+
+void cfg_set_blob(CfgKey k, const void* buf, size_t len) {
+  portENTER_CRITICAL(&cfgMux);
+  CfgEntry& e = entries[k];
+  e.blob = buf;
+  e.blobLen = len;
+  mark_dirty(e);
+  portEXIT_CRITICAL(&cfgMux);
+}
+
+// ---------------- Escritura diferida ----------------
+
+static void flush() {
+  CfgVal snap[CFG_KEY_COUNT];
+  bool   todo[CFG_KEY_COUNT];
+
+  portENTER_CRITICAL(&cfgMux);
+  for (int k = 0; k < CFG_KEY_COUNT; ++k) {
+    todo[k] = entries[k].dirty;
+    snap[k] = entries[k].val;
+    entries[k].dirty = false;
+  }
+  anyDirty = false;
+  portEXIT_CRITICAL(&cfgMux);
+
+  bool failed = false;
+  for (int k = 0; k < CFG_KEY_COUNT; ++k) {
+    if (!todo[k]) continue;
+    const char* ns = DEFS[k].ns;
+    nvs_handle_t h;
+    bool ok = (nvs_open(ns, NVS_READWRITE, &h) == ESP_OK);
+    bool wrote[CFG_KEY_COUNT] = {};
+
+    // Todas las claves sucias del namespace y un único commit
+    for (int j = k; ok && j < CFG_KEY_COUNT; ++j) {
+      if (!todo[j] || strcmp(DEFS[j].ns, ns) != 0) continue;
+      wrote[j] = (nvs_write(h, DEFS[j], snap[j], entries[j]) == ESP_OK);
+    }
+    if (ok) {
+      ok = (nvs_commit(h) == ESP_OK);
+      nvs_close(h);
+    }
+
+    portENTER_CRITICAL(&cfgMux);
+    for (int j = k; j < CFG_KEY_COUNT; ++j) {
+      if (!todo[j] || strcmp(DEFS[j].ns, ns) != 0) continue;
+      todo[j] = false;
+      if (ok && wrote[j]) {
+        entries[j].writes++;
+      } else if (!entries[j].dirty) {
+        entries[j].dirty = true;    // reintentar en la próxima ventana
+        if (!anyDirty) tFirstDirty = millis();
+        anyDirty = true;
+        failed = true;
+      }
+    }
+    portEXIT_CRITICAL(&cfgMux);
+  }
+
+  flushes++;
+  if (failed) LOGW("[CFG] Error escribiendo NVS; se reintentará\n");
+}
+
+void cfg_tick(uint32_t nowMs) {
+  if (!anyDirty) return;
+  // Con signo: un set desde otra tarea puede ser algo posterior a nowMs
+  if ((int32_t)(nowMs - tLastChange) >= (int32_t)CFG_FLUSH_QUIET_MS ||
+      (int32_t)(nowMs - tFirstDirty) >= (int32_t)CFG_FLUSH_MAX_MS) {
+    flush();
+  }
+}
+
+void cfg_flush_now() {
+  if (anyDirty) flush();
+}
+
+// ---------------- Telemetría ----------------
+
+const char* cfg_key_name(CfgKey k) {
+  return DEFS[k].name;
+}
+
+uint32_t cfg_write_count(CfgKey k) {
+  return entries[k].writes;
+}
+
+uint32_t cfg_flush_count() {
+  return flushes;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+
+// =====================================================
+//     Almacén de configuración persistente (write-back)
+// =====================================================
+// Copia en RAM de las claves NVS de la aplicación. Ningún otro módulo abre
+// NVS: todas las escrituras salen de aquí, desde la tarea de red, y nunca
+// desde el lazo de control. Los set solo tocan RAM y marcan la clave como
+// sucia; cfg_tick() las escribe juntas (un commit por namespace) cuando
+// lleva CFG_FLUSH_QUIET_MS sin cambios, o como mucho a los CFG_FLUSH_MAX_MS
+// del primer cambio pendiente. Antes de reiniciar u OTA se
+// llama a cfg_flush_now(). Se mantienen los namespaces, claves y tipos NVS de
+// siempre, así que lo ya guardado se sigue leyendo.
+
+enum CfgKey : uint8_t {
+  CFG_MOTOR_VEL_BASE = 0,   // motor/velBase      (int, 0..100)
+  CFG_LIGHT_MAX,            // light/max          (u16)
+  CFG_LIMIT_A,              // garage/limitA      (float, A)
+  CFG_VZERO,                // garage/vZero       (float, V)
+  CFG_HALL_LAST_END,        // hall/last_end      (u8)
+  CFG_HALL_OPEN_PULSES,     // hall/open_pulses   (long)
+  CFG_HALL_RES,             // hall/res           (u8)
+  CFG_PARAMS,               // params/blob        (blob del registro de parámetros)
+  CFG_WIFI_CACHE,           // wifi/cache         (blob: BSSID, canal e IP de la última conexión)
+  CFG_IENV_ENV,             // ienv/env           (blob: envolvente de corriente aprendida)
+  CFG_ADC_LUT,              // garage/adcLut      (blob: tabla ADC por placa, LUT_POINTS µV)
+  CFG_KEY_COUNT
+};
+
+// Carga todas las claves (llamar al principio de setup, antes de los *_begin)
+void cfg_begin();
+
+bool    cfg_has(CfgKey k);                  // existe en NVS o se ha asignado
+int32_t cfg_get_i(CfgKey k, int32_t def);
+float   cfg_get_f(CfgKey k, float def);
+void    cfg_set_i(CfgKey k, int32_t v);     // solo RAM; sucia si cambia
+void    cfg_set_f(CfgKey k, float v);
+
+// Claves blob: el buffer es del módulo dueño y debe seguir vivo. Se lee de
+// NVS en el momento (arranque); cfg_set_blob() lo marca para escribirlo.
+size_t  cfg_get_blob(CfgKey k, void* out, size_t cap);    // bytes leídos (0 si no hay o no cabe)
+size_t  cfg_get_blob_len(CfgKey k);                       // tamaño guardado (0 si no hay)
+void    cfg_set_blob(CfgKey k, const void* buf, size_t len);
+
+// Escritura diferida (tarea de red)
+void cfg_tick(uint32_t nowMs);
+void cfg_flush_now();
+
+// Telemetría
+const char* cfg_key_name(CfgKey k);         // "ns/clave"
+uint32_t    cfg_write_count(CfgKey k);      // escrituras en flash desde el arranque
+uint32_t    cfg_flush_count();              // commits coalescidos
@@ -7,6 +7,81 @@
 #define INTERVALO_ESTADO_MS      0        // demo de rotación de estados (0 = desactivado)
 #define BOOT_OTA_MINUTES         5        // ventana OTA al arrancar (min). 0 = desactivada
 
+// Display MAX7219 por SPI hardware (VSPI: DIN = GPIO23, CLK = GPIO18)
+#define DISPLAY_HW_TYPE          MD_MAX72XX::FC16_HW
+#define DISPLAY_MAX_DEVICES      1        // módulos 8x8 encadenados
+#define DISPLAY_CS_PIN           5
+
+// =====================================================
+//                 TAREAS (FreeRTOS)
+// =====================================================
+// Control en tiempo real (motor, corriente, safety, hall, botón) en un núcleo;
+// red/UI (Wi-Fi, MQTT, display, luz, OTA) en el otro.
+#define CONTROL_PERIOD_MS        5        // periodo fijo de la tarea de control
+#define CONTROL_TASK_CORE        1
+#define CONTROL_TASK_PRIO        (configMAX_PRIORITIES - 2)
+#define CONTROL_TASK_STACK       4096
+#define NET_TASK_CORE            0
+#define NET_TASK_PRIO            2
+#define NET_TASK_STACK           8192
+#define NET_TASK_DELAY_MS        2        // periodo de los trabajos de red/UI
+
+// Planificador por plazos (sched.h): rueda de tramos de 1 ms por tarea
+#define SCHED_WHEEL_SLOTS        256      // potencia de 2
+#define SCHED_NET_MAX_SLEEP_MS   50       // la tarea de red duerme hasta el próximo plazo (tope)
+#define SCHED_PUBLISH_MS         60000    // estadísticas (overruns/retrasos) por MQTT
+
+// Perfilado por subsistema (prof.h): histogramas de tiempos de cada paso
+#define PROF_ENABLED             1
+#define PROF_PUBLISH_MS          10000    // publica y reinicia la ventana
+#define MQTT_BUFFER_BYTES        512      // buffer del cliente MQTT (cabe TOPIC_PROF)
+
+// Wi-Fi: primero un intento dirigido al BSSID/canal de la última conexión
+// (sin escaneo); si falla, conexión normal con backoff acotado y jitter
+#define WIFI_FAST_TIMEOUT_MS     3000     // intento dirigido
+#define WIFI_SCAN_TIMEOUT_MS     10000    // intento con escaneo completo
+#define WIFI_BACKOFF_MIN_MS      500      // espera entre intentos (antes del jitter)
+#define WIFI_BACKOFF_MAX_MS      8000     // tope de la espera
+#define WIFI_CACHE_STATIC_IP     0        // 1 = el intento dirigido reutiliza la última IP (sin DHCP)
+
+// Cliente MQTT asíncrono (esp-mqtt, tarea propia)
+#define MQTT_RECONNECT_MS        5000     // espera entre reintentos de conexión
+#define MQTT_NETWORK_TIMEOUT_MS  5000     // DNS/TCP/CONNACK (no bloquea la tarea de red)
+#define MQTT_OUTBOX_BYTES        8192     // salidas pendientes de escribir en el socket
+#define MQTT_IN_MAX              256      // payload máximo de un mensaje entrante
+#define MQTT_IN_QUEUE            8        // mensajes entrantes en cola (potencia de 2)
+
+// Cola de salida MQTT (pubq.h)
+#define PUBQ_EVENT_BYTES         4096     // eventos encolados (potencia de 2)
+#define PUBQ_EVENT_DEPTH         64       // máximo de eventos en cola
+#define PUBQ_RETAINED_MAX        24       // valor máximo de un topic retenido registrado
+
+// =====================================================
+//                 CONFIGURACIÓN PERSISTENTE (NVS)
+// =====================================================
+// Los cambios se guardan en RAM y se escriben juntos en flash
+#define CFG_FLUSH_QUIET_MS       5000     // escribir tras este tiempo sin cambios
+#define CFG_FLUSH_MAX_MS         60000    // ... o como mucho este tiempo tras el primero
+
+// =====================================================
+//                 LOG
+// =====================================================
+// Niveles: lo que quede por encima de LOG_LEVEL no se compila (LOGD, LOGI...)
+#define LOG_LVL_NONE             0
+#define LOG_LVL_ERROR            1
+#define LOG_LVL_WARN             2
+#define LOG_LVL_INFO             3
+#define LOG_LVL_DEBUG            4
+#define LOG_LEVEL                LOG_LVL_INFO
+
+#define LOG_RING_BYTES           4096     // anillo compartido de líneas (potencia de 2)
+#define LOG_LINE_MAX             200      // longitud máxima de una línea de texto
+#define LOG_STR_MAX              96       // bytes guardados por argumento %s (más: se marca recortado)
+#define LOG_MQTT_BURST           8        // publicaciones de log por pasada de red
+#define LOG_MQTT_BINARY          1        // 1 = lotes binarios en TOPIC_LOG_BIN, 0 = texto
+#define LOG_BIN_BATCH            200      // bytes por lote binario (cabe en el buffer del cliente MQTT)
+#define LOG_SERIAL_TX_BUF        1024     // buffer de TX del UART (escritura sin bloqueo)
+
 // =====================================================
 //                 BOTÓN / ENTRADA RELÉ
 // =====================================================
@@ -30,12 +105,47 @@
 #define MOTOR_RAMP_STEP_PERCENT  1        // cambia 1% por tick
 #define MOTOR_TICK_MS            20       // llama motor_tick() cada 20 ms
 
+// ---------------- Lazo cerrado de velocidad ----------------
+// Con el Hall habilitado, la velocidad (TOPIC_SPEED_CMD, 0..100) es una
+// velocidad objetivo en % de MOTOR_VEL_MAX_CPS y un PI con feed-forward ajusta
+// el duty en cada tick usando la velocidad medida. Sin Hall (o con 0 aquí) se
+// usa la rampa en lazo abierto de siempre.
+#define MOTOR_CLOSED_LOOP        1
+#define MOTOR_VEL_MAX_CPS        1000.0f  // cuentas/s a velocidad 100% (en cuentas del encoder)
+#define MOTOR_VEL_KP             0.8f     // %duty por % de error de velocidad
+#define MOTOR_VEL_KI             4.0f     // %duty por (% de error · s)
+#define MOTOR_VEL_I_MAX          40.0f    // límite del término integral (%duty)
+
+// ---------------- Trayectorias (goto a posición) ----------------
+// Perfil en S con aceleración y jerk limitados (unidades: cuentas del encoder).
+// La velocidad de crucero es la velocidad objetivo actual del motor.
+#define TRAJ_ACC_MAX_CPS2        800.0f   // aceleración máxima (cuentas/s²)
+#define TRAJ_JERK_MAX_CPS3       3000.0f  // jerk máximo (cuentas/s³)
+#define TRAJ_VMIN_CPS            40.0f    // velocidad mínima de aproximación
+#define TRAJ_POS_TOL             4        // tolerancia de llegada (cuentas)
+
 // Tiempo muerto (dead-time) al invertir sentido para proteger el puente H
 #define MOTOR_REVERSE_DEADTIME_MS 80      // ms (60–120 ms recomendado)
 
 // ---------------- Comprobación de sobrecorriente ----------------
 #define CURRENT_CHECK_PERIOD_MS  20       // periodo de chequeo (ms)
 #define CURRENT_BLANKING_MS      300      // ignora durante 300 ms desde que empieza a moverse
+#define CURRENT_REQUIRED_OVER    20       // lecturas seguidas por encima del límite para cortar
+#define ADC_LUT_CAL_MAX          16       // puntos raw:mV como máximo en el comando "adclut"
+
+// Los valores de ajuste (blanking, márgenes, PI, trayectoria, salvaguardas,
+// luz...) son solo los valores por defecto del registro de parámetros
+// (params.h); se cambian en caliente por TOPIC_PARAM_SET.
+
+// ---------------- Envolvente de corriente aprendida ----------------
+// Pico de corriente esperado por tramo de recorrido y sentido, aprendido en
+// ciclos sin incidencias. Complementa al límite global (que sigue activo).
+#define IENV_ENABLED             1
+#define IENV_BUCKETS             32       // tramos por sentido
+#define IENV_MIN_CYCLES          3        // ciclos aprendidos antes de usar un tramo
+#define IENV_MARGIN_MA           1200     // margen absoluto sobre el pico esperado (mA)
+#define IENV_MARGIN_PCT          25       // + margen relativo (% del pico esperado)
+#define IENV_REQUIRED_OVER       3        // muestras seguidas fuera (x CURRENT_CHECK_PERIOD_MS)
 
 // =====================================================
 //                 SENSOR HALL (ENCODER)
@@ -53,6 +163,32 @@
 // Se ajusta tras un ciclo completo y se guarda en NVS; este es el valor inicial
 #define HALL_OPEN_PULSES_DEFAULT 5000
 
+// Backend del encoder:
+// - ISR:  interrupción en cada flanco de subida (lee DIR dentro de la ISR)
+// - PCNT: contador hardware del ESP32 con filtro antiglitch (contar no usa CPU;
+//         ver HALL_PCNT_EDGE_STAMP)
+#define HALL_BACKEND_ISR         0
+#define HALL_BACKEND_PCNT        1
+#define HALL_BACKEND             HALL_BACKEND_PCNT
+
+// Resolución con PCNT (cuentas por pulso):
+// 1 = solo flanco de subida (como la ISR), 2 = ambos flancos,
+// 4 = cuadratura (HALL_DIR_PIN se usa como canal B; HALL_DIR_ACTIVE_HIGH_CLOSE fija el sentido)
+// Al cambiarla, el recorrido guardado en NVS se reescala en el arranque.
+#define HALL_PCNT_MODE           2
+#define HALL_PCNT_GLITCH_NS      1000     // pulsos más cortos se ignoran (máx ~12700 ns)
+// Instante de cada flanco para el estimador de velocidad por periodo: una
+// ISR mínima en los pines que cuenta PCNT solo guarda micros(). Con 0 no hay
+// ISR por pulso, pero los periodos quedan cuantizados al periodo de control
+// (±5 ms: ~10 % de error a 20 cuentas/s).
+#define HALL_PCNT_EDGE_STAMP     1
+
+#if HALL_BACKEND == HALL_BACKEND_PCNT
+#define HALL_COUNTS_PER_PULSE    HALL_PCNT_MODE
+#else
+#define HALL_COUNTS_PER_PULSE    1
+#endif
+
 // % del recorrido donde el motor debe ir en modo "lento"
 #define HALL_SLOWDOWN_THRESHOLD_PERCENT 20
 
@@ -72,9 +208,10 @@
 // =====================================================
 //                 MQTT - TÓPICOS GENERALES
 // =====================================================
-#define TOPIC_CMD                 "garage/door/cmd"          // "ota on", "ota off", "status", "reboot"
+#define TOPIC_CMD                 "garage/door/cmd"          // "ota on", "ota off", "status", "reboot", "adclut raw:mV ..."
 #define TOPIC_OPEN_CMD            "garage/door/open/cmd"     // abrir mientras ON
 #define TOPIC_CLOSE_CMD           "garage/door/close/cmd"    // cerrar mientras ON
+#define TOPIC_GOTO_CMD            "garage/door/goto/cmd"     // ir a posición: 0..100 (% del recorrido)
 
 // Programación de finales
 #define TOPIC_MARK_CLOSED_CMD     "garage/door/mark_closed/cmd" // marcar posición actual como CERRADO (0)
@@ -82,9 +219,23 @@
 
 // Información desde el ESP32
 #define TOPIC_STATE               "garage/door/state"        // "ABRIENDO"/"CERRANDO"/"DETENIDO" (retained)
-#define TOPIC_LOG                 "garage/door/log"          // logs
+#define TOPIC_LOG                 "garage/door/log"          // logs (texto)
+#define TOPIC_LOG_BIN             "garage/door/log/bin"      // logs en lotes binarios (tools/logdecode.py)
 #define TOPIC_INFO                "garage/door/info"         // info de red/estado (JSON)
 #define TOPIC_OTA                 "garage/door/ota"          // estado OTA (retained "ON"/"OFF")
+#define TOPIC_CTL_TIMING          "garage/sys/ctl"           // jitter de la tarea de control (JSON)
+#define TOPIC_PROF                "garage/sys/prof"          // {"slot":[n,min,avg,p99,max] µs,...}
+#define TOPIC_SCHED               "garage/sys/sched"         // {"jobs","overruns","late_max","job":[runs,overruns,late_max]}
+#define TOPIC_HEAP                "garage/sys/heap"          // reservas de heap y estado (JSON)
+#define TOPIC_LOG_STATS           "garage/sys/log"           // descartes del log por salida (JSON)
+#define TOPIC_NVS_STATS           "garage/sys/nvs"           // escrituras en flash por clave (JSON)
+#define TOPIC_NET_STATS           "garage/sys/net"           // peor net_tick() (µs), reconexiones Wi-Fi y eventos MQTT (JSON)
+#define TOPIC_PUBQ_STATS          "garage/sys/pubq"          // cola de salida MQTT: enviados, dedup, descartes (JSON)
+
+// Registro de parámetros (params.h)
+#define TOPIC_PARAM_GET           "garage/param/get"         // "", "all", "meta" o nombres/prefijos
+#define TOPIC_PARAM_SET           "garage/param/set"         // "a=1 b=2" o {"a":1,"b":2}; "defaults"
+#define TOPIC_PARAM               "garage/param"             // respuesta (JSON, en trozos)
 
 // =====================================================
 //                 MQTT - CORRIENTE (ACS712)
@@ -92,6 +243,7 @@
 #define TOPIC_ILIMIT              "garage/current/limit"       // estado (retained): valor actual del límite (A)
 #define TOPIC_ILIMIT_CMD          "garage/current/limit/cmd"   // comando: dashboard publica nuevo valor
 #define TOPIC_IMEAS               "garage/current/value"       // medida en tiempo real (A)
+#define TOPIC_IOFFSET             "garage/current/offset"      // offset del sensor y deriva (JSON)
 
 // =====================================================
 //                 MQTT - VELOCIDAD MOTOR
@@ -104,6 +256,17 @@
 // =====================================================
 #define TOPIC_ENC_POS             "garage/encoder/pos"       // posición (no retained)
 #define TOPIC_ENC_DIR             "garage/encoder/dir"       // "1" abrir, "-1" cerrar
+#define TOPIC_ENC_VEL             "garage/encoder/vel"       // velocidad (cuentas/s, + abrir)
+
+// =====================================================
+//                 MQTT - TELEMETRÍA BINARIA (telem.h)
+// =====================================================
+#define TOPIC_TELEM               "garage/telem/bin"         // lotes de tramas (tools/telemdecode.py)
+#define TELEM_MOVE_MS             20       // 50 Hz en movimiento
+#define TELEM_IDLE_MS             5000     // una trama cada 5 s en reposo
+#define TELEM_BATCH_FRAMES        5        // tramas por publicación (≤ 100 ms de retardo)
+#define TELEM_HEARTBEAT_MS        60000    // señales de texto: latido aunque no cambien
+#define TOPIC_TELEM_STATS         "garage/sys/telem"         // publicaciones por señal en la ventana (JSON)
 
 // =====================================================
 //                 MQTT - HALL SENSOR
@@ -129,6 +292,7 @@
 #define LIGHT_PWM_FREQ_HZ         1000
 #define LIGHT_PWM_RES_BITS        10
 #define LIGHT_DEFAULT_LEVEL       1023    // para 10 bits, 1023 = max
+#define LIGHT_GAMMA_ENABLED       1       // nivel perceptual (gamma 2.2) → duty
 #define LIGHT_AUTO_OFF_MS         (2UL * 60UL * 1000UL)  // 2 minutos
 
 // ---------------- MQTT - LUCES ----------------
@@ -1,8 +1,15 @@
 #include <Arduino.h>
-#include <Preferences.h>
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
 #include "current.h"
 #include "state.h"
 #include "motor.h"
+#include "hall.h"
+#include "ienv.h"
+#include "logx.h"
+#include "cfgstore.h"
+#include "params.h"
+#include "tasks.h"
 
 const int PIN_ACS = 34;
 
@@ -15,85 +22,374 @@ const float SENS_V_PER_A = 0.100;
 
 // Límite por defecto si no hay nada guardado
 static float LIMIT_A = 8.0;
+static int32_t limitMa = 8000;    // copia entera del límite para la guardia
 static uint8_t overCount = 0;     // cuántas veces seguidas superó el límite
-static const uint8_t REQUIRED_OVER = 20;  // cuántas lecturas consecutivas  
 
-static float vZero = 0.0;
-static Preferences prefs;   // instancia de NVS
+static const int32_t ZERO_UV_NOMINAL = 2500000;  // offset nominal del ACS712 (Vcc/2)
+static int32_t zeroUv = ZERO_UV_NOMINAL;         // offset en µV a la salida del sensor
 
-static unsigned long lastRecalMs = 0;
-static const unsigned long RECAL_INTERVAL_MS = 6UL * 60UL * 60UL * 1000UL;  // 6 horas
-static const unsigned long MIN_IDLE_FOR_RECAL_MS = 60UL * 1000UL;           // 1 minuto detenido
+// ---------------- Conversión entera raw → µV → mA ----------------
+// Tabla raw→µV (salida del sensor, ya con el divisor) de 257 puntos, uno cada
+// 16 cuentas, construida al arrancar desde una tabla por placa en NVS o desde
+// la caracterización eFuse del ADC. En caliente solo hay aritmética entera:
+// interpolación lineal, resta del offset y escala Q24 a mA.
+static const uint8_t LUT_SHIFT  = 4;                        // 16 cuentas por tramo
+static const size_t  LUT_POINTS = (4096 >> LUT_SHIFT) + 1;  // 257
+static int32_t  lutUv[LUT_POINTS];
+static int32_t  maPerUvQ24 = 0;          // mA por µV en Q24 (depende de SENS_V_PER_A)
+static const char* lutSource = "lineal";
+static int32_t  lutStage[LUT_POINTS];    // tabla nueva de current_lut_from_points()
+static volatile bool lutStaged = false;  // red la llena; control la copia y la baja
 
-static void calibrate_offset() {
-  const int N = 200;
-  uint32_t acc = 0;
-  for (int i = 0; i < N; ++i) {
-    acc += analogRead(PIN_ACS);
-    delay(2);
+// ---------------- Calibración incremental del offset ----------------
+// Con la puerta DETENIDA (y tras un margen para que el motor deje de girar)
+// cada trama alimenta un bloque; al completar un bloque estable su media
+// corrige el offset con un filtro lento. Nunca bloquea el loop.
+static const unsigned long IDLE_SETTLE_MS     = 2000;  // espera tras parar antes de muestrear
+static const uint16_t      OFFSET_BLOCK_FRAMES = 200;  // tramas por bloque (~1 s)
+static const uint16_t      OFFSET_MAX_SPREAD   = 40;   // raw máx-mín admitido en un bloque
+static const uint8_t       OFFSET_EMA_SHIFT    = 3;      // alfa = 1/8 por bloque
+static const int32_t       OFFSET_SAVE_DELTA_UV = 5000;  // 5 mV
+static const unsigned long OFFSET_SAVE_MIN_MS  = 10UL * 60UL * 1000UL;  // 10 min entre escrituras
+
+static bool     offsetIdle    = false;   // alimentar el estimador con las tramas
+static bool     offsetValid   = false;   // el offset viene de NVS o de un bloque medido
+static uint32_t blkAcc = 0;
+static uint16_t blkN = 0, blkMin = 0xFFFF, blkMax = 0;
+static int32_t  zeroUvBoot    = ZERO_UV_NOMINAL;  // referencia para la deriva
+static int32_t  zeroUvSaved   = 0;
+static unsigned long tLastOffsetSave = 0;
+static bool     offsetSaveOnce = false;
+
+// ---------------- Adquisición continua (ADC1 + DMA) ----------------
+// El ADC convierte en segundo plano a ritmo fijo; cada trama DMA se promedia
+// (lo hace el core) y se guarda en un anillo. Los consumidores (guardia,
+// safety, telemetría) leen el valor filtrado o la estadística de la ventana
+// sin tocar el ADC.
+static const uint32_t ACQ_SAMPLE_HZ      = 20000; // conversiones/s (mínimo del ESP32)
+static const uint32_t ACQ_CONV_PER_FRAME = 100;   // conversiones por trama → 200 tramas/s (5 ms)
+static const uint32_t ACQ_FRAME_MS       = (ACQ_CONV_PER_FRAME * 1000UL) / ACQ_SAMPLE_HZ;
+static const size_t   RING_LEN           = 32;    // tramas en la ventana (~160 ms)
+static const uint8_t  EMA_SHIFT          = 2;     // filtro exponencial alfa = 1/4 por trama
+
+static uint16_t ring[RING_LEN];        // raw promediado (0..ADC_MAX) por trama
+static size_t   ringHead  = 0;
+static size_t   ringCount = 0;
+static uint32_t emaRawQ8  = 0;         // raw filtrado en Q8
+static int32_t  latestMa  = 0;         // mA filtrados (cacheado)
+static uint32_t tLastFrameMs = 0;
+static bool     acqRunning = false;
+static volatile uint32_t framesReady = 0;   // tramas completadas por el DMA (ISR)
+static portMUX_TYPE acqMux = portMUX_INITIALIZER_UNLOCKED;
+
+ARDUINO_ISR_ATTR static void isr_frame_done() {
+  portENTER_CRITICAL_ISR(&acqMux);
+  framesReady++;
+  portEXIT_CRITICAL_ISR(&acqMux);
+}
+
+// Toma y pone a cero el contador de tramas de una vez: una trama que el ISR
+// cuente entre la lectura y la puesta a cero no se pierde
+static uint32_t acq_take_ready() {
+  portENTER_CRITICAL(&acqMux);
+  uint32_t n = framesReady;
+  framesReady = 0;
+  portEXIT_CRITICAL(&acqMux);
+  return n;
+}
+
+// Fuente de tramas: ADC continuo del core 3.x. Para sustituirla (p.ej. una
+// fuente simulada) basta con reimplementar acq_start()/acq_read_frame().
+static bool acq_start() {
+  const uint8_t pins[] = { (uint8_t)PIN_ACS };
+  analogContinuousSetWidth(12);
+  analogContinuousSetAtten(ADC_11db);
+  if (!analogContinuous(pins, 1, ACQ_CONV_PER_FRAME, ACQ_SAMPLE_HZ, isr_frame_done)) return false;
+  return analogContinuousStart();
+}
+
+// Una trama del pool DMA, la más antigua pendiente; false si está vacío
+static bool acq_read_frame(uint16_t& raw) {
+  adc_continuous_data_t* res = nullptr;
+  if (!analogContinuousRead(&res, 0) || res == nullptr) return false;
+  raw = (uint16_t)res[0].avg_read_raw;
+  return true;
+}
+
+static void lut_build() {
+  // mA = µV / (SENS_V_PER_A · 1000 µV/mA)
+  maPerUvQ24 = (int32_t)((float)(1UL << 24) / (SENS_V_PER_A * 1000.0f) + 0.5f);
+
+  // 1) Tabla por placa (medida con referencia externa, comando "adclut")
+  if (cfg_get_blob(CFG_ADC_LUT, lutUv, sizeof(lutUv)) == sizeof(lutUv)) {
+    bool mono = true;
+    for (size_t i = 1; i < LUT_POINTS && mono; ++i) mono = lutUv[i] >= lutUv[i - 1];
+    if (mono) {
+      lutSource = "nvs";
+      return;
+    }
+    LOGW("[CURRENT] Tabla ADC de NVS no creciente; se ignora\n");
+  }
+  lutSource = "lineal";
+
+  // 2) Caracterización de fábrica (eFuse) del ADC1 con la atenuación en uso
+  adc_cali_handle_t cali = nullptr;
+  bool ok = false;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+  adc_cali_curve_fitting_config_t cfg = {};
+  cfg.unit_id  = ADC_UNIT_1;
+  cfg.atten    = (adc_atten_t)ADC_11db;
+  cfg.bitwidth = ADC_BITWIDTH_12;
+  ok = (adc_cali_create_scheme_curve_fitting(&cfg, &cali) == ESP_OK);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+  adc_cali_line_fitting_config_t cfg = {};
+  cfg.unit_id  = ADC_UNIT_1;
+  cfg.atten    = (adc_atten_t)ADC_11db;
+  cfg.bitwidth = ADC_BITWIDTH_12;
+#if CONFIG_IDF_TARGET_ESP32
+  cfg.default_vref = 1100;
+#endif
+  ok = (adc_cali_create_scheme_line_fitting(&cfg, &cali) == ESP_OK);
+#endif
+
+  for (size_t i = 0; i < LUT_POINTS; ++i) {
+    int raw = (int)(i << LUT_SHIFT);
+    if (raw > ADC_MAX) raw = ADC_MAX;
+    float mV;
+    int calMv = 0;
+    if (ok && adc_cali_raw_to_voltage(cali, raw, &calMv) == ESP_OK) mV = (float)calMv;
+    else mV = (raw / (float)ADC_MAX) * VREF * 1000.0f;   // 3) modelo lineal nominal
+    lutUv[i] = (int32_t)(mV * 1000.0f * DIVIDER_GAIN + 0.5f);
+  }
+
+  if (ok) {
+    lutSource = "efuse";
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_curve_fitting(cali);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_line_fitting(cali);
+#endif
   }
-  float adcMean = acc / float(N);
-  float vAdc = (adcMean / ADC_MAX) * VREF;
-  vZero = vAdc * DIVIDER_GAIN;
-  Serial.printf("[CURRENT] Offset vZero=%.3f V\n", vZero);
+}
+
+// raw en Q8 (p.ej. salida del filtro) → µV a la salida del sensor
+static inline int32_t rawQ8ToUv(uint32_t rawQ8) {
+  uint32_t idx  = rawQ8 >> (8 + LUT_SHIFT);
+  if (idx >= LUT_POINTS - 1) return lutUv[LUT_POINTS - 1];
+  uint32_t frac = rawQ8 & ((1UL << (8 + LUT_SHIFT)) - 1);
+  int32_t a = lutUv[idx], b = lutUv[idx + 1];
+  return a + (int32_t)(((int64_t)(b - a) * frac) >> (8 + LUT_SHIFT));
+}
+
+static inline int32_t uvToMa(int32_t uv) {
+  int32_t d = uv - zeroUv;
+  if (d < 0) d = -d;
+  return (int32_t)(((int64_t)d * maPerUvQ24) >> 24);
+}
+
+int32_t current_raw_to_mA(uint32_t rawQ8) {
+  return uvToMa(rawQ8ToUv(rawQ8));
+}
+
+bool current_lut_from_points(const uint16_t* raw, const float* mV, size_t n) {
+  if (n < 2 || lutStaged) return false;
+  for (size_t k = 0; k < n; ++k) {
+    if (raw[k] > ADC_MAX || mV[k] < 0.0f) return false;
+    if (k && (raw[k] <= raw[k - 1] || mV[k] < mV[k - 1])) return false;
+  }
+  // Interpolación lineal entre puntos; fuera de ellos, la recta del tramo extremo
+  size_t k = 0;
+  for (size_t i = 0; i < LUT_POINTS; ++i) {
+    int r = (int)(i << LUT_SHIFT);
+    if (r > ADC_MAX) r = ADC_MAX;
+    while (k + 2 < n && r > raw[k + 1]) ++k;
+    float t  = (float)(r - raw[k]) / (float)(raw[k + 1] - raw[k]);
+    float mv = mV[k] + t * (mV[k + 1] - mV[k]);
+    if (mv < 0.0f) mv = 0.0f;
+    lutStage[i] = (int32_t)(mv * 1000.0f * DIVIDER_GAIN + 0.5f);
+  }
+  lutStaged = true;
+  if (!tasks_post_cmd(CMD_ADC_LUT)) {
+    lutStaged = false;
+    return false;
+  }
+  return true;
+}
+
+void current_lut_apply() {
+  if (!lutStaged) return;
+  memcpy(lutUv, lutStage, sizeof(lutUv));
+  lutStaged = false;
+  lutSource = "nvs";
+  cfg_set_blob(CFG_ADC_LUT, lutUv, sizeof(lutUv));
+  latestMa = uvToMa(rawQ8ToUv(emaRawQ8));
+  LOGI("[CURRENT] Tabla ADC por placa aplicada\n");
+}
+
+const char* current_lut_source() {
+  return lutSource;
+}
+
+static void offset_feed(uint16_t raw);
+
+static void ring_push(uint16_t raw) {
+  if (offsetIdle) offset_feed(raw);
+
+  ring[ringHead] = raw;
+  ringHead = (ringHead + 1) % RING_LEN;
+  if (ringCount < RING_LEN) ringCount++;
+
+  uint32_t xQ8 = (uint32_t)raw << 8;
+  if (ringCount == 1) emaRawQ8 = xQ8;
+  else                emaRawQ8 = emaRawQ8 - (emaRawQ8 >> EMA_SHIFT) + (xQ8 >> EMA_SHIFT);
+
+  latestMa = uvToMa(rawQ8ToUv(emaRawQ8));
+  tLastFrameMs = millis();
+}
+
+// Vacía las tramas pendientes del DMA en orden, todas al anillo (no bloquea).
+// Solo se lee el pool si el ISR ha contado tramas: leerlo vacío es un timeout
+// del driver. Si el pool se desbordó hay menos tramas que cuenta y el bucle
+// para al vaciarlo; las que lleguen mientras tanto quedan para la próxima vez.
+static void acq_drain() {
+  if (!acqRunning) return;
+  uint32_t n = acq_take_ready();
+  uint16_t raw;
+  while (n > 0 && acq_read_frame(raw)) {
+    ring_push(raw);
+    n--;
+  }
+}
+
+static void offset_block_reset() {
+  blkAcc = 0; blkN = 0; blkMin = 0xFFFF; blkMax = 0;
+}
+
+static void offset_feed(uint16_t raw) {
+  blkAcc += raw;
+  blkN++;
+  if (raw < blkMin) blkMin = raw;
+  if (raw > blkMax) blkMax = raw;
+  if (blkN < OFFSET_BLOCK_FRAMES) return;
+
+  bool stable = (uint16_t)(blkMax - blkMin) <= OFFSET_MAX_SPREAD;
+  int32_t uvBlock = rawQ8ToUv((blkAcc << 8) / blkN);
+  offset_block_reset();
+  if (!stable) return;   // algo se movía (o ruido): descartar bloque
+
+  if (!offsetValid) {
+    zeroUv = uvBlock;
+    zeroUvBoot = uvBlock;
+    offsetValid = true;
+    offsetSaveOnce = true;  // primera estimación: guardarla en cuanto se pueda
+  } else {
+    zeroUv += (uvBlock - zeroUv) >> OFFSET_EMA_SHIFT;
+  }
+}
+
+static void offset_maybe_persist(unsigned long ahoraMs) {
+  if (!offsetValid) return;
+  if (!offsetSaveOnce) {
+    if (labs(zeroUv - zeroUvSaved) < OFFSET_SAVE_DELTA_UV) return;
+    if ((ahoraMs - tLastOffsetSave) < OFFSET_SAVE_MIN_MS) return;
+  }
+  cfg_set_f(CFG_VZERO, zeroUv / 1e6f);
+  zeroUvSaved = zeroUv;
+  tLastOffsetSave = ahoraMs;
+  offsetSaveOnce = false;
+  LOGI("[CURRENT] Offset guardado vZero=%.4f V\n", zeroUv / 1e6f);
 }
 
 void current_begin() {
-  analogReadResolution(12);
-  analogSetAttenuation(ADC_11db);
+  // --- Límite guardado ---
+  LIMIT_A = cfg_get_f(CFG_LIMIT_A, LIMIT_A);
+  limitMa = (int32_t)(LIMIT_A * 1000.0f);
+  LOGI("[CURRENT] Límite cargado: %.2f A\n", LIMIT_A);
+
+  // Tabla de conversión antes de arrancar el ADC continuo
+  lut_build();
+  LOGI("[CURRENT] Tabla ADC: %s\n", lutSource);
 
-  // --- Abrir NVS y leer el límite guardado ---
-  prefs.begin("garage", false);  // namespace = "garage"
-  float saved = prefs.getFloat("limitA", LIMIT_A);
-  LIMIT_A = saved;
-  Serial.printf("[CURRENT] Límite cargado: %.2f A\n", LIMIT_A);
+  acqRunning = acq_start();
+  if (!acqRunning) LOGE("[CURRENT] Error iniciando ADC continuo\n");
 
-  delay(50);
+  // Offset: arrancar desde el último bueno; el estimador lo irá refinando
+  if (cfg_has(CFG_VZERO)) {
+    zeroUv = (int32_t)(cfg_get_f(CFG_VZERO, ZERO_UV_NOMINAL / 1e6f) * 1e6f);
+    zeroUvSaved = zeroUv;
+    offsetValid = true;
+    LOGI("[CURRENT] Offset cargado vZero=%.4f V\n", zeroUv / 1e6f);
+  } else {
+    LOGI("[CURRENT] Sin offset guardado; se estimará en reposo\n");
+  }
+  zeroUvBoot = zeroUv;
+  tLastOffsetSave = millis();
+}
 
-  // Calibrar offset con motor parado
-  calibrate_offset();
-  lastRecalMs = millis();
+int32_t current_read_mA() {
+  return latestMa;
 }
 
 float current_readA() {
-  const int N = 32;
+  return latestMa * 0.001f;
+}
+
+void current_window_stats(CurrentStats& out) {
+  out.samples = (uint16_t)ringCount;
+  out.ageMs   = ringCount ? (millis() - tLastFrameMs) : 0;
+  if (ringCount == 0) {
+    out.meanA = out.minA = out.maxA = 0.0f;
+    return;
+  }
   uint32_t acc = 0;
-  for (int i = 0; i < N; ++i) acc += analogRead(PIN_ACS);
-  float adcMean = acc / float(N);
-  float vAdc = (adcMean / ADC_MAX) * VREF;
-  float vOut = vAdc * DIVIDER_GAIN;
-  float delta = vOut - vZero;
-  float amps  = delta / SENS_V_PER_A;
-  return fabs(amps);
+  uint16_t rMin = 0xFFFF, rMax = 0;
+  for (size_t i = 0; i < ringCount; ++i) {
+    uint16_t r = ring[i];
+    acc += r;
+    if (r < rMin) rMin = r;
+    if (r > rMax) rMax = r;
+  }
+  out.meanA = uvToMa(rawQ8ToUv((acc << 8) / ringCount)) * 0.001f;
+  // |I| no es monótono con el raw: el mínimo/máximo en amperios sale de los extremos
+  int32_t uvLo = rawQ8ToUv((uint32_t)rMin << 8), uvHi = rawQ8ToUv((uint32_t)rMax << 8);
+  int32_t aLo = uvToMa(uvLo), aHi = uvToMa(uvHi);
+  bool straddlesZero = (uvLo <= zeroUv) && (zeroUv <= uvHi);
+  out.minA = (straddlesZero ? 0 : (aLo < aHi ? aLo : aHi)) * 0.001f;
+  out.maxA = ((aLo > aHi) ? aLo : aHi) * 0.001f;
 }
 
 bool current_guard_stop_if_over() {
   static uint8_t overCount = 0;  // 👈 asegurate de que sea estática
-  float Ia = current_readA();
-  float limit = LIMIT_A;
+  int32_t Ima = latestMa;
+  int32_t limit = limitMa;
 
   if (motor_isSlowMode()) {
-    limit *= 0.8;  // reduce el límite en modo lento (ajustable)
+    limit = (limit * 4) / 5;  // reduce el límite en modo lento (x0.8, ajustable)
   }
 
-  if (Ia > limit) {
-    overCount++;
-    if (overCount >= REQUIRED_OVER) {
-      EstadoPuerta eNow = getEstado();  // 👈 saber si estaba cerrando o abriendo
+  EstadoPuerta eNow = getEstado();  // 👈 saber si estaba cerrando o abriendo
+
+  // Envolvente aprendida por posición: reacciona antes que el límite global
+  bool envTrip = false;
+#if IENV_ENABLED
+  envTrip = ienv_sample(hall_get_count(), eNow, Ima);
+#endif
 
-      if (eNow == CERRANDO) {
-        setEstado(OBSTACULO);   // 👈 activar el estado de retroceso
-        Serial.printf("¡CORTE al cerrar! I=%.2f A (lim=%.2f)\n", Ia, limit);
-      } else {
-        setEstado(DETENIDO);    // 👈 solo parar si estaba abriendo
-        Serial.printf("¡CORTE al abrir! I=%.2f A (lim=%.2f)\n", Ia, limit);
-      }
+  if (Ima > limit) overCount++;
+  else overCount = 0;
 
-      overCount = 0;
-      return true;
+  if (envTrip || overCount >= params.currentRequiredOver) {
+    if (eNow == CERRANDO) {
+      setEstado(OBSTACULO);   // 👈 activar el estado de retroceso
+      LOGW("¡CORTE al cerrar! I=%.2f A (lim=%.2f)\n", Ima * 0.001f, limit * 0.001f);
+    } else {
+      setEstado(DETENIDO);    // 👈 solo parar si estaba abriendo
+      LOGW("¡CORTE al abrir! I=%.2f A (lim=%.2f)\n", Ima * 0.001f, limit * 0.001f);
     }
-  } else {
+
     overCount = 0;
+    ienv_note_trip();
+    return true;
   }
 
   return false;
@@ -103,12 +399,19 @@ bool current_guard_stop_if_over() {
 // --- Nuevo: guardar límite en NVS cuando cambia ---
 void current_set_limit(float amps) {
   LIMIT_A = amps;
-  prefs.putFloat("limitA", LIMIT_A);  // guardar en flash
-  Serial.printf("[CURRENT] Nuevo límite guardado: %.2f A\n", LIMIT_A);
+  limitMa = (int32_t)(amps * 1000.0f);
+  cfg_set_f(CFG_LIMIT_A, LIMIT_A);  // se escribe en flash de forma diferida
+  LOGI("[CURRENT] Nuevo límite guardado: %.2f A\n", LIMIT_A);
 }
 
 float current_get_limit() { return LIMIT_A; }
 
+float current_get_offset_V() { return zeroUv / 1e6f; }
+
+float current_offset_drift_mV() { return (zeroUv - zeroUvBoot) / 1000.0f; }
+
+bool current_offset_valid() { return offsetValid; }
+
 void current_tick(unsigned long ahoraMs) {
   static bool estabaDetenido = false;
   static unsigned long detenidoDesde = 0;
@@ -117,19 +420,18 @@ void current_tick(unsigned long ahoraMs) {
 
   if (!estaDetenido) {
     estabaDetenido = false;
-    return;
-  }
-
-  if (!estabaDetenido) {
+  } else if (!estabaDetenido) {
     estabaDetenido = true;
     detenidoDesde = ahoraMs;
   }
 
-  if ((ahoraMs - lastRecalMs) < RECAL_INTERVAL_MS)
-    return;
-  if ((ahoraMs - detenidoDesde) < MIN_IDLE_FOR_RECAL_MS)
-    return;
+  bool idle = estaDetenido && (ahoraMs - detenidoDesde) >= IDLE_SETTLE_MS;
+  if (idle != offsetIdle) {
+    offsetIdle = idle;
+    offset_block_reset();   // un bloque nunca mezcla reposo y movimiento
+  }
+
+  acq_drain();
 
-  calibrate_offset();
-  lastRecalMs = ahoraMs;
+  if (offsetIdle) offset_maybe_persist(ahoraMs);
 }
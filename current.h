@@ -1,12 +1,44 @@
 #pragma once
 #include <Arduino.h>
 
-// Inicialización y calibración
+// Inicialización (arranca la adquisición y carga límite y offset de NVS)
 void current_begin();
 
-// Lectura de corriente instantánea (Amperios)
+// Estadística de la ventana de adquisición (anillo de tramas del ADC continuo)
+struct CurrentStats {
+  float    meanA;    // media de la ventana (A)
+  float    minA;     // mínimo (A)
+  float    maxA;     // máximo (A)
+  uint16_t samples;  // tramas en la ventana
+  uint32_t ageMs;    // antigüedad de la última trama
+};
+
+// Última corriente filtrada (Amperios). No toca el ADC: lee el valor cacheado
+// que mantiene la adquisición continua (se alimenta en current_tick()).
 float current_readA();
 
+// Igual que current_readA() pero en mA enteros (camino rápido, sin float)
+int32_t current_read_mA();
+
+// raw del ADC en Q8 → mA con la tabla en uso (lo que hace la adquisición
+// con cada trama filtrada)
+int32_t current_raw_to_mA(uint32_t rawQ8);
+
+// Tabla ADC por placa a partir de puntos medidos con una referencia externa:
+// raw leído y mV en el pin del ADC, raw estrictamente creciente, al menos 2.
+// Interpola entre puntos (y prolonga el tramo extremo), la aplica en el
+// próximo paso de control (CMD_ADC_LUT → current_lut_apply()) y la guarda en
+// NVS vía cfgstore. Solo desde la tarea de red; false si los puntos no valen
+// o aún hay otra tabla pendiente de aplicar.
+bool current_lut_from_points(const uint16_t* raw, const float* mV, size_t n);
+void current_lut_apply();
+
+// Origen de la tabla en uso: "nvs", "efuse" o "lineal"
+const char* current_lut_source();
+
+// Copia la estadística de la ventana actual (la usa safety)
+void current_window_stats(CurrentStats& out);
+
 // Verificación de sobrecorriente, para y cambia estado si excede límite
 bool current_guard_stop_if_over();
 
@@ -16,5 +48,16 @@ void current_set_limit(float amps);
 // Lectura del límite actual
 float current_get_limit();
 
-// Recalibración periódica cuando el motor está detenido
+// Offset del sensor (V en la salida del ACS712), estimado en reposo
+float current_get_offset_V();
+
+// Deriva del offset desde el arranque (mV), para telemetría
+float current_offset_drift_mV();
+
+// true si el offset viene de NVS o de una medida (no del valor nominal)
+bool current_offset_valid();
+
+// Vacía las tramas del ADC continuo y alimenta la calibración incremental del
+// offset mientras la puerta está DETENIDA. No bloquea.
+// Llamar en cada vuelta de loop() antes que los consumidores de corriente.
 void current_tick(unsigned long ahoraMs);
\ No newline at end of file
@@ -4,14 +4,11 @@
 #include <SPI.h>
 #include "config.h"
 
-// ---- Ajusta a tu hardware MAX7219 ----
-#define HARDWARE_TYPE MD_MAX72XX::FC16_HW
-#define MAX_DEVICES   1
-#define DATA_PIN      23
-#define CLK_PIN       18
-#define CS_PIN        5
-
-static MD_Parola display = MD_Parola(HARDWARE_TYPE, DATA_PIN, CLK_PIN, CS_PIN, MAX_DEVICES);
+// SPI hardware (pines por defecto de VSPI) en lugar del bit-banging por
+// software: cada fila son 2 bytes por módulo a 8 MHz. MD_MAX72XX guarda el
+// framebuffer en RAM y marca las filas cambiadas de cada módulo; con UPDATE
+// en OFF se dibuja entero y update() envía solo esas filas.
+static MD_Parola display = MD_Parola(DISPLAY_HW_TYPE, DISPLAY_CS_PIN, DISPLAY_MAX_DEVICES);
 
 // ---- Estado interno del módulo display ----
 static EstadoPuerta s_estado = DETENIDO;
@@ -47,20 +44,26 @@ static const char* estadoToText(EstadoPuerta e)
   return "?";
 }
 
-// Dibuja un bitmap 8x8 usando setPoint() (compatible con MD_MAX72XX)
+// setRow() toma el bit 0 como columna 0: invertimos el orden de bits
+static inline uint8_t reverseBits(uint8_t b)
+{
+  b = (uint8_t)((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+  b = (uint8_t)((b & 0xCC) >> 2 | (b & 0x33) << 2);
+  return (uint8_t)((b & 0xAA) >> 1 | (b & 0x55) << 1);
+}
+
+// Dibuja un bitmap 8x8 en el módulo central: 8 setRow() sobre el
+// framebuffer y un único envío de las filas que cambian
 static void drawBitmap8x8(const uint8_t bmp[8])
 {
-  display.getGraphicObject()->clear();  // limpia el módulo
   MD_MAX72XX* mx = display.getGraphicObject();
+  mx->control(MD_MAX72XX::UPDATE, MD_MAX72XX::OFF);
+  mx->clear();
+  const uint8_t dev = DISPLAY_MAX_DEVICES / 2;
   for (uint8_t y = 0; y < 8; y++)
-  {
-    uint8_t row = bmp[y];
-    for (uint8_t x = 0; x < 8; x++)
-    {
-      bool on = (row & (0x80 >> x)) != 0; // MSB = columna 0
-      mx->setPoint(y, x, on);             // (fila, columna)
-    }
-  }
+    mx->setRow(dev, y, reverseBits(bmp[y]));   // (módulo, fila, bits)
+  mx->update();
+  mx->control(MD_MAX72XX::UPDATE, MD_MAX72XX::ON);
 }
 
 static void startScroll()
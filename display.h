@@ -5,4 +5,4 @@ enum EstadoPuerta : uint8_t { ABRIENDO, CERRANDO,  DETENIDO, OBSTACULO };
 
 void display_begin();
 void renderEstado(EstadoPuerta e);
-void display_tick();  // debe llamarse en loop()
\ No newline at end of file
+void display_tick();  // trabajo periódico de la tarea de red (sched.h)
\ No newline at end of file
@@ -1,91 +1,362 @@
 #include <Arduino.h>
-#include <Preferences.h>
 #include "hall.h"
 #include "config.h"
+#if HALL_BACKEND == HALL_BACKEND_PCNT
+#include <driver/pulse_cnt.h>
+#endif
 #include "state.h"
 #include "motor.h"
-
-static Preferences prefsHall;
+#include "ienv.h"
+#include "cfgstore.h"
+#include "params.h"
 
 static bool hall_enabled = (HALL_ENABLED_DEFAULT != 0);
 
-void hall_set_enabled(bool on) { hall_enabled = on; }
+static volatile float velCps = 0.0f;   // cuentas/s (+ abrir, - cerrar)
+
+void hall_set_enabled(bool on) {
+  hall_enabled = on;
+  if (!on) velCps = 0.0f;   // hall_tick() deja de actualizarla
+}
 bool hall_is_enabled()         { return hall_enabled; }
 
-static volatile long encCount = 0;
 static volatile int  encDir   = 0;    // +1 abrir, -1 cerrar
 
 // valor configurable en NVS
-long hall_open_pulses = HALL_OPEN_PULSES_DEFAULT;
-
-// Persistencia del último final de carrera alcanzado
-static const char* NVS_NS_HALL   = "hall";
-static const char* KEY_OPEN_PLS  = "open_pulses";
-static const char* KEY_LAST_END  = "last_end";
+long hall_open_pulses = HALL_OPEN_PULSES_DEFAULT * HALL_COUNTS_PER_PULSE;
 
+// Último final de carrera alcanzado (hall/last_end en cfgstore)
 enum LastEndstop : uint8_t { END_UNKNOWN=0, END_CLOSED=1, END_OPEN=2 };
 
+// =====================================================
+//   Marcas de tiempo de flancos (µs) para estimar velocidad
+// =====================================================
+// Anillo de (instante, posición) por cada cambio de cuenta. El instante es
+// siempre el del flanco: con la ISR, el de la propia ISR; con PCNT, el que
+// guarda una ISR mínima en el pin de pulsos (HALL_PCNT_EDGE_STAMP; sin ella,
+// el de la lectura que vio el cambio, con la resolución del periodo de
+// control).
+struct EdgeStamp { uint32_t us; long pos; };
+static const uint8_t  EDGE_RING      = 16;       // potencia de 2
+static const uint32_t VEL_WINDOW_US  = 50000;    // a velocidad alta, promedia flancos de 50 ms
+static const uint32_t VEL_TIMEOUT_US = 500000;   // sin flancos en 0,5 s → parado
+
+static EdgeStamp edgeRing[EDGE_RING];
+static uint8_t   edgeHead  = 0;    // siguiente posición a escribir
+static uint8_t   edgeCount = 0;
+static portMUX_TYPE edgeMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Llamar con edgeMux tomado
+static inline void edge_push(uint32_t us, long pos) {
+  edgeRing[edgeHead].us  = us;
+  edgeRing[edgeHead].pos = pos;
+  edgeHead = (edgeHead + 1) & (EDGE_RING - 1);
+  if (edgeCount < EDGE_RING) edgeCount++;
+}
+
+// =====================================================
+//   Backend del encoder: enc_begin() / enc_read() / enc_poll() / enc_write()
+// =====================================================
+#if HALL_BACKEND == HALL_BACKEND_PCNT
+
+// Contador hardware: cuenta sin CPU, con filtro antiglitch. El contador es de
+// 16 bits; el driver acumula los desbordes (eventos en los límites) y
+// pcnt_unit_get_count() devuelve la cuenta extendida.
+static const int PCNT_LIMIT = 32767;
+static pcnt_unit_handle_t pcntUnit = nullptr;
+static long encOffset = 0;      // posición = encOffset + cuenta hardware
+static long lastRead  = 0;
+
+#if HALL_PCNT_EDGE_STAMP
+// PCNT cuenta; esta ISR solo apunta el instante del último flanco (y un
+// número de secuencia para saber si llegó otro durante una lectura). Los
+// glitches que filtra PCNT también la disparan, pero sin cambio de cuenta
+// no generan marca.
+static volatile uint32_t edgeUs  = 0;
+static volatile uint32_t edgeSeq = 0;
+
+IRAM_ATTR static void isr_stamp() {
+  uint32_t us = micros();
+  portENTER_CRITICAL_ISR(&edgeMux);
+  edgeUs = us;
+  edgeSeq++;
+  portEXIT_CRITICAL_ISR(&edgeMux);
+}
+#endif
+
+static void enc_begin() {
+  pcnt_unit_config_t ucfg = {};
+  ucfg.low_limit  = -PCNT_LIMIT;
+  ucfg.high_limit =  PCNT_LIMIT;
+  ucfg.flags.accum_count = 1;
+  ESP_ERROR_CHECK(pcnt_new_unit(&ucfg, &pcntUnit));
+
+  pcnt_glitch_filter_config_t fcfg = {};
+  fcfg.max_glitch_ns = HALL_PCNT_GLITCH_NS;
+  ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(pcntUnit, &fcfg));
+
+  pcnt_chan_config_t ca = {};
+  ca.edge_gpio_num  = HALL_PULSE_PIN;
+  ca.level_gpio_num = HALL_DIR_PIN;
+  pcnt_channel_handle_t chA = nullptr;
+  ESP_ERROR_CHECK(pcnt_new_channel(pcntUnit, &ca, &chA));
+
+#if HALL_PCNT_MODE == 4
+  // Cuadratura: PULSE = canal A, DIR = canal B; 4 cuentas por ciclo
+  pcnt_chan_config_t cb = {};
+  cb.edge_gpio_num  = HALL_DIR_PIN;
+  cb.level_gpio_num = HALL_PULSE_PIN;
+  pcnt_channel_handle_t chB = nullptr;
+  ESP_ERROR_CHECK(pcnt_new_channel(pcntUnit, &cb, &chB));
+#if HALL_DIR_ACTIVE_HIGH_CLOSE
+  pcnt_channel_set_edge_action(chA, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+  pcnt_channel_set_edge_action(chB, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+#else
+  pcnt_channel_set_edge_action(chA, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+  pcnt_channel_set_edge_action(chB, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+#endif
+  pcnt_channel_set_level_action(chA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+  pcnt_channel_set_level_action(chB, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+#else
+  // Pulso + dirección: DIR es la entrada de control hardware (invierte el sentido)
+  pcnt_channel_set_edge_action(chA, PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+#if HALL_PCNT_MODE == 2
+                               PCNT_CHANNEL_EDGE_ACTION_INCREASE);   // ambos flancos
+#else
+                               PCNT_CHANNEL_EDGE_ACTION_HOLD);       // solo subida
+#endif
+#if HALL_DIR_ACTIVE_HIGH_CLOSE
+  pcnt_channel_set_level_action(chA, PCNT_CHANNEL_LEVEL_ACTION_INVERSE, PCNT_CHANNEL_LEVEL_ACTION_KEEP);
+#else
+  pcnt_channel_set_level_action(chA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+#endif
+#endif
+
+  // Los puntos de vigilancia en los límites generan el evento de desborde
+  // con el que el driver extiende la cuenta
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(pcntUnit,  PCNT_LIMIT));
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(pcntUnit, -PCNT_LIMIT));
+
+  ESP_ERROR_CHECK(pcnt_unit_enable(pcntUnit));
+  ESP_ERROR_CHECK(pcnt_unit_clear_count(pcntUnit));
+  ESP_ERROR_CHECK(pcnt_unit_start(pcntUnit));
+
+#if HALL_PCNT_EDGE_STAMP
+  // Los mismos flancos que cuenta PCNT
+  attachInterrupt(digitalPinToInterrupt(HALL_PULSE_PIN), isr_stamp, HALL_PCNT_MODE == 1 ? RISING : CHANGE);
+#if HALL_PCNT_MODE == 4
+  attachInterrupt(digitalPinToInterrupt(HALL_DIR_PIN), isr_stamp, CHANGE);
+#endif
+#endif
+}
+
+// Solo lectura: vale desde cualquier tarea
+static long enc_read() {
+  int hw = 0;
+  pcnt_unit_get_count(pcntUnit, &hw);
+  portENTER_CRITICAL(&edgeMux);
+  long pos = encOffset + hw;
+  portEXIT_CRITICAL(&edgeMux);
+  return pos;
+}
+
+// Solo tarea de control (hall_tick): la dirección y las marcas salen del
+// último cambio de cuenta observado, con el instante del último flanco
+static long enc_poll() {
+  int hw = 0;
+#if HALL_PCNT_EDGE_STAMP
+  // Cuenta e instante del mismo flanco: si llega otro durante la lectura,
+  // no se sabe si ya está contado y se repite (a alta velocidad, tras unos
+  // intentos vale cualquiera: la ventana promedia muchos flancos)
+  uint32_t us = 0;
+  for (uint8_t tries = 0; tries < 4; ++tries) {
+    portENTER_CRITICAL(&edgeMux);
+    uint32_t seq = edgeSeq;
+    us = edgeUs;
+    portEXIT_CRITICAL(&edgeMux);
+    pcnt_unit_get_count(pcntUnit, &hw);
+    if (edgeSeq == seq) break;
+  }
+#else
+  pcnt_unit_get_count(pcntUnit, &hw);
+  uint32_t us = micros();
+#endif
+  portENTER_CRITICAL(&edgeMux);
+  long pos = encOffset + hw;
+  if (pos != lastRead) {
+    encDir = (pos > lastRead) ? +1 : -1;
+    lastRead = pos;
+    edge_push(us, pos);
+  }
+  portEXIT_CRITICAL(&edgeMux);
+  return pos;
+}
+
+static void enc_write(long pos) {
+  int hw = 0;
+  pcnt_unit_get_count(pcntUnit, &hw);
+  portENTER_CRITICAL(&edgeMux);
+  encOffset = pos - hw;
+  lastRead  = pos;
+  edgeCount = 0;     // las marcas anteriores ya no son comparables
+  portEXIT_CRITICAL(&edgeMux);
+}
+
+#else  // HALL_BACKEND_ISR
+
+static volatile long encCount = 0;
+
 // ISR para el pin de PULSOS
 IRAM_ATTR static void isr_pulse() {
+  uint32_t us = micros();
   int dirLevel = digitalRead(HALL_DIR_PIN);
 #if HALL_DIR_ACTIVE_HIGH_CLOSE
   encDir = (dirLevel ? -1 : +1);
 #else
   encDir = (dirLevel ? +1 : -1);
 #endif
+  portENTER_CRITICAL_ISR(&edgeMux);
   encCount += encDir;
+  edge_push(us, encCount);
+  portEXIT_CRITICAL_ISR(&edgeMux);
 }
 
-void hall_begin() {
-  prefsHall.begin(NVS_NS_HALL, false);
-  hall_open_pulses = prefsHall.getLong(KEY_OPEN_PLS, HALL_OPEN_PULSES_DEFAULT);
-
-  // Restaurar último extremo si lo había
-  uint8_t lastEnd = prefsHall.getUChar(KEY_LAST_END, END_UNKNOWN);
-  if (lastEnd == END_CLOSED)      encCount = 0;
-  else if (lastEnd == END_OPEN)   encCount = hall_open_pulses;
-
+static void enc_begin() {
   pinMode(HALL_PULSE_PIN, INPUT);
   pinMode(HALL_DIR_PIN, INPUT);
 
   attachInterrupt(digitalPinToInterrupt(HALL_PULSE_PIN), isr_pulse, RISING);
 }
 
-long hall_get_count() { return encCount; }
+static long enc_read() { return encCount; }
+static long enc_poll() { return encCount; }   // la ISR ya registra cada flanco
+
+static void enc_write(long pos) {
+  portENTER_CRITICAL(&edgeMux);
+  encCount  = pos;
+  edgeCount = 0;     // las marcas anteriores ya no son comparables
+  portEXIT_CRITICAL(&edgeMux);
+}
+
+#endif
+
+// Copia las marcas, de la más reciente a la más antigua
+static uint8_t edge_snapshot(EdgeStamp* out) {
+  portENTER_CRITICAL(&edgeMux);
+  uint8_t n = edgeCount;
+  uint8_t i = edgeHead;
+  for (uint8_t k = 0; k < n; ++k) {
+    i = (i - 1) & (EDGE_RING - 1);
+    out[k] = edgeRing[i];
+  }
+  portEXIT_CRITICAL(&edgeMux);
+  return n;
+}
+
+// Estimador por periodo: a velocidad alta promedia los flancos de la última
+// ventana; a velocidad baja usa el periodo entre los dos últimos flancos y,
+// si el siguiente tarda más de un periodo, acota la velocidad a 1/(tiempo
+// transcurrido) para que decaiga a 0 al pararse.
+static void vel_update(uint32_t nowUs) {
+  EdgeStamp e[EDGE_RING];
+  uint8_t n = edge_snapshot(e);
+  if (n < 2) { velCps = 0.0f; return; }
+
+  uint32_t sinceLast = nowUs - e[0].us;
+  if (sinceLast > VEL_TIMEOUT_US) { velCps = 0.0f; return; }
+
+  uint8_t k = 1;
+  while (k + 1 < n && (e[0].us - e[k + 1].us) <= VEL_WINDOW_US) k++;
+
+  uint32_t dt = e[0].us - e[k].us;
+  long     dp = e[0].pos - e[k].pos;
+  if (dt == 0 || dp == 0) { velCps = 0.0f; return; }
+
+  float v = (float)dp * 1e6f / (float)dt;
+  float periodUs = (float)dt / fabsf((float)dp);
+  if ((float)sinceLast > periodUs) {
+    float vMax = 1e6f / (float)sinceLast;
+    v = (v > 0.0f) ? vMax : -vMax;
+  }
+  velCps = v;
+}
+
+float hall_get_velocity() { return velCps; }
+
+float hall_get_position_interp() {
+  EdgeStamp last;
+  portENTER_CRITICAL(&edgeMux);
+  bool have = (edgeCount > 0);
+  if (have) last = edgeRing[(edgeHead - 1) & (EDGE_RING - 1)];
+  portEXIT_CRITICAL(&edgeMux);
+
+  if (!have) return (float)hall_get_count();
+
+  // Avance desde el último flanco, sin llegar al siguiente (aún no visto)
+  float frac = velCps * (float)(micros() - last.us) * 1e-6f;
+  if (frac >  0.99f) frac =  0.99f;
+  if (frac < -0.99f) frac = -0.99f;
+  return (float)last.pos + frac;
+}
+
+void hall_begin() {
+  hall_open_pulses = cfg_get_i(CFG_HALL_OPEN_PULSES, HALL_OPEN_PULSES_DEFAULT * HALL_COUNTS_PER_PULSE);
+
+  // Si cambió la resolución del backend, reescalar el recorrido guardado
+  uint8_t res = (uint8_t)cfg_get_i(CFG_HALL_RES, 1);
+  if (res != HALL_COUNTS_PER_PULSE && cfg_has(CFG_HALL_OPEN_PULSES)) {
+    hall_open_pulses = (hall_open_pulses * HALL_COUNTS_PER_PULSE) / res;
+    cfg_set_i(CFG_HALL_OPEN_PULSES, hall_open_pulses);
+  }
+  if (res != HALL_COUNTS_PER_PULSE) cfg_set_i(CFG_HALL_RES, HALL_COUNTS_PER_PULSE);
+
+  enc_begin();
+
+  // Restaurar último extremo si lo había
+  uint8_t lastEnd = (uint8_t)cfg_get_i(CFG_HALL_LAST_END, END_UNKNOWN);
+  if (lastEnd == END_CLOSED)      enc_write(0);
+  else if (lastEnd == END_OPEN)   enc_write(hall_open_pulses);
+}
+
+long hall_get_count() { return enc_read(); }
 int  hall_get_dir()   { return encDir; }
 
 void hall_mark_closed() {
-  encCount = 0;
-  prefsHall.putUChar(KEY_LAST_END, END_CLOSED);
+  enc_write(0);
+  cfg_set_i(CFG_HALL_LAST_END, END_CLOSED);
 }
 
 void hall_mark_open() {
-  hall_open_pulses = encCount;
-  prefsHall.putLong(KEY_OPEN_PLS, hall_open_pulses);
-  prefsHall.putUChar(KEY_LAST_END, END_OPEN);
+  hall_open_pulses = enc_read();
+  cfg_set_i(CFG_HALL_OPEN_PULSES, hall_open_pulses);
+  cfg_set_i(CFG_HALL_LAST_END, END_OPEN);
 }
 
 void hall_tick(unsigned long now) {
   static unsigned long tLastStop = 0;
 
   auto tryStop = [&](const char* /*why*/){
-    if (now - tLastStop >= HALL_STOP_DEBOUNCE_MS) {
+    if (now - tLastStop >= params.hallStopDebounceMs) {
       setEstado(DETENIDO);
       tLastStop = now;
 
-      if (encCount <= 0) {
-        prefsHall.putUChar(KEY_LAST_END, END_CLOSED);
-        encCount = 0;
-      } else if (encCount >= hall_open_pulses) {
-        prefsHall.putUChar(KEY_LAST_END, END_OPEN);
-        encCount = hall_open_pulses;
+      long pos = enc_read();
+      if (pos <= 0) {
+        cfg_set_i(CFG_HALL_LAST_END, END_CLOSED);
+        enc_write(0);
+        ienv_end_cycle(true);
+      } else if (pos >= hall_open_pulses) {
+        cfg_set_i(CFG_HALL_LAST_END, END_OPEN);
+        enc_write(hall_open_pulses);
+        ienv_end_cycle(true);
       }
     }
   };
 
-  long c = hall_get_count();
+  long c = enc_poll();   // con PCNT, además registra el cambio de cuenta
+  vel_update(micros());
   const long total = hall_open_pulses;
-  const long slowThreshPulses = (total * HALL_SLOWDOWN_THRESHOLD_PERCENT) / 100;
+  const long slowThreshPulses = (total * params.hallSlowPct) / 100;
 
   auto nearEitherEnd = [&](long pos){
     long distToClosed = pos;
@@ -9,6 +9,8 @@
 // #define HALL_OPEN_PULSES_DEFAULT 5000   // Pulsos esperados para un ciclo completo (ajústalo a tu puerta)
 // #define HALL_SLOWDOWN_THRESHOLD_PERCENT 10 // % al inicio/fin para ir en "lento"
 // #define HALL_DIR_ACTIVE_HIGH_CLOSE 1  // 1 = nivel alto = CERRANDO ; 0 = nivel alto = ABRIENDO
+// #define HALL_BACKEND HALL_BACKEND_PCNT // ISR por flanco o contador hardware PCNT
+// #define HALL_PCNT_MODE 2               // cuentas por pulso con PCNT (1, 2 o 4)
 // =================================
 
 // Inicializa el sistema Hall (lee valores guardados en NVS, configura pines e interrupciones)
@@ -19,7 +21,8 @@ void hall_begin();
 // - Activar/desactivar modo lento según posición
 void hall_tick(unsigned long now);
 
-// Devuelve el contador de pulsos actual
+// Devuelve el contador de pulsos actual (en cuentas: HALL_COUNTS_PER_PULSE por pulso).
+// Solo lee: la dirección y las marcas de velocidad las actualiza hall_tick()
 // - 0        = tope de CERRADO
 // - max      = tope de ABIERTO
 // - valores intermedios = posición relativa
@@ -31,6 +34,15 @@ long hall_get_count();
 //  0 = sin movimiento/pulsos
 int hall_get_dir();
 
+// Velocidad estimada (cuentas/s, + = ABRIENDO, - = CERRANDO) por medida del
+// periodo entre flancos; robusta a baja velocidad y decae a 0 al pararse.
+// Se actualiza en hall_tick().
+float hall_get_velocity();
+
+// Posición interpolada entre pulsos (cuentas, con fracción) a partir del
+// último flanco y la velocidad estimada
+float hall_get_position_interp();
+
 // Marca que se alcanzó el extremo CERRADO
 // - pone encCount=0
 // - guarda en NVS que el último extremo válido fue CERRADO
@@ -0,0 +1,47 @@
+#include "heapmon.h"
+#include <esp_heap_caps.h>
+
+static volatile TaskHandle_t s_task   = nullptr;  // tarea vigilada (con depth > 0)
+static volatile uint8_t      s_depth  = 0;
+static volatile uint8_t      s_pause  = 0;
+static volatile uint32_t     s_allocs = 0;
+
+#if defined(CONFIG_HEAP_USE_HOOKS)
+// Hook débil de ESP-IDF: se llama en cada reserva con éxito
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  (void)ptr; (void)size; (void)caps;
+  if (s_task && s_pause == 0 && xTaskGetCurrentTaskHandle() == s_task) s_allocs++;
+}
+#endif
+
+void heapmon_watch_begin() {
+  if (s_depth++ == 0) s_task = xTaskGetCurrentTaskHandle();
+}
+
+void heapmon_watch_end() {
+  if (s_depth && --s_depth == 0) s_task = nullptr;
+}
+
+void heapmon_pause()  { s_pause++; }
+void heapmon_resume() { if (s_pause) s_pause--; }
+
+bool heapmon_supported() {
+#if defined(CONFIG_HEAP_USE_HOOKS)
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint32_t heapmon_watched_allocs() {
+  return s_allocs;
+}
+
+void heapmon_stats(HeapStats& out) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  out.freeBytes = info.total_free_bytes;
+  out.minFree   = info.minimum_free_bytes;
+  out.largest   = info.largest_free_block;
+  out.blocks    = info.allocated_blocks;
+}
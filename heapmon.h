@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+
+// =====================================================
+//   Contador de reservas de heap en rutas vigiladas
+// =====================================================
+// Cuenta las reservas que hace la tarea que arma la vigilancia mientras está
+// dentro de una HeapWatch (y fuera de una HeapPause). Necesita los hooks de
+// heap de ESP-IDF (CONFIG_HEAP_USE_HOOKS); sin ellos heapmon_supported()
+// devuelve false y solo quedan las estadísticas generales del heap. En el
+// host, tools/sim/net_alloc comprueba las mismas rutas sin los hooks.
+
+void heapmon_watch_begin();
+void heapmon_watch_end();
+void heapmon_pause();     // p. ej. alrededor de la pila TCP/IP, que sí reserva
+void heapmon_resume();
+
+bool     heapmon_supported();
+uint32_t heapmon_watched_allocs();   // acumulado desde el arranque
+
+struct HeapStats {
+  uint32_t freeBytes;
+  uint32_t minFree;
+  uint32_t largest;
+  uint32_t blocks;
+};
+void heapmon_stats(HeapStats& out);
+
+// Ámbitos RAII
+struct HeapWatch {
+  HeapWatch()  { heapmon_watch_begin(); }
+  ~HeapWatch() { heapmon_watch_end(); }
+};
+
+struct HeapPause {
+  HeapPause()  { heapmon_pause(); }
+  ~HeapPause() { heapmon_resume(); }
+};
@@ -0,0 +1,149 @@
+#include "ienv.h"
+#include "config.h"
+#include "cfgstore.h"
+#include "params.h"
+#include "hall.h"
+#include "logx.h"
+
+static const uint8_t  IENV_VERSION = 1;
+static const uint16_t MA_PER_UNIT  = 50;   // resolución del blob: 50 mA (máx 12,75 A)
+
+struct IenvCell {
+  uint8_t peak;    // pico esperado (x50 mA)
+  uint8_t n;       // ciclos aprendidos (satura en 255)
+};
+
+struct IenvBlob {
+  uint8_t  version;
+  uint8_t  buckets;
+  IenvCell cell[2][IENV_BUCKETS];   // [0] = ABRIENDO, [1] = CERRANDO
+};
+
+static IenvBlob env;         // la usan la guardia y la detección (tarea de control)
+static IenvBlob envSaved;    // copia para cfgstore: la escribe la tarea de red
+
+// Ciclo en curso (RAM)
+static uint8_t cyclePeak[2][IENV_BUCKETS];   // 0 = tramo sin muestras
+static bool    cycleTouched = false;
+static bool    cycleTripped = false;
+static uint8_t overCount = 0;
+
+static void env_clear() {
+  memset(&env, 0, sizeof(env));
+  env.version = IENV_VERSION;
+  env.buckets = IENV_BUCKETS;
+}
+
+static void cycle_clear() {
+  memset(cyclePeak, 0, sizeof(cyclePeak));
+  cycleTouched = false;
+  cycleTripped = false;
+}
+
+static inline uint8_t toUnits(int32_t mA) {
+  if (mA <= 0) return 0;
+  int32_t u = (mA + MA_PER_UNIT / 2) / MA_PER_UNIT;
+  return (u > 255) ? 255 : (uint8_t)u;
+}
+
+static inline int bucketOf(long pos) {
+  long total = hall_open_pulses;
+  if (total <= 0) return 0;
+  if (pos < 0) pos = 0;
+  if (pos >= total) return IENV_BUCKETS - 1;
+  return (int)((pos * IENV_BUCKETS) / total);
+}
+
+// Se llama desde la tarea de control al acabar un ciclo: nada de flash aquí,
+// cfgstore escribe el blob desde la tarea de red (coalescido). Si el volcado
+// coincide con otra copia se mezclan celdas viejas y nuevas, que siguen
+// siendo una envolvente válida; la siguiente copia lo corrige.
+static void env_save() {
+  envSaved = env;
+  cfg_set_blob(CFG_IENV_ENV, &envSaved, sizeof(envSaved));
+}
+
+void ienv_begin() {
+  env_clear();
+  IenvBlob tmp;
+  if (cfg_get_blob(CFG_IENV_ENV, &tmp, sizeof(tmp)) == sizeof(tmp) &&
+      tmp.version == IENV_VERSION && tmp.buckets == IENV_BUCKETS)
+    env = tmp;
+  cycle_clear();
+  logPrintf("[IENV] Envolvente: %u tramos aprendidos\n", (unsigned)ienv_learned_buckets());
+}
+
+bool ienv_sample(long pos, EstadoPuerta e, int32_t mA) {
+  if (!hall_is_enabled() || (e != ABRIENDO && e != CERRANDO)) {
+    overCount = 0;
+    return false;
+  }
+  int d = (e == ABRIENDO) ? 0 : 1;
+  int b = bucketOf(pos);
+
+  // Aprendizaje: pico del ciclo en este tramo
+  uint8_t u = toUnits(mA);
+  if (u == 0) u = 1;                 // marca el tramo como visitado
+  if (u > cyclePeak[d][b]) cyclePeak[d][b] = u;
+  cycleTouched = true;
+
+  // Detección solo en tramos con suficiente historia
+  const IenvCell& c = env.cell[d][b];
+  if (c.n < IENV_MIN_CYCLES) {
+    overCount = 0;
+    return false;
+  }
+  int32_t peakMa = (int32_t)c.peak * MA_PER_UNIT;
+  int32_t thrMa  = peakMa + (peakMa * params.ienvMarginPct) / 100 + params.ienvMarginMa;
+
+  if (mA > thrMa) {
+    if (++overCount >= params.ienvRequiredOver) {
+      overCount = 0;
+      logPrintf("[IENV] Fuera de envolvente: I=%ld mA > %ld mA (tramo %d/%d)\n",
+                (long)mA, (long)thrMa, b, d);
+      return true;
+    }
+  } else {
+    overCount = 0;
+  }
+  return false;
+}
+
+void ienv_note_trip() {
+  cycleTripped = true;
+  overCount = 0;
+}
+
+void ienv_end_cycle(bool ok) {
+  if (ok && cycleTouched && !cycleTripped) {
+    for (int d = 0; d < 2; ++d) {
+      for (int b = 0; b < IENV_BUCKETS; ++b) {
+        uint8_t p = cyclePeak[d][b];
+        if (p == 0) continue;
+        IenvCell& c = env.cell[d][b];
+        if (c.n == 0) c.peak = p;
+        else          c.peak = (uint8_t)(c.peak + ((int)p - (int)c.peak) / 4);  // EMA 1/4
+        if (c.n < 255) c.n++;
+      }
+    }
+    env_save();
+  }
+  cycle_clear();
+  overCount = 0;
+}
+
+void ienv_reset() {
+  env_clear();
+  cycle_clear();
+  overCount = 0;
+  env_save();   // vacía: sustituye a la guardada
+  logPrintln("[IENV] Envolvente borrada");
+}
+
+uint16_t ienv_learned_buckets() {
+  uint16_t n = 0;
+  for (int d = 0; d < 2; ++d)
+    for (int b = 0; b < IENV_BUCKETS; ++b)
+      if (env.cell[d][b].n >= IENV_MIN_CYCLES) n++;
+  return n;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+#include "display.h"   // EstadoPuerta
+
+// =====================================================
+//   Envolvente de corriente aprendida por posición
+// =====================================================
+// Para cada tramo del recorrido (IENV_BUCKETS por sentido) se aprende el
+// pico de corriente esperado a partir de ciclos completados sin incidencias.
+// Un obstáculo se detecta cuando la corriente supera el pico esperado del
+// tramo más el margen durante IENV_REQUIRED_OVER muestras seguidas.
+// Se guarda en NVS como un único blob a través de cfgstore (escritura
+// diferida desde la tarea de red).
+
+void ienv_begin();
+
+// Muestra de corriente durante el movimiento (desde la guardia, ya pasado el
+// blanking). Aprende el pico del ciclo en curso y devuelve true si la
+// corriente se sale de la envolvente.
+bool ienv_sample(long pos, EstadoPuerta e, int32_t mA);
+
+// Hubo un corte (envolvente o límite global): el ciclo en curso no se aprende
+void ienv_note_trip();
+
+// Fin de ciclo: con ok=true (tope alcanzado u objetivo de goto) y sin cortes,
+// los picos del ciclo se incorporan a la envolvente y se marca para guardar.
+void ienv_end_cycle(bool ok);
+
+// Borra lo aprendido (RAM y, con la próxima escritura diferida, NVS)
+void ienv_reset();
+
+// Tramos ya utilizables para detección (0..2*IENV_BUCKETS)
+uint16_t ienv_learned_buckets();
@@ -1,34 +1,96 @@
 #include <Arduino.h>
-#include <math.h>
-#include <Preferences.h>
+#include <driver/ledc.h>
 #include "config.h"
 #include "light.h"
 #include "state.h"
 #include "logx.h"
+#include "cfgstore.h"
+#include "params.h"
+#include "sched.h"
+#include "net.h"
 
 // =============== Config interna de efectos ===============
-static const uint32_t RESP_UPDATE_MS   = 30;    // refresco respiración
+// Las transiciones las hace el fade hardware del LEDC: la CPU solo calcula
+// los extremos de cada segmento (interpolación lineal de duty entre ellos).
 static const uint32_t RESP_PERIOD_MS   = 2000;  // periodo respiración (ms)
-static const float    BREATH_MIN       = 0.20f; // no baja a negro (20%)
-static const float    BREATH_MAX       = 1.00f;
-
-static const uint16_t FADE_STEP        = 20;    // decremento por paso (ajusta velocidad)
-static const uint32_t FADE_STEP_MS     = 30;    // periodo de pasos de fade
+static const uint8_t  RESP_SEGMENTS    = 16;    // segmentos por periodo
+static const uint32_t RESP_SEG_MS      = RESP_PERIOD_MS / RESP_SEGMENTS;
+static const uint16_t BREATH_MIN_Q8    = 51;    // no baja a negro (20%)
+static const uint16_t BREATH_MAX_Q8    = 256;   // 100%
+
+static const uint16_t FADE_STEP        = 20;    // velocidad de apagado: FADE_STEP niveles
+static const uint32_t FADE_STEP_MS     = 30;    //   cada FADE_STEP_MS
+static const uint8_t  FADE_SEGMENTS    = 8;     // segmentos (perceptualmente iguales)
+
+// Margen para que cada fade termine antes de programar el siguiente
+static const uint32_t SEG_GUARD_MS     = 5;
+
+// Onda de respiración (sin+1)/2 en Q8, 256 muestras por periodo
+static const uint8_t BREATH_WAVE[256] = {
+  128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+  176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+  218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+  245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+  255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+  245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+  218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+  176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+  128, 124, 121, 118, 115, 112, 109, 106, 103, 100, 97, 93, 90, 88, 85, 82,
+  79, 76, 73, 70, 67, 65, 62, 59, 57, 54, 52, 49, 47, 44, 42, 40,
+  37, 35, 33, 31, 29, 27, 25, 23, 21, 20, 18, 17, 15, 14, 12, 11,
+  10, 9, 7, 6, 5, 5, 4, 3, 2, 2, 1, 1, 1, 0, 0, 0,
+  0, 0, 0, 0, 1, 1, 1, 2, 2, 3, 4, 5, 5, 6, 7, 9,
+  10, 11, 12, 14, 15, 17, 18, 20, 21, 23, 25, 27, 29, 31, 33, 35,
+  37, 40, 42, 44, 47, 49, 52, 54, 57, 59, 62, 65, 67, 70, 73, 76,
+  79, 82, 85, 88, 90, 93, 97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+};
+
+// Corrección gamma 2.2 en Q16 (257 puntos, interpolación lineal): el nivel
+// guardado es perceptual y los niveles bajos se ven lineales
+static const uint16_t GAMMA_Q16[257] = {
+  0, 0, 2, 4, 7, 11, 17, 24, 32, 41, 52, 64,
+  78, 93, 110, 128, 147, 168, 191, 215, 240, 267, 296, 327,
+  359, 392, 428, 465, 504, 544, 586, 630, 676, 723, 772, 823,
+  875, 930, 986, 1044, 1104, 1165, 1229, 1294, 1361, 1430, 1501, 1574,
+  1648, 1725, 1803, 1884, 1966, 2050, 2136, 2224, 2314, 2406, 2500, 2595,
+  2693, 2793, 2895, 2998, 3104, 3212, 3322, 3433, 3547, 3663, 3781, 3900,
+  4022, 4146, 4272, 4400, 4530, 4663, 4797, 4933, 5072, 5212, 5355, 5499,
+  5646, 5795, 5946, 6099, 6255, 6412, 6572, 6733, 6897, 7063, 7231, 7402,
+  7574, 7749, 7926, 8105, 8286, 8469, 8655, 8843, 9033, 9225, 9419, 9616,
+  9815, 10016, 10219, 10425, 10632, 10842, 11054, 11269, 11486, 11705, 11926, 12149,
+  12375, 12603, 12833, 13066, 13301, 13538, 13777, 14019, 14263, 14509, 14758, 15009,
+  15262, 15517, 15775, 16035, 16298, 16563, 16830, 17099, 17371, 17645, 17922, 18201,
+  18482, 18765, 19051, 19339, 19630, 19923, 20218, 20516, 20816, 21119, 21424, 21731,
+  22040, 22352, 22667, 22984, 23303, 23624, 23949, 24275, 24604, 24935, 25269, 25605,
+  25943, 26284, 26628, 26973, 27322, 27672, 28026, 28381, 28739, 29100, 29462, 29828,
+  30196, 30566, 30939, 31314, 31692, 32072, 32454, 32840, 33227, 33617, 34010, 34405,
+  34802, 35202, 35605, 36010, 36417, 36827, 37240, 37655, 38072, 38493, 38915, 39340,
+  39768, 40198, 40631, 41066, 41503, 41944, 42387, 42832, 43280, 43730, 44183, 44639,
+  45097, 45557, 46020, 46486, 46954, 47425, 47899, 48374, 48853, 49334, 49818, 50304,
+  50793, 51284, 51778, 52275, 52774, 53276, 53780, 54287, 54796, 55308, 55823, 56341,
+  56860, 57383, 57908, 58436, 58966, 59499, 60035, 60573, 61114, 61657, 62203, 62752,
+  63303, 63857, 64414, 64973, 65535,
+};
 
 // =============== Estado interno ===============
 static bool         s_on = false;                 // estado lógico
 static uint16_t     s_user_max = LIGHT_DEFAULT_LEVEL; // brillo guardado (persistente) 0..(2^RES-1)
-static uint32_t     s_autoOffStart = 0;           // se arma al terminar movimiento
 static bool         s_fading = false;             // hay fade en curso (auto-off o OFF manual)
-static uint32_t     s_lastFadeStep = 0;           // control de cadencia del fade
 static uint16_t     s_fadeLevel = 0;              // nivel actual durante fade (ambas tiras igual)
 
 static bool         s_breath_user = false;        // respiración solicitada por MQTT en reposo
-static float        s_breath_phase = 0.0f;        // 0..1
-static uint32_t     s_lastRespUpdate = 0;
+static uint16_t     s_breath_phase = 0;           // 0..65535 = un periodo
 static EstadoPuerta s_prevEstado = DETENIDO;
 
-static Preferences  s_prefs;                      // NVS para el brillo guardado
+static volatile bool s_fullRequested = false;     // petición desde otra tarea
+static bool         s_pubOn = false;              // último estado publicado (TOPIC_LIGHT_STATE)
+
+// Trabajos del planificador (tarea de red): respiración periódica, pasos de
+// fade y auto-off (un disparo, se arma al terminar movimiento)
+static SchedJob     s_jobBreath, s_jobFade, s_jobAutoOff;
+
+static uint16_t     s_fadeDrop = 0;               // niveles por segmento de fade
+static uint32_t     s_fadeSegMs = 0;
 
 // =============== Helpers PWM ===============
 static inline uint16_t levelMax() { return (1U << LIGHT_PWM_RES_BITS) - 1U; }
@@ -39,27 +101,86 @@ static inline uint16_t clampLevel(uint32_t v) {
 static inline uint16_t applyActive(uint16_t raw) {
   return (LIGHT_ACTIVE_LVL == HIGH) ? raw : (uint16_t)(levelMax() - raw);
 }
-static void writePWMToPin(uint8_t pin, uint16_t raw) {
+
+// Nivel perceptual (0..levelMax) → duty lineal
+static uint16_t gammaDuty(uint16_t level) {
+#if LIGHT_GAMMA_ENABLED
+  uint32_t x   = (uint32_t)level * 256U;                 // posición Q(RES) en la tabla
+  uint32_t idx = x / levelMax();
+  uint32_t fr  = x % levelMax();
+  uint32_t g   = GAMMA_Q16[idx];
+  if (idx < 256) g += ((GAMMA_Q16[idx + 1] - g) * fr) / levelMax();
+  uint32_t duty = (g * levelMax() + 32768U) >> 16;
+  if (duty == 0 && level > 0) duty = 1;                  // encendida nunca es negro
+  return (uint16_t)duty;
+#else
+  return level;
+#endif
+}
+
+#ifdef LIGHT_PIN2
+static const uint8_t PINS[2] = { LIGHT_PIN, LIGHT_PIN2 };
+#else
+static const uint8_t PINS[1] = { LIGHT_PIN };
+#endif
+static const uint8_t PIN_COUNT = sizeof(PINS);
+static uint16_t      s_duty[2] = { 0, 0 };              // último duty programado (sin invertir)
+static bool          s_hwFade[2] = { false, false };    // puede haber un segmento hardware en curso
+
+#if LIGHT_PWM_ENABLED
+// Con un fade en curso, ledcWrite() y ledcFade() esperan a que termine el
+// segmento (hasta ~190 ms): los cambios inmediatos lo cortan antes
+static void stopFade(uint8_t idx) {
+  if (!s_hwFade[idx]) return;
+  s_hwFade[idx] = false;
+  const ledc_channel_handle_t* bus = (const ledc_channel_handle_t*)perimanGetPinBus(PINS[idx], ESP32_BUS_TYPE_LEDC);
+  if (bus)
+    ledc_fade_stop((ledc_mode_t)(bus->channel / SOC_LEDC_CHANNEL_NUM),
+                   (ledc_channel_t)(bus->channel % SOC_LEDC_CHANNEL_NUM));
+}
+#endif
+
+static void writePWMToPin(uint8_t idx, uint16_t level) {
 #if LIGHT_PWM_ENABLED
-  ledcWrite(pin, applyActive(raw)); // core 3.x: write por pin
+  stopFade(idx);
+  s_duty[idx] = gammaDuty(level);
+  ledcWrite(PINS[idx], applyActive(s_duty[idx])); // core 3.x: write por pin
 #else
   // sin PWM: binario
-  digitalWrite(pin, (s_on ? LIGHT_ACTIVE_LVL : (LIGHT_ACTIVE_LVL == HIGH ? LOW : HIGH)));
+  (void)level;
+  digitalWrite(PINS[idx], (s_on ? LIGHT_ACTIVE_LVL : (LIGHT_ACTIVE_LVL == HIGH ? LOW : HIGH)));
+#endif
+}
+
+// Segmento hardware desde el duty actual hasta 'level' en 'ms' (no bloquea).
+// Los segmentos terminan antes del siguiente programado; un cambio inmediato
+// (writePWMToPin) corta el que esté en curso.
+static void fadePinTo(uint8_t idx, uint16_t level, uint32_t ms) {
+#if LIGHT_PWM_ENABLED
+  uint16_t target = gammaDuty(level);
+  if (target != s_duty[idx]) {
+    ledcFade(PINS[idx], applyActive(s_duty[idx]), applyActive(target), (int)ms);
+    s_hwFade[idx] = true;
+  }
+  s_duty[idx] = target;
+#else
+  (void)idx; (void)level; (void)ms;
 #endif
 }
 
 // =============== Respiración ===============
-static inline float breathFactor(float phase01) {
-  float s = sinf(phase01 * 2.0f * (float)M_PI); // -1..+1
-  float x = (s + 1.0f) * 0.5f;                  // 0..1
-  return BREATH_MIN + (BREATH_MAX - BREATH_MIN) * x;
+// Factor Q8 (BREATH_MIN_Q8..BREATH_MAX_Q8) para una fase de 16 bits
+static inline uint16_t breathFactorQ8(uint16_t phase) {
+  return BREATH_MIN_Q8 + (uint16_t)(((BREATH_MAX_Q8 - BREATH_MIN_Q8) * BREATH_WAVE[phase >> 8]) >> 8);
 }
 
-// =============== Salida ===============
-static void applyOutput() {
-#if LIGHT_PWM_ENABLED
-  uint16_t level1 = 0, level2 = 0;
+static inline uint16_t breathLevel(uint16_t base, uint16_t phase) {
+  return clampLevel(((uint32_t)base * breathFactorQ8(phase)) >> 8);
+}
 
+// =============== Salida ===============
+// Niveles perceptuales de cada tira para la fase de respiración dada
+static void computeLevels(uint16_t phase, uint16_t& level1, uint16_t& level2) {
   if (!s_on) {
     level1 = level2 = 0;
   } else if (s_fading) {
@@ -72,52 +193,73 @@ static void applyOutput() {
     const uint16_t baseMoving = (uint16_t)((uint32_t)s_user_max * 40U / 100U); // 40% guardado
 
     if (e == ABRIENDO || e == CERRANDO) {
-      // Respiración alternada en movimiento (suave, no llega a negro)
-      float ph = s_breath_phase;
-      float f1 = breathFactor(ph);
-      float f2 = breathFactor(fmodf(ph + 0.5f, 1.0f)); // 180° de desfase
-      level1 = clampLevel((uint32_t)(baseMoving * f1));
-      level2 = clampLevel((uint32_t)(baseMoving * f2));
+      // Respiración alternada en movimiento (suave, no llega a negro), 180° de desfase
+      level1 = breathLevel(baseMoving, phase);
+      level2 = breathLevel(baseMoving, (uint16_t)(phase + 0x8000U));
+    } else if (s_breath_user) {
+      level1 = breathLevel(baseRest, phase);
+      level2 = breathLevel(baseRest, (uint16_t)(phase + 0x8000U));
     } else {
       // Reposo
-      if (s_breath_user) {
-        float ph = s_breath_phase;
-        float f1 = breathFactor(ph);
-        float f2 = breathFactor(fmodf(ph + 0.5f, 1.0f));
-        level1 = clampLevel((uint32_t)(baseRest * f1));
-        level2 = clampLevel((uint32_t)(baseRest * f2));
-      } else {
-        level1 = level2 = baseRest;
-      }
+      level1 = level2 = baseRest;
     }
   }
+}
 
-  writePWMToPin(LIGHT_PIN, clampLevel(level1));
-  #ifdef LIGHT_PIN2
-  writePWMToPin(LIGHT_PIN2, clampLevel(level2));
-  #endif
-
-#else
-  // Modo binario sin PWM
-  if (s_on) {
-    digitalWrite(LIGHT_PIN, LIGHT_ACTIVE_LVL);
-    #ifdef LIGHT_PIN2
-    digitalWrite(LIGHT_PIN2, LIGHT_ACTIVE_LVL);
-    #endif
-  } else {
-    digitalWrite(LIGHT_PIN, (LIGHT_ACTIVE_LVL == HIGH) ? LOW : HIGH);
-    #ifdef LIGHT_PIN2
-    digitalWrite(LIGHT_PIN2, (LIGHT_ACTIVE_LVL == HIGH) ? LOW : HIGH);
-    #endif
-  }
-#endif
+// Escritura inmediata (sin PWM: binario según s_on)
+static void applyOutput() {
+  uint16_t level[2];
+  computeLevels(s_breath_phase, level[0], level[1]);
+  for (uint8_t i = 0; i < PIN_COUNT; ++i) writePWMToPin(i, level[i]);
 }
 
 // =============== Persistencia ===============
 static void persist_user_max(uint16_t lvl) {
-  s_prefs.begin("light", false);       // false -> RW (guardar)
-  s_prefs.putUShort("max", lvl);
-  s_prefs.end();
+  cfg_set_i(CFG_LIGHT_MAX, lvl);       // escritura diferida (cfgstore)
+}
+
+// =============== Trabajos planificados ===============
+// Respiración (solo si ON y no hay fade): programa el segmento hasta la
+// siguiente muestra; el LEDC interpola entre medias
+static void breathStep(uint32_t) {
+  if (!s_on || s_fading) return;
+  if (!s_breath_user && getEstado() == DETENIDO) return;   // reposo fijo
+  s_breath_phase = (uint16_t)(s_breath_phase + 0x10000UL / RESP_SEGMENTS);
+  uint16_t level[2];
+  computeLevels(s_breath_phase, level[0], level[1]);
+  for (uint8_t i = 0; i < PIN_COUNT; ++i) fadePinTo(i, level[i], RESP_SEG_MS - SEG_GUARD_MS);
+}
+
+// Fade (manual OFF o auto-off): FADE_SEGMENTS segmentos hardware con la
+// misma duración total que la rampa de FADE_STEP cada FADE_STEP_MS
+static void fadeStep(uint32_t) {
+  if (!s_fading) return;
+  if (s_fadeLevel == 0) {
+    s_on = false;
+    s_fading = false;
+    applyOutput();
+    return;
+  }
+  s_fadeLevel = (s_fadeLevel > s_fadeDrop) ? (uint16_t)(s_fadeLevel - s_fadeDrop) : 0;
+  for (uint8_t i = 0; i < PIN_COUNT; ++i) fadePinTo(i, s_fadeLevel, s_fadeSegMs - SEG_GUARD_MS);
+  sched_after(s_jobFade, s_fadeSegMs);
+}
+
+static void startFade() {
+  s_fading = true;
+  s_fadeLevel = s_user_max;   // arranca desde el 100% guardado
+  uint32_t totalMs = ((uint32_t)s_fadeLevel + FADE_STEP - 1) / FADE_STEP * FADE_STEP_MS;
+  s_fadeDrop  = (uint16_t)((s_fadeLevel + FADE_SEGMENTS - 1) / FADE_SEGMENTS);
+  s_fadeSegMs = totalMs / FADE_SEGMENTS;
+  if (s_fadeSegMs <= SEG_GUARD_MS) s_fadeSegMs = SEG_GUARD_MS + 1;
+  applyOutput();              // punto de partida
+  fadeStep(millis());         // primer segmento ya
+}
+
+// Auto-off solo cuando estamos en reposo, ON, sin fade manual
+static void autoOffFire(uint32_t) {
+  if (s_fading || !s_on || getEstado() != DETENIDO) return;
+  startFade();                // el fade se encarga de apagar
 }
 
 // =============== API pública ===============
@@ -135,20 +277,20 @@ void light_begin() {
 #endif
 
   // Cargar brillo guardado (si no hay, usa por defecto)
-  s_prefs.begin("light", true);        // true -> RO (leer)
-  uint16_t stored = s_prefs.getUShort("max", clampLevel(LIGHT_DEFAULT_LEVEL));
-  s_prefs.end();
+  uint16_t stored = (uint16_t)cfg_get_i(CFG_LIGHT_MAX, clampLevel(LIGHT_DEFAULT_LEVEL));
   s_user_max = clampLevel(stored);
 
   s_on = false;
   s_fading = false;
   s_fadeLevel = 0;
-  s_autoOffStart = 0;
   s_breath_user = false;
-  s_breath_phase = 0.0f;
-  s_lastRespUpdate = 0;
+  s_breath_phase = 0;
   s_prevEstado = getEstado();
 
+  sched_every(s_jobBreath, SCHED_NET, "l_breath", RESP_SEG_MS, 3, breathStep);
+  sched_once(s_jobFade,    SCHED_NET, "l_fade",    3, fadeStep);
+  sched_once(s_jobAutoOff, SCHED_NET, "l_autooff", 4, autoOffFire);
+
   applyOutput();
 }
 
@@ -157,18 +299,16 @@ void light_on() {
   s_fading = false;
   s_on = true;
   s_fadeLevel = s_user_max; // por consistencia
-  s_autoOffStart = 0;       // encendido manual no arma auto-off
+  sched_cancel(s_jobFade);
+  sched_cancel(s_jobAutoOff); // encendido manual no arma auto-off
   applyOutput();
 }
 
 void light_off() {
   // Iniciar fade manual desde el nivel guardado
   s_on = true;          // para poder hacer fade
-  s_fading = true;
-  s_fadeLevel = s_user_max;
-  s_lastFadeStep = millis();
-  s_autoOffStart = 0;   // cortar auto-off en curso (esto es un OFF manual)
-  applyOutput();
+  sched_cancel(s_jobAutoOff);   // cortar auto-off en curso (esto es un OFF manual)
+  startFade();
 }
 
 void light_toggle() {
@@ -211,32 +351,16 @@ void light_set_breath_mode(bool enable) {
 
 bool light_get_breath_mode() { return s_breath_user; }
 
-// =============== TICK: animaciones, auto-off, transiciones ===============
+void light_request_full() { s_fullRequested = true; }
+
+// =============== TICK: transiciones (animaciones y auto-off son trabajos) ===============
 void light_tick(uint32_t now) {
   EstadoPuerta e = getEstado();
 
-  // Respiración (solo si ON y no hay fade)
-  if (s_on && !s_fading && (now - s_lastRespUpdate >= RESP_UPDATE_MS)) {
-    s_lastRespUpdate = now;
-    float d = (float)RESP_UPDATE_MS / (float)RESP_PERIOD_MS; // 0..1 por ciclo
-    s_breath_phase += d;
-    if (s_breath_phase >= 1.0f) s_breath_phase -= 1.0f;
-    applyOutput();
-  }
-
-  // Fade (manual OFF o auto-off)
-  if (s_fading && (now - s_lastFadeStep >= FADE_STEP_MS)) {
-    s_lastFadeStep = now;
-    if (s_fadeLevel > 0) {
-      s_fadeLevel = (s_fadeLevel > FADE_STEP) ? (uint16_t)(s_fadeLevel - FADE_STEP) : 0;
-      applyOutput();
-    }
-    if (s_fadeLevel == 0) {
-      s_on = false;
-      s_fading = false;
-      s_autoOffStart = 0; // por si vino de auto-off
-      applyOutput();
-    }
+  if (s_fullRequested) {
+    s_fullRequested = false;
+    light_set_level(levelMax());
+    light_on();
   }
 
   // Cambio de estado de puerta
@@ -245,29 +369,26 @@ void light_tick(uint32_t now) {
       // Entramos en movimiento: ON, respirar al 40%, sin auto-off ni fade activos
       s_on = true;
       s_fading = false;
-      s_autoOffStart = 0;
+      sched_cancel(s_jobFade);
+      sched_cancel(s_jobAutoOff);
       s_breath_user = false;  // en movimiento solo respiración automática
       applyOutput();
     } else {
       // Se detuvo: ON al 100% guardado y armar auto-off
       s_on = true;
       s_fading = false;
+      sched_cancel(s_jobFade);
       s_fadeLevel = s_user_max;
       applyOutput();
-      s_autoOffStart = now;   // aquí arranca el contador (p.ej. 15 s o 15 min)
+      sched_after(s_jobAutoOff, params.lightAutoOffMs);  // aquí arranca el contador (p.ej. 15 s o 15 min)
     }
     s_prevEstado = e;
   }
 
-  // Auto-off solo cuando estamos en reposo, ON, sin fade manual
-  if (s_autoOffStart && !s_fading && s_on && (e == DETENIDO)) {
-    if (now - s_autoOffStart >= LIGHT_AUTO_OFF_MS) {
-      // Disparar fade de auto-off
-      s_fading = true;
-      s_fadeLevel = s_user_max;  // arranca desde el 100% guardado
-      s_lastFadeStep = now;
-      s_autoOffStart = 0;        // desarma el contador; fade se encarga de apagar
-      applyOutput();
-    }
+  // Encendidos/apagados automáticos (movimiento, auto-off, safety) también
+  // al topic retenido; la cola de salida descarta lo repetido
+  if (s_on != s_pubOn) {
+    s_pubOn = s_on;
+    net_mqtt_publish(TOPIC_LIGHT_STATE, s_on ? "ON" : "OFF", true);
   }
 }
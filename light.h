@@ -13,6 +13,10 @@ void light_set_level(uint16_t level);   // 0..(2^res-1)
 uint16_t light_get_level();
 void light_set_percent(uint8_t pct);    // 0..100
 
+// Seguro desde otra tarea: en el próximo light_tick() fija el brillo al
+// máximo (persistente) y enciende. Lo usa safety en paradas de emergencia.
+void light_request_full();
+
 // Nuevas funciones para modo respiración a full brightness
 void light_set_breath_mode(bool enable);
 bool light_get_breath_mode();
\ No newline at end of file
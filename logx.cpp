@@ -1,41 +1,414 @@
 #include "logx.h"
 #include <stdarg.h>
 #include "net.h"
-#include "config.h"
+#include "tasks.h"
 
-// Buffer circular sencillo para cuando MQTT aún no conecta
-static const size_t LOG_BUFFER_MAX = 50;
-static String logBuffer[LOG_BUFFER_MAX];
-static size_t logHead = 0, logTail = 0;
-static inline bool logBufEmpty() { return logHead == logTail; }
-static inline bool logBufFull()  { return ((logHead + 1) % LOG_BUFFER_MAX) == logTail; }
-static void logBufPush(const String& s) { if (logBufFull()) logTail = (logTail + 1) % LOG_BUFFER_MAX; logBuffer[logHead] = s; logHead = (logHead + 1) % LOG_BUFFER_MAX; }
-static bool logBufPop(String& out) { if (logBufEmpty()) return false; out = logBuffer[logTail]; logTail = (logTail + 1) % LOG_BUFFER_MAX; return true; }
+// Registro en el anillo: [nivel][longitud][id u32][ms u32][fmt*][argumentos...]
+// (bit 7 del nivel = argumentos recortados). En MQTT binario viaja igual pero
+// sin el puntero al formato: [nivel][long. args][id][ms][argumentos].
+static const uint32_t RING = LOG_RING_BYTES;
+static_assert((RING & (RING - 1)) == 0, "LOG_RING_BYTES debe ser potencia de 2");
 
-void logPrint(const String& s) {
-  Serial.print(s);
-  if (net_mqtt_connected()) net_mqtt_publish(TOPIC_LOG, s, false);
-  else logBufPush(s);
+static const size_t  REC_HDR   = 4 + 4 + sizeof(const char*);   // id + ms + fmt
+static const size_t  ARGS_MAX  = 255 - REC_HDR;
+static const uint8_t LVL_CUT   = 0x80;
+static_assert(LOG_RING_BYTES >= 2 + 255, "LOG_RING_BYTES demasiado pequeño");
+
+enum LogSink : uint8_t { SINK_SERIAL = 0, SINK_MQTT = 1, SINK_COUNT };
+
+static uint8_t  ring[RING];
+static uint32_t head = 0;                 // contadores absolutos (índice = x & (RING-1))
+static uint32_t tail[SINK_COUNT] = {0, 0};
+static LogStats stats = {};
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+static bool mqttBinary = (LOG_MQTT_BINARY != 0);
+
+static inline uint8_t ringAt(uint32_t pos) { return ring[pos & (RING - 1)]; }
+
+static void ringCopyIn(uint32_t pos, const uint8_t* src, size_t n) {
+  uint32_t i = pos & (RING - 1);
+  size_t first = (n < RING - i) ? n : (RING - i);
+  memcpy(&ring[i], src, first);
+  if (n > first) memcpy(&ring[0], src + first, n - first);
+}
+
+static void ringCopyOut(uint32_t pos, uint8_t* dst, size_t n) {
+  uint32_t i = pos & (RING - 1);
+  size_t first = (n < RING - i) ? n : (RING - i);
+  memcpy(dst, &ring[i], first);
+  if (n > first) memcpy(dst + first, &ring[0], n - first);
+}
+
+// Escritura (cualquier tarea). Nunca espera: si falta sitio, la salida más
+// retrasada pierde sus registros más antiguos.
+static void ringPush(uint8_t level, const uint8_t* payload, size_t len) {
+  const uint32_t need = 2 + len;
+  uint8_t hdr[2] = { level, (uint8_t)len };
+
+  portENTER_CRITICAL(&logMux);
+  for (int s = 0; s < SINK_COUNT; ++s) {
+    while (RING - (head - tail[s]) < need) {
+      tail[s] += 2 + ringAt(tail[s] + 1);
+      if (s == SINK_SERIAL) stats.dropSerial++;
+      else                  stats.dropMqtt++;
+    }
+  }
+  ringCopyIn(head, hdr, 2);
+  ringCopyIn(head + 2, payload, len);
+  head += need;
+  stats.lines++;
+  if (level & LVL_CUT) stats.truncated++;
+  for (int s = 0; s < SINK_COUNT; ++s) {
+    uint32_t used = head - tail[s];
+    if (used > stats.highWater) stats.highWater = used;
+  }
+  portEXIT_CRITICAL(&logMux);
+}
+
+// Copia el registro más antiguo pendiente para una salida sin consumirlo
+static bool ringPeek(LogSink s, uint32_t& pos, uint8_t& level, uint8_t* out, size_t& len) {
+  bool ok = false;
+  portENTER_CRITICAL(&logMux);
+  if (head != tail[s]) {
+    pos   = tail[s];
+    level = ringAt(pos);
+    len   = ringAt(pos + 1);
+    ringCopyOut(pos + 2, out, len);
+    ok = true;
+  }
+  portEXIT_CRITICAL(&logMux);
+  return ok;
+}
+
+// Como ringPeek, pero en pos (un registro entre el cursor y head); false si
+// no hay más o si pos ya se ha descartado
+static bool ringPeekAt(LogSink s, uint32_t pos, uint8_t& level, uint8_t* out, size_t& len) {
+  bool ok = false;
+  portENTER_CRITICAL(&logMux);
+  if (pos - tail[s] < head - tail[s]) {
+    level = ringAt(pos);
+    len   = ringAt(pos + 1);
+    ringCopyOut(pos + 2, out, len);
+    ok = true;
+  }
+  portEXIT_CRITICAL(&logMux);
+  return ok;
+}
+
+// Consume los registros [from, to) ya enviados; si el anillo descartó parte
+// de ellos mientras tanto, el cursor solo avanza hasta to
+static void ringConsume(LogSink s, uint32_t from, uint32_t to) {
+  portENTER_CRITICAL(&logMux);
+  if (tail[s] - from <= to - from) tail[s] = to;
+  portEXIT_CRITICAL(&logMux);
+}
+
+// =====================================================
+//        Especificadores de formato (subconjunto printf)
+// =====================================================
+// Tamaños en crudo: enteros 4 bytes (8 con ll/j), %c 1 byte, flotantes como
+// float de 4 bytes, %s como [n u8][n bytes] (n <= LOG_STR_MAX), %p 4 bytes,
+// y cada '*' de ancho/precisión como int de 4 bytes antes del valor.
+// tools/logdecode.py sigue exactamente las mismas reglas.
+
+static const int SPEC_NONE = -1;
+static const int SPEC_STAR = -2;
+
+struct FmtSpec {
+  char flags[6];
+  int  width;
+  int  prec;
+  char lmod;     // 0, 'h', 'l', 'z', 't', 'L', o 'q' = ll / j (8 bytes)
+  char conv;
+};
+
+// f apunta justo después de '%'; devuelve el puntero tras la conversión
+static const char* parseSpec(const char* f, FmtSpec& s) {
+  uint8_t nf = 0;
+  while (*f && strchr("-+ #0", *f)) { if (nf < sizeof(s.flags) - 1) s.flags[nf++] = *f; ++f; }
+  s.flags[nf] = '\0';
+
+  s.width = SPEC_NONE;
+  if (*f == '*') { s.width = SPEC_STAR; ++f; }
+  else if (*f >= '0' && *f <= '9') { s.width = 0; while (*f >= '0' && *f <= '9') s.width = s.width * 10 + (*f++ - '0'); }
+
+  s.prec = SPEC_NONE;
+  if (*f == '.') {
+    ++f;
+    if (*f == '*') { s.prec = SPEC_STAR; ++f; }
+    else { s.prec = 0; while (*f >= '0' && *f <= '9') s.prec = s.prec * 10 + (*f++ - '0'); }
+  }
+
+  s.lmod = 0;
+  if (f[0] == 'l' && f[1] == 'l')      { s.lmod = 'q'; f += 2; }
+  else if (f[0] == 'h' && f[1] == 'h') { s.lmod = 'h'; f += 2; }
+  else if (*f == 'j')                  { s.lmod = 'q'; ++f; }
+  else if (*f && strchr("hlztL", *f))  { s.lmod = *f++; }
+
+  s.conv = *f;
+  return *f ? f + 1 : f;
+}
+
+struct ArgWriter {
+  uint8_t* p;
+  size_t   cap;
+  size_t   n;
+  bool     cut;
+  void put(const void* src, size_t k) {
+    if (cut) return;
+    if (n + k > cap) { cut = true; return; }
+    memcpy(p + n, src, k);
+    n += k;
+  }
+};
+
+// Copia los argumentos en crudo según el formato (sin formatear nada)
+static size_t encodeArgs(const char* fmt, va_list ap, uint8_t* out, size_t cap, bool& cut) {
+  ArgWriter w = { out, cap, 0, false };
+  bool strCut = false;   // algún %s recortado a LOG_STR_MAX (los demás se siguen copiando)
+  for (const char* f = fmt; *f && !w.cut; ) {
+    if (*f++ != '%') continue;
+    if (*f == '%') { ++f; continue; }
+
+    FmtSpec s;
+    f = parseSpec(f, s);
+
+    int prec = s.prec;
+    if (s.width == SPEC_STAR) { int32_t v = va_arg(ap, int); w.put(&v, 4); }
+    if (s.prec  == SPEC_STAR) { int32_t v = va_arg(ap, int); w.put(&v, 4); prec = v; }
+
+    switch (s.conv) {
+      case 'd': case 'i':
+        if (s.lmod == 'q')      { int64_t v = va_arg(ap, long long); w.put(&v, 8); }
+        else if (s.lmod == 'l') { int32_t v = (int32_t)va_arg(ap, long); w.put(&v, 4); }
+        else if (s.lmod == 'z') { int32_t v = (int32_t)va_arg(ap, size_t); w.put(&v, 4); }
+        else if (s.lmod == 't') { int32_t v = (int32_t)va_arg(ap, ptrdiff_t); w.put(&v, 4); }
+        else                    { int32_t v = va_arg(ap, int); w.put(&v, 4); }
+        break;
+      case 'u': case 'x': case 'X': case 'o':
+        if (s.lmod == 'q')      { uint64_t v = va_arg(ap, unsigned long long); w.put(&v, 8); }
+        else if (s.lmod == 'l') { uint32_t v = (uint32_t)va_arg(ap, unsigned long); w.put(&v, 4); }
+        else if (s.lmod == 'z') { uint32_t v = (uint32_t)va_arg(ap, size_t); w.put(&v, 4); }
+        else if (s.lmod == 't') { uint32_t v = (uint32_t)va_arg(ap, ptrdiff_t); w.put(&v, 4); }
+        else                    { uint32_t v = va_arg(ap, unsigned int); w.put(&v, 4); }
+        break;
+      case 'c': { uint8_t v = (uint8_t)va_arg(ap, int); w.put(&v, 1); } break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        if (s.lmod == 'L') { float v = (float)va_arg(ap, long double); w.put(&v, 4); break; }
+        { float v = (float)va_arg(ap, double); w.put(&v, 4); } break;
+      case 's': {
+        const char* str = va_arg(ap, const char*);
+        if (!str) str = "(null)";
+        size_t lim = (prec >= 0 && prec < LOG_STR_MAX) ? (size_t)prec : LOG_STR_MAX;
+        uint8_t n = 0;
+        while (n < lim && str[n]) ++n;
+        // Cortar donde pide la precisión no es recorte; cortar por LOG_STR_MAX sí
+        if (n == LOG_STR_MAX && str[n] && prec != LOG_STR_MAX) strCut = true;
+        w.put(&n, 1);
+        w.put(str, n);
+      } break;
+      case 'p': { uint32_t v = (uint32_t)(uintptr_t)va_arg(ap, void*); w.put(&v, 4); } break;
+      case 'n': (void)va_arg(ap, void*); break;
+      default:  f = ""; break;   // conversión desconocida: no seguir
+    }
+  }
+  cut = w.cut || strCut;
+  return w.n;
+}
+
+struct ArgReader {
+  const uint8_t* p;
+  size_t         len;
+  size_t         n;
+  bool           ok;
+  void get(void* dst, size_t k) {
+    if (!ok || n + k > len) { ok = false; memset(dst, 0, k); return; }
+    memcpy(dst, p + n, k);
+    n += k;
+  }
+};
+
+// Reconstruye el texto a partir del formato y los argumentos en crudo
+static size_t formatRecord(const char* fmt, const uint8_t* args, size_t alen, bool cut,
+                           char* out, size_t cap) {
+  TextBuf tb(out, cap);
+  ArgReader r = { args, alen, 0, true };
+
+  for (const char* f = fmt; *f && r.ok; ) {
+    if (*f != '%') { tb.ch(*f++); continue; }
+    ++f;
+    if (*f == '%') { tb.ch('%'); ++f; continue; }
+
+    FmtSpec s;
+    f = parseSpec(f, s);
+
+    int32_t width = s.width, prec = s.prec;
+    if (s.width == SPEC_STAR) r.get(&width, 4);
+    if (s.prec  == SPEC_STAR) r.get(&prec, 4);
+
+    // Especificador sin modificadores de longitud (los valores ya tienen tamaño fijo)
+    StackText<24> sp;
+    sp.ch('%').str(s.flags);
+    if (width >= 0) sp.num(width);
+    if (prec >= 0)  sp.ch('.').num(prec);
+
+    char piece[64];
+    piece[0] = '\0';
+    switch (s.conv) {
+      case 'd': case 'i':
+        if (s.lmod == 'q') { int64_t v; r.get(&v, 8); sp.str("ll").ch(s.conv); snprintf(piece, sizeof(piece), sp.c_str(), (long long)v); }
+        else        { int32_t v; r.get(&v, 4); sp.ch(s.conv); snprintf(piece, sizeof(piece), sp.c_str(), (int)v); }
+        break;
+      case 'u': case 'x': case 'X': case 'o':
+        if (s.lmod == 'q') { uint64_t v; r.get(&v, 8); sp.str("ll").ch(s.conv); snprintf(piece, sizeof(piece), sp.c_str(), (unsigned long long)v); }
+        else        { uint32_t v; r.get(&v, 4); sp.ch(s.conv); snprintf(piece, sizeof(piece), sp.c_str(), (unsigned)v); }
+        break;
+      case 'c': { uint8_t v; r.get(&v, 1); sp.ch('c'); snprintf(piece, sizeof(piece), sp.c_str(), (int)v); } break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        { float v; r.get(&v, 4); sp.ch(s.conv); snprintf(piece, sizeof(piece), sp.c_str(), (double)v); } break;
+      case 's': {
+        uint8_t n = 0;
+        r.get(&n, 1);
+        char str[LOG_STR_MAX + 1];
+        if (n > LOG_STR_MAX) { n = 0; r.ok = false; }
+        r.get(str, n);
+        str[r.ok ? n : 0] = '\0';
+        sp.ch('s');
+        snprintf(piece, sizeof(piece), sp.c_str(), str);
+      } break;
+      case 'p': { uint32_t v; r.get(&v, 4); snprintf(piece, sizeof(piece), "0x%08x", (unsigned)v); } break;
+      case 'n': break;
+      default:  f = ""; break;
+    }
+    if (r.ok) tb.str(piece);
+  }
+  if (cut || !r.ok) tb.str("…\n");
+  return tb.length();
+}
+
+// Registro completo (cabecera del anillo incluida) -> texto
+static size_t recordToText(const uint8_t* rec, size_t len, uint8_t level, char* out, size_t cap) {
+  const char* fmt;
+  memcpy(&fmt, rec + 8, sizeof(fmt));
+  return formatRecord(fmt, rec + REC_HDR, len - REC_HDR, (level & LVL_CUT) != 0, out, cap);
+}
+
+// =====================================================
+//                      SALIDAS
+// =====================================================
+
+static void drainSerial() {
+  uint8_t rec[255];
+  char line[LOG_LINE_MAX + 1];
+  uint32_t pos;
+  uint8_t level;
+  size_t len;
+  while (ringPeek(SINK_SERIAL, pos, level, rec, len)) {
+    size_t n = recordToText(rec, len, level, line, sizeof(line));
+    if ((size_t)Serial.availableForWrite() < n) break;   // UART lleno: sigue en el anillo
+    Serial.write((const uint8_t*)line, n);
+    ringConsume(SINK_SERIAL, pos, pos + 2 + len);
+  }
 }
 
-void logPrintln(const String& s) {
-  Serial.println(s);
-  String out = s; out += "\n";
-  if (net_mqtt_connected()) net_mqtt_publish(TOPIC_LOG, out, false);
-  else logBufPush(out);
+// Si la cola de salida MQTT no admite la publicación, los registros se
+// quedan en el anillo para la próxima pasada: solo se pierden si el anillo
+// se llena y pasa por encima del cursor MQTT (stats.dropMqtt).
+static_assert(LOG_LINE_MAX <= MQTT_BUFFER_BYTES && LOG_BIN_BATCH <= MQTT_BUFFER_BYTES,
+              "Un lote o línea de log debe caber en la cola de salida MQTT");
+
+static void drainMqttText() {
+  uint8_t rec[255];
+  char line[LOG_LINE_MAX + 1];
+  uint32_t pos;
+  uint8_t level;
+  size_t len;
+  for (int n = 0; n < LOG_MQTT_BURST && ringPeek(SINK_MQTT, pos, level, rec, len); ++n) {
+    size_t tl = recordToText(rec, len, level, line, sizeof(line));
+    if (!net_mqtt_publish(TOPIC_LOG, (const uint8_t*)line, tl, false, true)) break;
+    ringConsume(SINK_MQTT, pos, pos + 2 + len);
+  }
 }
 
-void logPrintf(const char* fmt, ...) {
-  char buf[256];
+static void drainMqttBinary() {
+  uint8_t batch[LOG_BIN_BATCH];
+  uint8_t rec[255];
+  uint32_t first;
+  uint8_t level;
+  size_t len;
+
+  for (int n = 0; n < LOG_MQTT_BURST && ringPeek(SINK_MQTT, first, level, rec, len); ++n) {
+    if (2 + 8 + (len - REC_HDR) > sizeof(batch)) {   // no cabe ni solo: se descarta
+      ringConsume(SINK_MQTT, first, first + 2 + len);
+      portENTER_CRITICAL(&logMux);
+      stats.dropMqtt++;
+      portEXIT_CRITICAL(&logMux);
+      continue;
+    }
+    // Lote con los registros que quepan; se consumen solo si se admite
+    uint32_t pos = first;
+    size_t used = 0;
+    do {
+      const size_t alen = len - REC_HDR;     // sin el puntero al formato
+      if (used + 2 + 8 + alen > sizeof(batch)) break;
+      batch[used++] = level;
+      batch[used++] = (uint8_t)alen;
+      memcpy(&batch[used], rec, 8);           // id + ms
+      memcpy(&batch[used + 8], rec + REC_HDR, alen);
+      used += 8 + alen;
+      pos += 2 + len;
+    } while (ringPeekAt(SINK_MQTT, pos, level, rec, len));
+
+    if (!net_mqtt_publish(TOPIC_LOG_BIN, batch, used, false, true)) break;
+    ringConsume(SINK_MQTT, first, pos);
+  }
+}
+
+// =====================================================
+//                        API
+// =====================================================
+
+void logx_tok(uint8_t level, uint32_t id, const char* fmt, ...) {
+  uint8_t rec[REC_HDR + ARGS_MAX];
+  uint32_t ms = millis();
+  memcpy(&rec[0], &id, 4);
+  memcpy(&rec[4], &ms, 4);
+  memcpy(&rec[8], &fmt, sizeof(fmt));
+
+  bool cut = false;
   va_list args; va_start(args, fmt);
-  vsnprintf(buf, sizeof(buf), fmt, args);
+  size_t alen = encodeArgs(fmt, args, rec + REC_HDR, ARGS_MAX, cut);
   va_end(args);
-  logPrint(String(buf));
+
+  ringPush(level | (cut ? LVL_CUT : 0), rec, REC_HDR + alen);
+  // Antes de arrancar las tareas (setup) o desde la propia tarea de red,
+  // Serial se vuelca ya; nunca bloquea
+  if (tasks_in_net_context()) drainSerial();
 }
 
-void logx_on_mqtt_connected() {
-  // Volcar lo pendiente
+void logx_set_mqtt_binary(bool on) {
+  mqttBinary = on;
+}
+
+bool logx_mqtt_binary() {
+  return mqttBinary;
+}
+
+void logx_flush() {
+  // Solo desde la tarea de red
+  if (!tasks_in_net_context()) return;
+  drainSerial();
   if (!net_mqtt_connected()) return;
-  String line;
-  while (logBufPop(line)) net_mqtt_publish(TOPIC_LOG, line, false);
-}
\ No newline at end of file
+  if (mqttBinary) drainMqttBinary();
+  else            drainMqttText();
+}
+
+void logx_on_mqtt_connected() {
+  logx_flush();
+}
+
+void logx_get_stats(LogStats& out) {
+  portENTER_CRITICAL(&logMux);
+  out = stats;
+  portEXIT_CRITICAL(&logMux);
+}
@@ -1,9 +1,73 @@
 #pragma once
 #include <Arduino.h>
+#include <type_traits>
+#include "config.h"
+#include "msgbuf.h"   // fnv1a32
 
-void logPrint(const String& s);
-void logPrintln(const String& s);
-void logPrintf(const char* fmt, ...);
+// =====================================================
+//                 LOG (anillo + volcado asíncrono)
+// =====================================================
+// Formato diferido: cada llamada guarda en un anillo de bytes fijo (sin heap)
+// el ID del formato (hash FNV-1a calculado en compilación), la marca de
+// tiempo y los argumentos en crudo; no se formatea nada en la llamada. La
+// tarea de red vuelca el anillo sin bloquear:
+//   - Serial: texto, formateado en la tarea de red.
+//   - MQTT:   lotes binarios en TOPIC_LOG_BIN (se decodifican en el host con
+//             tools/logdecode.py) o texto en TOPIC_LOG ("log text" / "log bin").
+// Cada salida lleva su propio cursor: si una se atasca (MQTT caído, cola de
+// salida MQTT llena, UART lleno) sus registros esperan en el anillo; si el
+// anillo se llena, se descartan sus registros más antiguos y se cuentan por
+// salida.
+//
+// El formato debe ser un literal (el ID se calcula en compilación).
+
+void logx_tok(uint8_t level, uint32_t id, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#define LOGX_TOK(lvl, fmt, ...) \
+  logx_tok((lvl), std::integral_constant<uint32_t, fnv1a32(fmt)>::value, (fmt), ##__VA_ARGS__)
+
+// Filtro en compilación: los niveles por encima de LOG_LEVEL desaparecen
+#if LOG_LEVEL >= LOG_LVL_ERROR
+#define LOGE(...) LOGX_TOK(LOG_LVL_ERROR, __VA_ARGS__)
+#else
+#define LOGE(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LVL_WARN
+#define LOGW(...) LOGX_TOK(LOG_LVL_WARN, __VA_ARGS__)
+#else
+#define LOGW(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LVL_INFO
+#define LOGI(...) LOGX_TOK(LOG_LVL_INFO, __VA_ARGS__)
+#else
+#define LOGI(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LVL_DEBUG
+#define LOGD(...) LOGX_TOK(LOG_LVL_DEBUG, __VA_ARGS__)
+#else
+#define LOGD(...) do {} while (0)
+#endif
+
+// Atajos de nivel INFO (solo literales)
+#define logPrint(s)     LOGI(s)
+#define logPrintln(s)   LOGI(s "\n")
+#define logPrintf(...)  LOGI(__VA_ARGS__)
+
+// Salida MQTT: true = lotes binarios (TOPIC_LOG_BIN), false = texto (TOPIC_LOG)
+void logx_set_mqtt_binary(bool on);
+bool logx_mqtt_binary();
 
 // Llamar desde net cuando MQTT conecta
 void logx_on_mqtt_connected();
+
+// Vuelca lo pendiente a Serial y, si hay conexión, a MQTT (cada pasada de red)
+void logx_flush();
+
+struct LogStats {
+  uint32_t lines;        // registros escritos en el anillo
+  uint32_t truncated;    // registros con argumentos recortados
+  uint32_t dropSerial;   // descartados para Serial (anillo lleno)
+  uint32_t dropMqtt;     // descartados para MQTT (anillo lleno o registro mayor que un lote)
+  uint32_t highWater;    // máxima ocupación del anillo (bytes)
+};
+void logx_get_stats(LogStats& out);
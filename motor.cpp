@@ -1,16 +1,11 @@
 #include <Arduino.h>
-#include <Preferences.h>
 #include "motor.h"
 #include "config.h"
 #include "state.h"
+#include "hall.h"
 #include "logx.h"   // <-- para logPrintf
-
-// -----------------------
-// Persistencia (NVS)
-// -----------------------
-static Preferences prefsMotor;
-static const char* NVS_NS_MOTOR = "motor";
-static const char* KEY_VEL_BASE = "velBase";  // 0..100
+#include "cfgstore.h"
+#include "params.h"
 
 // -----------------------
 // Estado interno del motor
@@ -19,6 +14,8 @@ static int  speedPercent = 0;   // velocidad actual aplicada (0..100)
 static int  speedTarget  = 0;   // objetivo efectivo (0..100) tras aplicar modo lento
 static int  baseTarget   = 0;   // objetivo base (0..100) antes de factor de ralentización
 static bool slowMode     = false; // si true, se aplica el factor de ralentización al target
+static float dutyPercent = 0.0f;  // duty aplicado (0..100): = speedPercent en lazo abierto, salida del PI en lazo cerrado
+static float profilePercent = -1.0f; // consigna del planificador (<0 = sin perfil, se usa la rampa)
 
 // FSM de sentido con interlock (dead-time)
 enum Dir : uint8_t { DIR_NONE=0, DIR_OPEN=1, DIR_CLOSE=2 };
@@ -35,10 +32,11 @@ static int clamp01_100(int percent) {
   return percent;
 }
 
-static int calcDuty(int percent) {
-  percent = clamp01_100(percent);
+static int calcDuty(float percent) {
+  if (percent < 0.0f)   percent = 0.0f;
+  if (percent > 100.0f) percent = 100.0f;
   const int maxDuty = (1 << MOTOR_PWM_RES) - 1;  // p.ej., 255 si resolución=8
-  return (percent * maxDuty) / 100;
+  return (int)(percent * maxDuty / 100.0f + 0.5f);
 }
 
 // Quita PWM de ambos canales (helper local)
@@ -48,17 +46,105 @@ static void applyStopOutputs() {
 }
 
 // Aplica PWM al canal de abrir
-static void applyOpenOutputs(int percent) {
+static void applyOpenOutputs(float percent) {
   ledcWrite(MOTOR_RPWM_PIN, calcDuty(percent));
   ledcWrite(MOTOR_LPWM_PIN, 0);
 }
 
 // Aplica PWM al canal de cerrar
-static void applyCloseOutputs(int percent) {
+static void applyCloseOutputs(float percent) {
   ledcWrite(MOTOR_RPWM_PIN, 0);
   ledcWrite(MOTOR_LPWM_PIN, calcDuty(percent));
 }
 
+// -----------------------
+// Lazo cerrado de velocidad (PI + feed-forward)
+// -----------------------
+#if MOTOR_CLOSED_LOOP
+// Feed-forward: duty (%) necesario en régimen para cada 10% de velocidad.
+// El primer tramo refleja el rozamiento estático (por debajo no arranca).
+static const float FF_DUTY[11] = { 0, 22, 30, 38, 46, 54, 62, 70, 78, 86, 94 };
+
+static float piInteg  = 0.0f;    // término integral (%duty)
+static bool  piActive = false;
+static bool  piDecel  = false;   // consigna por debajo de la velocidad medida
+
+static float ff_duty(float velPct) {
+  if (velPct <= 0.0f)   return 0.0f;
+  if (velPct >= 100.0f) return FF_DUTY[10];
+  int   i = (int)(velPct / 10.0f);
+  float f = (velPct - i * 10.0f) / 10.0f;
+  return FF_DUTY[i] + (FF_DUTY[i + 1] - FF_DUTY[i]) * f;
+}
+
+// setPct: velocidad objetivo (% de MOTOR_VEL_MAX_CPS). Devuelve duty (%).
+static float closed_loop_duty(float setPct) {
+  if (setPct <= 0.0f) { piInteg = 0.0f; piDecel = false; return 0.0f; }
+
+  float vMeas = hall_get_velocity();
+  if (actualDir == DIR_CLOSE) vMeas = -vMeas;          // positiva en el sentido de marcha
+  float measPct = 100.0f * vMeas / MOTOR_VEL_MAX_CPS;
+
+  const float dt = MOTOR_TICK_MS / 1000.0f;
+  float e  = setPct - measPct;
+  float ff = ff_duty(setPct);
+  // Frenando: la rampa baja o la puerta aún va por encima de la consigna. Con
+  // poco rozamiento el motor apenas da par y la corriente cae a ~0 sin avería.
+  piDecel = (e < 0.0f) || (speedPercent > speedTarget && profilePercent < 0.0f);
+  float p  = params.motorVelKp * e;
+
+  if (!piActive) {
+    // Enganche sin salto: el integrador absorbe la diferencia con el duty actual
+    piInteg  = dutyPercent - ff - p;
+    piActive = true;
+  }
+
+  // Anti-windup: no integrar si la salida está saturada y el error empuja
+  // aún más hacia la saturación
+  float u = ff + p + piInteg;
+  bool pushHi = (u >= 100.0f) && (e > 0.0f);
+  bool pushLo = (u <= 0.0f)   && (e < 0.0f);
+  if (!pushHi && !pushLo) piInteg += params.motorVelKi * e * dt;
+  if (piInteg >  params.motorVelIMax) piInteg =  params.motorVelIMax;
+  if (piInteg < -params.motorVelIMax) piInteg = -params.motorVelIMax;
+
+  u = ff + p + piInteg;
+  if (u < 0.0f)   u = 0.0f;
+  if (u > 100.0f) u = 100.0f;
+  return u;
+}
+#endif
+
+// Duty a aplicar en este tick según el modo (lazo cerrado solo con Hall)
+static float compute_duty() {
+#if MOTOR_CLOSED_LOOP
+  piDecel = false;   // solo lo fija closed_loop_duty() en esta pasada
+#endif
+  if (actualDir == DIR_NONE) {
+#if MOTOR_CLOSED_LOOP
+    piActive = false;
+#endif
+    return 0.0f;
+  }
+  // Consigna: perfil del planificador si lo hay; si no, la rampa
+  float setpoint = (profilePercent >= 0.0f) ? profilePercent : (float)speedPercent;
+#if MOTOR_CLOSED_LOOP
+  if (hall_is_enabled()) {
+    return closed_loop_duty(setpoint);
+  }
+  piActive = false;   // al volver el Hall, enganche sin salto desde el duty actual
+#endif
+  return setpoint;
+}
+
+// Al enganchar un sentido nuevo el PI arranca desde el feed-forward
+static void reset_speed_loop() {
+#if MOTOR_CLOSED_LOOP
+  piInteg  = 0.0f;
+  piActive = true;
+#endif
+}
+
 // Recalcula el objetivo efectivo (speedTarget) a partir de baseTarget y slowMode
 static void refresh_effective_target() {
   int eff = baseTarget;
@@ -88,8 +174,8 @@ void motor_set_speed(int percent) {
   speedPercent = percent;
   baseTarget   = percent;
 
-  // Persistir base SIEMPRE que cambie
-  prefsMotor.putInt(KEY_VEL_BASE, baseTarget);
+  // Persistir base (escritura diferida en cfgstore)
+  cfg_set_i(CFG_MOTOR_VEL_BASE, baseTarget);
 
   refresh_effective_target();
 }
@@ -98,11 +184,23 @@ int motor_get_speed() {
   return speedPercent;
 }
 
+float motor_get_duty() {
+  return dutyPercent;
+}
+
+bool motor_is_decelerating() {
+#if MOTOR_CLOSED_LOOP
+  return piDecel && actualDir != DIR_NONE;
+#else
+  return false;
+#endif
+}
+
 void motor_set_speed_target(int percent) {
   baseTarget = clamp01_100(percent);
 
-  // Persistir base
-  prefsMotor.putInt(KEY_VEL_BASE, baseTarget);
+  // Persistir base (escritura diferida en cfgstore)
+  cfg_set_i(CFG_MOTOR_VEL_BASE, baseTarget);
 
   refresh_effective_target();
 }
@@ -111,13 +209,22 @@ int motor_get_speed_target() {
   return speedTarget; // (en boot slowMode=false, equivale a base)
 }
 
+void motor_set_profile(float percent) {
+  if (percent < 0.0f)   percent = 0.0f;
+  if (percent > 100.0f) percent = 100.0f;
+  profilePercent = percent;
+}
+
+void motor_clear_profile() {
+  profilePercent = -1.0f;
+}
+
 // -----------------------
 // Control de pines / inicio
 // -----------------------
 void motor_begin() {
   // Cargar persistencia
-  prefsMotor.begin(NVS_NS_MOTOR, false);
-  baseTarget   = clamp01_100((int)prefsMotor.getInt(KEY_VEL_BASE, 0));
+  baseTarget   = clamp01_100((int)cfg_get_i(CFG_MOTOR_VEL_BASE, 0));
   speedTarget  = baseTarget;
   speedPercent = baseTarget;   // opcional: igualamos al objetivo al arrancar
   slowMode     = false;
@@ -154,6 +261,7 @@ void motorStop()  {
     actualDir  = DIR_NONE;
     tDirChange = millis();
   }
+  dutyPercent = 0.0f;
   logPrintln("[MOTOR] STOP");
 }
 
@@ -174,6 +282,7 @@ void motor_emergency_stop() {
 
   tDirChange   = millis();   // arranca dead-time para un próximo arranque
   speedPercent = 0;          // la rampa parte de 0 tras emergencia
+  dutyPercent  = 0.0f;
   logPrintln("[MOTOR] EMERGENCY STOP");
 }
 
@@ -192,21 +301,23 @@ void motor_tick() {
       applyStopOutputs();
       actualDir = DIR_NONE;
       desiredDir = DIR_NONE;
+      dutyPercent = 0.0f;
       tDirChange = now;
       tObstaculo = now;
       retroStarted = false;
-      Serial.println("[OBSTACULO] Motor detenido por sobrecorriente");
+      LOGW("[OBSTACULO] Motor detenido por sobrecorriente\n");
       return; // salimos del tick normal
     }
 
     // Espera breve antes de invertir sentido
     if (!retroStarted && (now - tObstaculo) > 200) {
       motor_set_slow(true);          // opcional: retroceso lento
-      applyOpenOutputs(speedTarget); // abrir un poco
+      applyOpenOutputs(speedTarget); // abrir un poco (lazo abierto)
+      dutyPercent = speedTarget;
       actualDir = DIR_OPEN;
       desiredDir = DIR_OPEN;
       retroStarted = true;
-      Serial.println("[OBSTACULO] Retroceso iniciado");
+      LOGI("[OBSTACULO] Retroceso iniciado\n");
       return; // seguimos retrocediendo en próximos ticks
     }
 
@@ -215,12 +326,13 @@ void motor_tick() {
       applyStopOutputs();
       actualDir = DIR_NONE;
       desiredDir = DIR_NONE;
+      dutyPercent = 0.0f;
       tDirChange = now;
       tObstaculo = 0;
       retroStarted = false;
       motor_set_slow(false);         // volver a velocidad normal
       setEstado(DETENIDO);
-      Serial.println("[OBSTACULO] Retroceso completado, motor detenido");
+      LOGI("[OBSTACULO] Retroceso completado, motor detenido\n");
       return;
     }
 
@@ -238,9 +350,9 @@ void motor_tick() {
   // 2) Rampa hacia el objetivo efectivo
   if (speedPercent != speedTarget) {
     if (speedPercent < speedTarget) {
-      speedPercent = min(speedPercent + MOTOR_RAMP_STEP_PERCENT, speedTarget);
+      speedPercent = min(speedPercent + (int)params.motorRampStep, speedTarget);
     } else {
-      speedPercent = max(speedPercent - MOTOR_RAMP_STEP_PERCENT, speedTarget);
+      speedPercent = max(speedPercent - (int)params.motorRampStep, speedTarget);
     }
   }
 
@@ -251,6 +363,7 @@ void motor_tick() {
       // Estábamos aplicando un sentido: soltar primero
       applyStopOutputs();
       actualDir  = DIR_NONE;
+      dutyPercent = 0.0f;
       tDirChange = now;
       return; // damos una vuelta de tick en stop antes de seguir
     }
@@ -262,12 +375,15 @@ void motor_tick() {
     }
 
     // Ya pasó el dead-time: engancha nuevo sentido
+    reset_speed_loop();
     if (desiredDir == DIR_OPEN) {
-      applyOpenOutputs(speedPercent);
       actualDir = DIR_OPEN;
+      dutyPercent = compute_duty();
+      applyOpenOutputs(dutyPercent);
     } else if (desiredDir == DIR_CLOSE) {
-      applyCloseOutputs(speedPercent);
       actualDir = DIR_CLOSE;
+      dutyPercent = compute_duty();
+      applyCloseOutputs(dutyPercent);
     } else {
       applyStopOutputs();
       actualDir = DIR_NONE;
@@ -275,11 +391,12 @@ void motor_tick() {
     return;
   }
 
-  // 4) Mantener salidas según sentido actual
+  // 4) Mantener salidas según sentido actual (duty de lazo abierto o del PI)
+  dutyPercent = compute_duty();
   if (actualDir == DIR_OPEN) {
-    applyOpenOutputs(speedPercent);
+    applyOpenOutputs(dutyPercent);
   } else if (actualDir == DIR_CLOSE) {
-    applyCloseOutputs(speedPercent);
+    applyCloseOutputs(dutyPercent);
   } else {
     applyStopOutputs();
   }
@@ -21,10 +21,18 @@ void motor_emergency_stop(); // Parada de emergencia (corte inmediato, log [MOTO
 // =====================================================
 void motor_set_speed(int percent);        // fija velocidad actual y base (0..100) y persiste en NVS
 int  motor_get_speed();                   // devuelve velocidad actual aplicada (0..100)
+float motor_get_duty();                   // duty aplicado (0..100); en lazo cerrado lo fija el PI
+bool  motor_is_decelerating();            // lazo cerrado frenando a propósito (consigna por debajo de la velocidad medida)
 
 void motor_set_speed_target(int percent); // fija velocidad base (0..100) y persiste en NVS
 int  motor_get_speed_target();            // devuelve velocidad efectiva (base o ralentizada)
 
+// =====================================================
+//   Perfil externo (planificador de trayectorias)
+// =====================================================
+void motor_set_profile(float percent);    // consigna (0..100) que sustituye a la rampa; en lazo cerrado es velocidad
+void motor_clear_profile();               // vuelve a la rampa normal
+
 // =====================================================
 //   Modo lento (slow)
 // =====================================================
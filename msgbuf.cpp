@@ -0,0 +1,164 @@
+#include "msgbuf.h"
+#include <math.h>
+
+TextBuf::TextBuf(char* mem, size_t cap) : m_mem(mem), m_cap(cap), m_len(0), m_over(false) {
+  if (m_cap) m_mem[0] = '\0';
+}
+
+void TextBuf::clear() {
+  m_len = 0;
+  m_over = false;
+  if (m_cap) m_mem[0] = '\0';
+}
+
+TextBuf& TextBuf::ch(char c) {
+  if (m_len + 1 < m_cap) {
+    m_mem[m_len++] = c;
+    m_mem[m_len] = '\0';
+  } else {
+    m_over = true;
+  }
+  return *this;
+}
+
+TextBuf& TextBuf::str(const char* s) {
+  if (!s) return *this;
+  while (*s) ch(*s++);
+  return *this;
+}
+
+TextBuf& TextBuf::unum(unsigned long v) {
+  char tmp[12];
+  int n = 0;
+  do { tmp[n++] = (char)('0' + (v % 10)); v /= 10; } while (v && n < (int)sizeof(tmp));
+  while (n) ch(tmp[--n]);
+  return *this;
+}
+
+TextBuf& TextBuf::num(long v) {
+  if (v < 0) {
+    ch('-');
+    return unum(0UL - (unsigned long)v);
+  }
+  return unum((unsigned long)v);
+}
+
+TextBuf& TextBuf::hex(unsigned long v) {
+  static const char DIG[] = "0123456789ABCDEF";
+  char tmp[8];
+  int n = 0;
+  do { tmp[n++] = DIG[v & 0xF]; v >>= 4; } while (v && n < (int)sizeof(tmp));
+  while (n) ch(tmp[--n]);
+  return *this;
+}
+
+TextBuf& TextBuf::fix(float v, uint8_t decimals) {
+  if (isnan(v)) return str("nan");
+  if (decimals > 6) decimals = 6;
+
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+
+  bool neg = (v < 0.0f);
+  float a = neg ? -v : v;
+  if (a * scale >= 4294967295.0f) return str(neg ? "-inf" : "inf");
+
+  uint32_t q = (uint32_t)(a * scale + 0.5f);
+  if (neg && q) ch('-');
+  unum(q / scale);
+  if (decimals) {
+    ch('.');
+    uint32_t frac = q % scale;
+    for (uint32_t d = scale / 10; d; d /= 10) {
+      ch((char)('0' + (frac / d) % 10));
+    }
+  }
+  return *this;
+}
+
+// ---------------- JSON ----------------
+
+JsonBuf::JsonBuf(TextBuf& out) : m_out(out), m_first(true) {
+  m_out.ch('{');
+}
+
+TextBuf& JsonBuf::key(const char* k) {
+  if (!m_first) m_out.ch(',');
+  m_first = false;
+  return m_out.ch('"').str(k).str("\":");
+}
+
+JsonBuf& JsonBuf::num(const char* k, long v)                   { key(k).num(v);           return *this; }
+JsonBuf& JsonBuf::unum(const char* k, unsigned long v)         { key(k).unum(v);          return *this; }
+JsonBuf& JsonBuf::fix(const char* k, float v, uint8_t dec)     { key(k).fix(v, dec);      return *this; }
+JsonBuf& JsonBuf::flag(const char* k, bool v)                  { key(k).str(v ? "true" : "false"); return *this; }
+
+JsonBuf& JsonBuf::str(const char* k, const char* v) {
+  key(k).ch('"');
+  for (const char* p = v ? v : ""; *p; ++p) {
+    if (*p == '"' || *p == '\\') m_out.ch('\\');
+    m_out.ch(*p);
+  }
+  m_out.ch('"');
+  return *this;
+}
+
+TextBuf& JsonBuf::end() {
+  return m_out.ch('}');
+}
+
+// ---------------- MsgView ----------------
+
+static inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+static inline char lower(char c)    { return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c; }
+
+MsgView MsgView::trimmed() const {
+  size_t a = 0, b = n;
+  while (a < b && is_space(p[a]))     ++a;
+  while (b > a && is_space(p[b - 1])) --b;
+  return MsgView(p + a, b - a);
+}
+
+bool MsgView::eq(const char* s) const {
+  size_t i = 0;
+  for (; i < n; ++i) if (s[i] != p[i]) return false;   // s[i]==0 también corta
+  return s[i] == '\0';
+}
+
+bool MsgView::ieq(const char* s) const {
+  size_t i = 0;
+  for (; i < n; ++i) if (!s[i] || lower(s[i]) != lower(p[i])) return false;
+  return s[i] == '\0';
+}
+
+bool MsgView::starts_with(const char* s) const {
+  size_t i = 0;
+  for (; s[i]; ++i) if (i >= n || s[i] != p[i]) return false;
+  return true;
+}
+
+bool MsgView::to_long(long& out) const {
+  size_t i = 0;
+  bool neg = false;
+  if (i < n && (p[i] == '-' || p[i] == '+')) neg = (p[i++] == '-');
+  if (i >= n || p[i] < '0' || p[i] > '9') return false;
+  long v = 0;
+  for (; i < n && p[i] >= '0' && p[i] <= '9'; ++i) v = v * 10 + (p[i] - '0');
+  out = neg ? -v : v;
+  return true;
+}
+
+bool MsgView::to_float(float& out) const {
+  size_t i = 0;
+  bool neg = false, any = false;
+  if (i < n && (p[i] == '-' || p[i] == '+')) neg = (p[i++] == '-');
+  float v = 0.0f;
+  for (; i < n && p[i] >= '0' && p[i] <= '9'; ++i) { v = v * 10.0f + (p[i] - '0'); any = true; }
+  if (i < n && p[i] == '.') {
+    float w = 0.1f;
+    for (++i; i < n && p[i] >= '0' && p[i] <= '9'; ++i) { v += (p[i] - '0') * w; w *= 0.1f; any = true; }
+  }
+  if (!any) return false;
+  out = neg ? -v : v;
+  return true;
+}
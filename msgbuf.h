@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+
+// =====================================================
+//     Serialización de mensajes sin heap (texto/JSON)
+// =====================================================
+// Escribe sobre un buffer del llamador (normalmente en pila). Si no cabe,
+// trunca, mantiene el terminador y marca overflow(). No usa printf para
+// los números (newlib reserva memoria al formatear floats).
+
+class TextBuf {
+public:
+  TextBuf(char* mem, size_t cap);
+
+  TextBuf& str(const char* s);
+  TextBuf& ch(char c);
+  TextBuf& num(long v);
+  TextBuf& unum(unsigned long v);
+  TextBuf& hex(unsigned long v);
+  TextBuf& fix(float v, uint8_t decimals);   // coma fija, redondeo al más cercano
+
+  void        clear();
+  const char* c_str()    const { return m_mem; }
+  size_t      length()   const { return m_len; }
+  bool        overflow() const { return m_over; }
+
+private:
+  char*  m_mem;
+  size_t m_cap;
+  size_t m_len;
+  bool   m_over;
+};
+
+// Buffer de N bytes (incluye el terminador) listo para usar en pila
+template<size_t N>
+class StackText : public TextBuf {
+public:
+  StackText() : TextBuf(m_buf, N) {}
+private:
+  char m_buf[N];
+};
+
+// Objeto JSON plano sobre un TextBuf: abre '{' al construir y end() lo cierra
+class JsonBuf {
+public:
+  explicit JsonBuf(TextBuf& out);
+
+  JsonBuf& num(const char* key, long v);
+  JsonBuf& unum(const char* key, unsigned long v);
+  JsonBuf& fix(const char* key, float v, uint8_t decimals);
+  JsonBuf& str(const char* key, const char* v);   // con escape de " y barra
+  JsonBuf& flag(const char* key, bool v);
+
+  TextBuf& end();
+
+private:
+  TextBuf& key(const char* k);
+  TextBuf& m_out;
+  bool     m_first;
+};
+
+// =====================================================
+//        Lectura de payloads en sitio (sin copias)
+// =====================================================
+
+// Hash FNV-1a de 32 bits, evaluable en compilación
+constexpr uint32_t fnv1a32(const char* s) {
+  uint32_t h = 2166136261u;
+  while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+  return h;
+}
+
+// Igual, sobre n bytes sin terminador (p. ej. el topic de un evento MQTT)
+constexpr uint32_t fnv1a32(const char* s, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; ++i) { h ^= (uint8_t)s[i]; h *= 16777619u; }
+  return h;
+}
+
+// Vista (puntero + longitud) sobre un buffer ajeno, p. ej. un mensaje MQTT.
+// No necesita terminador ni modifica el buffer.
+struct MsgView {
+  const char* p;
+  size_t      n;
+
+  MsgView(const char* ptr, size_t len) : p(ptr), n(len) {}
+
+  MsgView trimmed() const;
+  MsgView after(size_t k) const { return (k >= n) ? MsgView(p + n, 0) : MsgView(p + k, n - k); }
+
+  bool eq(const char* s) const;            // igual exacto
+  bool ieq(const char* s) const;           // igual sin distinguir mayúsculas
+  bool starts_with(const char* s) const;
+  bool ends_with(char c) const { return n && p[n - 1] == c; }
+
+  // Número al principio de la vista (signo opcional). false si no hay dígitos.
+  bool to_long(long& out) const;
+  bool to_float(float& out) const;
+};
@@ -1,7 +1,10 @@
 #include "net.h"
 #include <WiFi.h>
-#include <PubSubClient.h>
+#include <mqtt_client.h>
+#include <esp_timer.h>
+#include <atomic>
 #include <math.h>
+#include <array>
 #include "secrets.h"
 #include "config.h"
 #include "logx.h"
@@ -11,26 +14,81 @@
 #include "motor.h"
 #include "hall.h"
 #include "light.h"
+#include "tasks.h"
+#include "ienv.h"
+#include "msgbuf.h"
+#include "heapmon.h"
+#include "cfgstore.h"
+#include "params.h"
+#include "prof.h"
+#include "sched.h"
+#include "telem.h"
+#include "pubq.h"
+#include "spsc.h"
+#include "routes.h"
 
 // =====================================================
 //                    CONFIGURACIÓN GLOBAL
 // =====================================================
 
-// WiFi: reconexión con backoff
-static bool ipShown = false;
-static uint32_t tNextRetry = 0;
-static uint32_t retryDelayMs = 1000;
-static const uint32_t RETRY_DELAY_MAX = 60 * 1000;
-
-// MQTT: reconexión NO bloqueante
-static uint32_t tNextMqttRetry = 0;
-static uint32_t mqttRetryDelayMs = 1000;
-static const uint32_t MQTT_RETRY_DELAY_MAX = 60 * 1000; // 60s
-
-static WiFiClient wifiClient;
-static PubSubClient mqtt(wifiClient);
-
-static bool mqttEnsureConnected();
+// WiFi: estado por eventos (tarea de eventos de Arduino → tarea de red)
+static std::atomic<bool>     s_wifiUp{false};
+static std::atomic<uint32_t> s_wifiGotIp{0};       // GOT_IP vistos
+static std::atomic<uint32_t> s_wifiDisc{0};        // DISCONNECTED vistos (también intentos fallidos)
+static std::atomic<uint32_t> s_wifiTGotIp{0};      // millis() del último GOT_IP
+static std::atomic<uint32_t> s_wifiTLost{0};       // millis() de la última pérdida con IP
+static std::atomic<uint8_t>  s_wifiReason{0};      // último wifi_err_reason_t
+
+// Última conexión buena: RTC (sobrevive a reinicios por software) + NVS
+struct WifiCache {
+  uint32_t magic;
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint8_t  _pad;
+  uint32_t ip, gw, mask, dns;
+};
+static const uint32_t WIFI_CACHE_MAGIC = 0x57464331;   // "WFC1"
+RTC_DATA_ATTR static WifiCache s_wifiRtc;
+static WifiCache s_wifiCache;                          // buffer del blob de cfgstore
+
+// Reconexión (solo tarea de red)
+enum WifiPhase : uint8_t { WIFI_UP, WIFI_FAST, WIFI_SCAN, WIFI_WAIT };
+static WifiPhase s_wifiPhase = WIFI_WAIT;
+static uint32_t  s_wifiTAttempt = 0;      // inicio del intento o de la espera
+static uint32_t  s_wifiTimeout = 0;       // duración del intento o de la espera
+static uint32_t  s_wifiDiscSeen = 0;
+static uint32_t  s_wifiGotIpSeen = 0;
+static uint32_t  s_wifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+static bool      s_wifiWasFast = false;   // el último intento lanzado fue dirigido
+
+// Métricas de reconexión (ms desde la pérdida hasta tener IP)
+static uint32_t s_wifiBootMs = 0;
+static uint32_t s_wifiReconnects = 0, s_wifiFastOk = 0;
+static uint32_t s_wifiLastMs = 0, s_wifiMaxMs = 0;
+
+// MQTT: cliente de ESP-IDF (esp-mqtt) en su propia tarea. DNS, conexión,
+// reintentos y escrituras TCP ocurren allí; la tarea de red solo encola
+// salidas (outbox) y recoge entradas y cambios de conexión.
+static esp_mqtt_client_handle_t s_mqtt = nullptr;
+static bool                     s_mqttStarted = false;
+static std::atomic<bool>        s_mqttUp{false};
+static std::atomic<uint32_t>    s_mqttConnects{0};     // CONNECTED vistos (tarea MQTT)
+static std::atomic<uint32_t>    s_mqttDisconnects{0};
+static uint32_t                 s_mqttConnectsSeen = 0;
+
+// Mensajes entrantes: tarea MQTT → tarea de red (los manejadores de ROUTES
+// tocan módulos de la tarea de red)
+struct InMsg {
+  uint8_t  route;
+  uint16_t len;
+  char     data[MQTT_IN_MAX];
+};
+static SpscQueue<InMsg, MQTT_IN_QUEUE> s_inbox;
+static std::atomic<uint32_t>           s_inDropped{0};
+
+// Duración de net_tick() (peor caso desde el último informe y desde el arranque)
+static uint32_t s_tickMaxUs = 0;
+static uint32_t s_tickMaxEverUs = 0;
 
 
 // =====================================================
@@ -38,17 +96,62 @@ static bool mqttEnsureConnected();
 // =====================================================
 
 bool net_wifi_connected() {
-  return WiFi.status() == WL_CONNECTED;
+  return s_wifiUp.load(std::memory_order_relaxed);
 }
 
 bool net_mqtt_connected() {
-  return mqtt.connected();
+  return s_mqttUp.load(std::memory_order_relaxed);
 }
 
-void net_mqtt_publish(const char *topic, const String &payload, bool retain) {
-  if (!mqtt.connected())
-    return;
-  mqtt.publish(topic, payload.c_str(), retain);
+bool net_mqtt_publish(const char *topic, const uint8_t *payload, size_t len, bool retain, bool keep) {
+  return pubq_push(topic, payload, len, retain, keep);
+}
+
+bool net_mqtt_publish(const char *topic, const char *payload, bool retain) {
+  return net_mqtt_publish(topic, (const uint8_t *)payload, strlen(payload), retain);
+}
+
+
+// pubq_flush() → outbox de esp-mqtt (copia y vuelve; la tarea MQTT escribe
+// en el socket). Sin conexión o con el outbox lleno el mensaje se queda en
+// la cola; otro fallo lo descarta (y pubq lo cuenta en dropped).
+static PubqSendResult mqttSend(const char *topic, const uint8_t *payload, size_t len, bool retain) {
+  if (!net_mqtt_connected())
+    return PUBQ_RETRY;
+  HeapPause hp;   // el outbox reserva heap: no cuenta como reserva de telemetría
+  int id = esp_mqtt_client_enqueue(s_mqtt, topic, (const char *)payload, (int)len, 0, retain ? 1 : 0, true);
+  if (id >= 0)
+    return PUBQ_SENT;
+  if (id == -2 || !net_mqtt_connected())
+    return PUBQ_RETRY;        // outbox lleno o conexión caída: próxima pasada
+  return PUBQ_DROPPED;
+}
+
+
+// =====================================================
+//                TOPICS RETENIDOS
+// =====================================================
+
+static void publish_current_limit() {
+  StackText<12> v;
+  net_mqtt_publish(TOPIC_ILIMIT, v.fix(current_get_limit(), 2).c_str(), true);
+}
+
+static void publish_uint(const char *topic, unsigned long v, bool retain) {
+  StackText<12> t;
+  net_mqtt_publish(topic, t.unum(v).c_str(), retain);
+}
+
+// Solo el valor inicial: después cada cambio lo publica quien lo hace, la
+// cola guarda el último y lo repite al reconectar
+void net_publish_state() {
+  net_mqtt_publish(TOPIC_LIGHT_STATE, light_is_on() ? "ON" : "OFF", true);
+#if LIGHT_PWM_ENABLED
+  publish_uint(TOPIC_LIGHT_DIM, light_get_level(), true);
+#endif
+  net_mqtt_publish(TOPIC_HALL_EN_STATE, hall_is_enabled() ? "ON" : "OFF", true);
+  publish_uint(TOPIC_SPEED, motor_get_speed_target(), true);
+  publish_current_limit();
 }
 
 
@@ -56,40 +159,82 @@ void net_mqtt_publish(const char *topic, const String &payload, bool retain) {
 //                    COMANDOS MQTT (TOPIC_CMD)
 // =====================================================
 
-static void handleCmd(const String &msg) {
-  if (msg.startsWith("ota on")) {
-    uint32_t minutos = 10;
-    int sp = msg.indexOf(' ', 6);
-    if (sp > 0) {
-      String mins = msg.substring(sp + 1);
-      mins.trim();
-      if (mins.length())
-        minutos = (uint32_t)mins.toInt();
-      if (minutos == 0)
-        minutos = 1;
-    }
-    ota_enable_for(minutos);
+static void handleCmd(MsgView msg) {
+  if (msg.starts_with("ota on")) {
+    long minutos = 10;
+    long v;
+    if (msg.after(6).trimmed().to_long(v))
+      minutos = (v > 0) ? v : 1;
+    ota_enable_for((uint32_t)minutos);
 
-  } else if (msg == "ota off") {
+  } else if (msg.eq("ota off")) {
     ota_disable();
 
-  } else if (msg == "status") {
-    String ip = net_wifi_connected() ? WiFi.localIP().toString() : "-";
-    bool ota = ota_is_on();
-    uint32_t left = ota_seconds_left();
-    float ilimit = current_get_limit();
+  } else if (msg.eq("status")) {
+    HeapWatch hw;
+    StackText<16> ip;
+    if (net_wifi_connected()) {
+      IPAddress a = WiFi.localIP();
+      ip.unum(a[0]).ch('.').unum(a[1]).ch('.').unum(a[2]).ch('.').unum(a[3]);
+    } else {
+      ip.ch('-');
+    }
 
-    String st = String("{\"wifi\":\"") + (net_wifi_connected() ? "ON" : "OFF")
-              + "\",\"ip\":\"" + ip
-              + "\",\"ota\":\"" + (ota ? "ON" : "OFF")
-              + "\",\"left\":" + String(left)
-              + ",\"ilimit\":" + String(ilimit, 2)
-              + ",\"open_pulses\":" + String(hall_open_pulses) + "}";
+    StackText<192> st;
+    JsonBuf(st)
+      .str("wifi", net_wifi_connected() ? "ON" : "OFF")
+      .str("ip", ip.c_str())
+      .str("ota", ota_is_on() ? "ON" : "OFF")
+      .unum("left", ota_seconds_left())
+      .fix("ilimit", current_get_limit(), 2)
+      .num("open_pulses", hall_open_pulses)
+      .unum("ienv", ienv_learned_buckets())
+      .str("adc", current_lut_source())
+      .end();
+
+    net_mqtt_publish(TOPIC_INFO, st.c_str(), false);
+
+  } else if (msg.eq("log bin")) {
+    logx_set_mqtt_binary(true);
+
+  } else if (msg.eq("log text")) {
+    logx_set_mqtt_binary(false);
+
+  } else if (msg.eq("ienv reset")) {
+    tasks_post_cmd(CMD_IENV_RESET);
+
+  } else if (msg.starts_with("adclut ")) {
+    // "adclut raw:mV raw:mV ...": lecturas del ADC y mV medidos en su pin
+    uint16_t raw[ADC_LUT_CAL_MAX];
+    float    mV[ADC_LUT_CAL_MAX];
+    size_t   n = 0;
+    bool     ok = true;
+    MsgView rest = msg.after(7).trimmed();
+    while (ok && rest.n) {
+      size_t len = 0, colon = 0;
+      while (len < rest.n && rest.p[len] != ' ') {
+        if (rest.p[len] == ':' && !colon) colon = len;
+        ++len;
+      }
+      long r;
+      float v;
+      ok = colon && n < ADC_LUT_CAL_MAX &&
+           MsgView(rest.p, colon).to_long(r) && r >= 0 && r <= 0xFFFF &&
+           MsgView(rest.p + colon + 1, len - colon - 1).to_float(v);
+      if (ok) { raw[n] = (uint16_t)r; mV[n] = v; n++; }
+      rest = rest.after(len).trimmed();
+    }
+    if (ok && current_lut_from_points(raw, mV, n))
+      LOGI("[MQTT] Tabla ADC: %u puntos\n", (unsigned)n);
+    else
+      LOGW("[MQTT] adclut: puntos no válidos (raw:mV creciente, 2..%u)\n", (unsigned)ADC_LUT_CAL_MAX);
 
-    net_mqtt_publish(TOPIC_INFO, st, false);
+  } else if (msg.eq("prof reset")) {
+    prof_reset();
 
-  } else if (msg == "reboot") {
+  } else if (msg.eq("reboot")) {
     logPrintln("[SYS] Reiniciando por MQTT...");
+    cfg_flush_now();
     delay(100);
     ESP.restart();
 
@@ -100,219 +245,621 @@ static void handleCmd(const String &msg) {
 
 
 // =====================================================
-//                PUBLICACIONES INICIALES
+//                CALLBACK DE MENSAJES MQTT
 // =====================================================
+// Cada topic suscrito tiene su manejador en ROUTES (routes.h): ordenada por
+// hash en compilación, búsqueda binaria y strcmp de confirmación. El payload
+// se lee en sitio con MsgView.
 
-static void publish_current_limit() {
-  net_mqtt_publish(TOPIC_ILIMIT, String(current_get_limit(), 2), true);
+static void onCmd(MsgView msg) {
+  LOGD("[MQTT] cmd: %.*s\n", (int)msg.n, msg.p);
+  handleCmd(msg);
 }
 
-static void mqttSubscribeAll() {
-  mqtt.subscribe(TOPIC_CMD);
-  mqtt.subscribe(TOPIC_OPEN_CMD);
-  mqtt.subscribe(TOPIC_CLOSE_CMD);
-  mqtt.subscribe(TOPIC_ILIMIT_CMD);
-  mqtt.subscribe(TOPIC_ILIMIT);
-  mqtt.subscribe(TOPIC_SPEED_CMD);
-  mqtt.subscribe(TOPIC_SPEED);
-  mqtt.subscribe(TOPIC_MARK_CLOSED_CMD);
-  mqtt.subscribe(TOPIC_MARK_OPEN_CMD);
-  mqtt.subscribe(TOPIC_HALL_EN_CMD);
-  mqtt.subscribe(TOPIC_LIGHT_CMD);
-  mqtt.subscribe(TOPIC_LIGHT_DIM_CMD);
-  mqtt.subscribe(TOPIC_LIGHT_BREATH_CMD);
-}
-
-static void mqttPublishBootState() {
-  net_mqtt_publish(TOPIC_LIGHT_STATE, light_is_on() ? "ON" : "OFF", true);
-#if LIGHT_PWM_ENABLED
-  net_mqtt_publish(TOPIC_LIGHT_DIM, String(light_get_level()), true);
-#endif
-  net_mqtt_publish(TOPIC_HALL_EN_STATE, hall_is_enabled() ? "ON" : "OFF", true);
-  net_mqtt_publish(TOPIC_INFO, String("{\"boot\":true}"), false);
-  net_mqtt_publish(TOPIC_SPEED, String(motor_get_speed_target()), true);
-  publish_current_limit();
-  logx_on_mqtt_connected();
+static void onOpenCmd(MsgView msg) {
+  if (msg.ieq("ON"))
+    setEstado(ABRIENDO);
+  else
+    setEstado(DETENIDO);
 }
 
+static void onCloseCmd(MsgView msg) {
+  if (msg.ieq("ON"))
+    setEstado(CERRANDO);
+  else
+    setEstado(DETENIDO);
+}
 
-// =====================================================
-//                CALLBACK DE MENSAJES MQTT
-// =====================================================
-
-static void mqttCallback(char *topic, byte *payload, unsigned int length) {
-  String t(topic);
-  String msg;
-  msg.reserve(length);
-  for (unsigned int i = 0; i < length; i++)
-    msg += (char)payload[i];
-  msg.trim();
-
-  if (t == TOPIC_CMD) {
-    logPrintf("[MQTT] cmd: %s\n", msg.c_str());
-    handleCmd(msg);
-
-  } else if (t == TOPIC_OPEN_CMD) {
-    if (msg.equalsIgnoreCase("ON"))
-      setEstado(ABRIENDO);
-    else
-      setEstado(DETENIDO);
+static void onGotoCmd(MsgView msg) {
+  long pct;
+  if (!hall_is_enabled()) {
+    logPrintln("[MQTT] Goto requiere el Hall habilitado.");
+  } else if (msg.to_long(pct) && pct >= 0 && pct <= 100) {
+    long target = (hall_open_pulses * pct) / 100;
+    tasks_post_cmd(CMD_GOTO, (int32_t)target);
+    logPrintf("[MQTT] Goto %ld%% (%ld cuentas)\n", pct, target);
+  } else {
+    logPrintf("[MQTT] Valor de goto inválido: '%.*s'\n", (int)msg.n, msg.p);
+  }
+}
 
-  } else if (t == TOPIC_CLOSE_CMD) {
-    if (msg.equalsIgnoreCase("ON"))
-      setEstado(CERRANDO);
-    else
-      setEstado(DETENIDO);
-
-  } else if (t == TOPIC_ILIMIT_CMD) {
-    float nuevo = msg.toFloat();
-    if (nuevo > 0.0f && isfinite(nuevo)) {
-      float actual = current_get_limit();
-      if (fabs(actual - nuevo) > 0.01f) {
-        current_set_limit(nuevo);
-        logPrintf("[MQTT] Nuevo límite de corriente: %.2f A\n", nuevo);
-        publish_current_limit();
-      }
-    } else {
-      logPrintf("[MQTT] Valor de límite inválido: '%s'\n", msg.c_str());
+static void onIlimitCmd(MsgView msg) {
+  float nuevo;
+  if (msg.to_float(nuevo) && nuevo > 0.0f && isfinite(nuevo)) {
+    float actual = current_get_limit();
+    if (fabs(actual - nuevo) > 0.01f) {
+      current_set_limit(nuevo);
+      logPrintf("[MQTT] Nuevo límite de corriente: %.2f A\n", nuevo);
+      publish_current_limit();
     }
+  } else {
+    logPrintf("[MQTT] Valor de límite inválido: '%.*s'\n", (int)msg.n, msg.p);
+  }
+}
 
-  } else if (t == TOPIC_SPEED_CMD) {
-    int nuevo = msg.toInt();
-    if (nuevo >= 0 && nuevo <= 100) {
-      int actual = motor_get_speed_target();
-      if (actual != nuevo) {
-        motor_set_speed_target(nuevo);
-        net_mqtt_publish(TOPIC_SPEED, String(nuevo), true);
-        logPrintf("[MQTT] Nueva velocidad objetivo: %d%%\n", nuevo);
-      }
-    } else {
-      logPrintf("[MQTT] Valor de velocidad inválido: '%s'\n", msg.c_str());
+static void onSpeedCmd(MsgView msg) {
+  long nuevo;
+  if (msg.to_long(nuevo) && nuevo >= 0 && nuevo <= 100) {
+    int actual = motor_get_speed_target();
+    if (actual != nuevo) {
+      motor_set_speed_target((int)nuevo);
+      publish_uint(TOPIC_SPEED, (unsigned long)nuevo, true);
+      logPrintf("[MQTT] Nueva velocidad objetivo: %ld%%\n", nuevo);
     }
+  } else {
+    logPrintf("[MQTT] Valor de velocidad inválido: '%.*s'\n", (int)msg.n, msg.p);
+  }
+}
 
-  } else if (t == TOPIC_MARK_CLOSED_CMD) {
-    if (msg.equalsIgnoreCase("ON")) {
-      hall_mark_closed();
-      logPrintln("[MQTT] Marcado CERRADO en posición actual (encCount=0).");
-    }
+static void onMarkClosedCmd(MsgView msg) {
+  if (msg.ieq("ON")) {
+    tasks_post_cmd(CMD_HALL_MARK_CLOSED);
+    logPrintln("[MQTT] Marcado CERRADO en posición actual (encCount=0).");
+  }
+}
 
-  } else if (t == TOPIC_MARK_OPEN_CMD) {
-    if (msg.equalsIgnoreCase("ON")) {
-      hall_mark_open();
-      logPrintf("[MQTT] Marcado ABIERTO en posición actual (encCount=%ld).\n", hall_get_count());
-    }
+static void onMarkOpenCmd(MsgView msg) {
+  if (msg.ieq("ON")) {
+    tasks_post_cmd(CMD_HALL_MARK_OPEN);
+    logPrintf("[MQTT] Marcado ABIERTO en posición actual (encCount=%ld).\n", tasks_snapshot().pos);
+  }
+}
 
-  } else if (t == TOPIC_HALL_EN_CMD) {
-    if (msg.equalsIgnoreCase("ON")) {
-      hall_set_enabled(true);
-      net_mqtt_publish(TOPIC_HALL_EN_STATE, "ON", true);
-      logPrintln("[HALL] enabled=ON");
-    } else if (msg.equalsIgnoreCase("OFF")) {
-      hall_set_enabled(false);
-      net_mqtt_publish(TOPIC_HALL_EN_STATE, "OFF", true);
-      logPrintln("[HALL] enabled=OFF");
-    }
+static void onHallEnCmd(MsgView msg) {
+  if (msg.ieq("ON")) {
+    hall_set_enabled(true);
+    net_mqtt_publish(TOPIC_HALL_EN_STATE, "ON", true);
+    logPrintln("[HALL] enabled=ON");
+  } else if (msg.ieq("OFF")) {
+    hall_set_enabled(false);
+    net_mqtt_publish(TOPIC_HALL_EN_STATE, "OFF", true);
+    logPrintln("[HALL] enabled=OFF");
+  }
+}
 
-  } else if (t == TOPIC_LIGHT_CMD) {
-    if (msg.equalsIgnoreCase("ON")) light_on();
-    else if (msg.equalsIgnoreCase("OFF")) light_off();
-    else if (msg.equalsIgnoreCase("TOGGLE")) light_toggle();
-    net_mqtt_publish(TOPIC_LIGHT_STATE, light_is_on() ? "ON" : "OFF", true);
-
-  } else if (t == TOPIC_LIGHT_BREATH_CMD) {
-    if (msg.equalsIgnoreCase("ON")) {
-      light_set_breath_mode(true);
-    } else if (msg.equalsIgnoreCase("OFF")) {
-      light_set_breath_mode(false);
-    }
-    net_mqtt_publish(TOPIC_LIGHT_BREATH_STATE, light_get_breath_mode() ? "ON" : "OFF", true);
+static void onLightCmd(MsgView msg) {
+  if (msg.ieq("ON")) light_on();
+  else if (msg.ieq("OFF")) light_off();
+  else if (msg.ieq("TOGGLE")) light_toggle();
+  net_mqtt_publish(TOPIC_LIGHT_STATE, light_is_on() ? "ON" : "OFF", true);
+}
+
+static void onLightBreathCmd(MsgView msg) {
+  if (msg.ieq("ON")) {
+    light_set_breath_mode(true);
+  } else if (msg.ieq("OFF")) {
+    light_set_breath_mode(false);
+  }
+  net_mqtt_publish(TOPIC_LIGHT_BREATH_STATE, light_get_breath_mode() ? "ON" : "OFF", true);
+}
+
+static void onParamGetCmd(MsgView msg) { params_handle_get(msg); }
+static void onParamSetCmd(MsgView msg) { params_handle_set(msg); }
 
-  } else if (t == TOPIC_LIGHT_DIM_CMD) {
+static void onLightDimCmd(MsgView msg) {
 #if LIGHT_PWM_ENABLED
-    bool isPercent = (msg.endsWith("%"));
-    long v = msg.toInt();
-    if (isPercent) {
-      if (v < 0) v = 0;
-      if (v > 100) v = 100;
-      light_set_percent((uint8_t)v);
-    } else {
-      if (v < 0) v = 0;
-      long vmax = (long)((1U << LIGHT_PWM_RES_BITS) - 1);
-      if (v > vmax) v = vmax;
-      light_set_level((uint16_t)v);
-    }
-    net_mqtt_publish(TOPIC_LIGHT_DIM, String(light_get_level()), true);
-    if (!light_is_on() && light_get_level() > 0) {
-      light_on();
-      net_mqtt_publish(TOPIC_LIGHT_STATE, "ON", true);
-    }
+  bool isPercent = msg.ends_with('%');
+  long v;
+  if (!msg.to_long(v)) {
+    logPrintf("[LIGHT] Valor de dimmer inválido: '%.*s'\n", (int)msg.n, msg.p);
+    return;
+  }
+  if (isPercent) {
+    if (v < 0) v = 0;
+    if (v > 100) v = 100;
+    light_set_percent((uint8_t)v);
+  } else {
+    if (v < 0) v = 0;
+    long vmax = (long)((1U << LIGHT_PWM_RES_BITS) - 1);
+    if (v > vmax) v = vmax;
+    light_set_level((uint16_t)v);
+  }
+  publish_uint(TOPIC_LIGHT_DIM, light_get_level(), true);
+  if (!light_is_on() && light_get_level() > 0) {
+    light_on();
+    net_mqtt_publish(TOPIC_LIGHT_STATE, "ON", true);
+  }
 #else
-    logPrintln("[LIGHT] PWM deshabilitado; usa ON/OFF.");
+  (void)msg;
+  logPrintln("[LIGHT] PWM deshabilitado; usa ON/OFF.");
 #endif
+}
+
+// Solo topics de entrada: nuestros topics de estado (retained) no se suscriben
+static constexpr auto ROUTES = sortRoutes(std::array<TopicRoute, 14>{{
+  ROUTE(TOPIC_CMD,              onCmd),
+  ROUTE(TOPIC_OPEN_CMD,         onOpenCmd),
+  ROUTE(TOPIC_CLOSE_CMD,        onCloseCmd),
+  ROUTE(TOPIC_GOTO_CMD,         onGotoCmd),
+  ROUTE(TOPIC_ILIMIT_CMD,       onIlimitCmd),
+  ROUTE(TOPIC_SPEED_CMD,        onSpeedCmd),
+  ROUTE(TOPIC_MARK_CLOSED_CMD,  onMarkClosedCmd),
+  ROUTE(TOPIC_MARK_OPEN_CMD,    onMarkOpenCmd),
+  ROUTE(TOPIC_HALL_EN_CMD,      onHallEnCmd),
+  ROUTE(TOPIC_LIGHT_CMD,        onLightCmd),
+  ROUTE(TOPIC_LIGHT_DIM_CMD,    onLightDimCmd),
+  ROUTE(TOPIC_LIGHT_BREATH_CMD, onLightBreathCmd),
+  ROUTE(TOPIC_PARAM_GET,        onParamGetCmd),
+  ROUTE(TOPIC_PARAM_SET,        onParamSetCmd),
+}});
+static_assert(routesUnique(ROUTES), "Colisión de hash entre topics de ROUTES");
+
+static void mqttSubscribeAll() {
+  for (const TopicRoute &r : ROUTES)
+    esp_mqtt_client_subscribe(s_mqtt, r.topic, 0);
+}
+
+// Tarea MQTT: solo copia y encola (sin logs ni módulos)
+static void mqttOnData(esp_mqtt_event_handle_t ev) {
+  // Mensajes troceados (mayores que el buffer) o más largos que InMsg: fuera
+  if (ev->current_data_offset != 0 || ev->data_len != ev->total_data_len ||
+      ev->data_len > (int)MQTT_IN_MAX) {
+    s_inDropped++;
+    return;
   }
+  const TopicRoute *r = findRoute(ROUTES, ev->topic, (size_t)ev->topic_len);
+  if (!r)
+    return;
+  InMsg m;
+  m.route = (uint8_t)(r - ROUTES.data());
+  m.len = (uint16_t)ev->data_len;
+  memcpy(m.data, ev->data, m.len);
+  if (!s_inbox.push(m))
+    s_inDropped++;
+}
+
+static void mqttEventHandler(void *, esp_event_base_t, int32_t id, void *data) {
+  esp_mqtt_event_handle_t ev = (esp_mqtt_event_handle_t)data;
+  switch ((esp_mqtt_event_id_t)id) {
+    case MQTT_EVENT_CONNECTED:
+      mqttSubscribeAll();      // escribe en el socket: aquí, no en la tarea de red
+      s_mqttUp = true;
+      s_mqttConnects++;
+      break;
+    case MQTT_EVENT_DISCONNECTED:
+      if (s_mqttUp.exchange(false)) s_mqttDisconnects++;
+      break;
+    case MQTT_EVENT_DATA:
+      mqttOnData(ev);
+      break;
+    default:
+      break;
+  }
+}
+
+// Tarea de red: manejadores de los mensajes recibidos
+static void mqttDispatchInbox() {
+  InMsg m;
+  while (s_inbox.pop(m))
+    ROUTES[m.route].fn(MsgView(m.data, m.len).trimmed());
 }
 
 
 // =====================================================
-//            CONEXIÓN MQTT CON RETRY NO BLOQUEANTE
+//         WIFI: EVENTOS Y RECONEXIÓN RÁPIDA
 // =====================================================
 
-static bool mqttEnsureConnected() {
-  if (!net_wifi_connected())
-    return false;
-  if (mqtt.connected())
-    return true;
+// Tarea de eventos: solo marcas de tiempo y contadores
+static void wifiEvent(arduino_event_id_t ev, arduino_event_info_t info) {
+  switch (ev) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      s_wifiTGotIp = millis();
+      s_wifiUp = true;
+      s_wifiGotIp++;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      if (s_wifiUp.exchange(false)) s_wifiTLost = millis();
+      s_wifiReason = info.wifi_sta_disconnected.reason;
+      s_wifiDisc++;
+      break;
+    default:
+      break;
+  }
+}
 
-  uint32_t now = millis();
-  if (now < tNextMqttRetry)
-    return false; // aún no toca reintentar
+static bool wifiCacheValid() {
+  return s_wifiCache.magic == WIFI_CACHE_MAGIC && s_wifiCache.channel != 0;
+}
 
-  String clientId = String("esp32-garaje-") + String((uint32_t)ESP.getEfuseMac(), HEX);
-  logPrint("[MQTT] Conectando...");
+static void wifiCacheLoad() {
+  if (s_wifiRtc.magic == WIFI_CACHE_MAGIC)
+    s_wifiCache = s_wifiRtc;
+  else if (cfg_get_blob(CFG_WIFI_CACHE, &s_wifiCache, sizeof(s_wifiCache)) != sizeof(s_wifiCache))
+    s_wifiCache.magic = 0;
+}
 
-  bool ok;
-  if (mqtt_user && strlen(mqtt_user))
-    ok = mqtt.connect(clientId.c_str(), mqtt_user, mqtt_pass);
-  else
-    ok = mqtt.connect(clientId.c_str());
-
-  if (ok) {
-    logPrintln(" OK");
-    mqttRetryDelayMs = 1000;
-    tNextMqttRetry = 0;
-    mqttSubscribeAll();
-    mqttPublishBootState();
-    return true;
+// Guarda BSSID/canal/IP actuales; NVS solo si cambian (p. ej. otro AP)
+static void wifiCacheStore() {
+  WifiCache c = {};
+  c.magic = WIFI_CACHE_MAGIC;
+  const uint8_t *b = WiFi.BSSID();
+  if (b) memcpy(c.bssid, b, sizeof(c.bssid));
+  c.channel = (uint8_t)WiFi.channel();
+  c.ip   = (uint32_t)WiFi.localIP();
+  c.gw   = (uint32_t)WiFi.gatewayIP();
+  c.mask = (uint32_t)WiFi.subnetMask();
+  c.dns  = (uint32_t)WiFi.dnsIP();
+  s_wifiRtc = c;
+  if (memcmp(&c, &s_wifiCache, sizeof(c)) != 0) {
+    s_wifiCache = c;
+    cfg_set_blob(CFG_WIFI_CACHE, &s_wifiCache, sizeof(s_wifiCache));
+  }
+}
+
+static void wifiAttempt(uint32_t now, bool fast) {
+  s_wifiDiscSeen = s_wifiDisc.load();
+  s_wifiTAttempt = now;
+  s_wifiWasFast = fast;
+  if (fast) {
+#if WIFI_CACHE_STATIC_IP
+    WiFi.config(IPAddress(s_wifiCache.ip), IPAddress(s_wifiCache.gw),
+                IPAddress(s_wifiCache.mask), IPAddress(s_wifiCache.dns));
+#endif
+    WiFi.begin(ssid, password, s_wifiCache.channel, s_wifiCache.bssid, true);
+    s_wifiPhase = WIFI_FAST;
+    s_wifiTimeout = WIFI_FAST_TIMEOUT_MS;
+  } else {
+#if WIFI_CACHE_STATIC_IP
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));   // DHCP
+#endif
+    WiFi.begin(ssid, password);
+    s_wifiPhase = WIFI_SCAN;
+    s_wifiTimeout = WIFI_SCAN_TIMEOUT_MS;
+  }
+}
+
+// Espera aleatoria en [backoff/2, backoff]; el siguiente backoff se dobla hasta el tope
+static void wifiWait(uint32_t now) {
+  s_wifiPhase = WIFI_WAIT;
+  s_wifiTAttempt = now;
+  s_wifiTimeout = s_wifiBackoffMs / 2 + esp_random() % (s_wifiBackoffMs / 2 + 1);
+  s_wifiBackoffMs = (s_wifiBackoffMs < WIFI_BACKOFF_MAX_MS / 2) ? s_wifiBackoffMs * 2 : WIFI_BACKOFF_MAX_MS;
+}
+
+static void wifiOnConnected() {
+  const bool boot = (s_wifiGotIpSeen == 0);
+  s_wifiGotIpSeen = s_wifiGotIp.load();
+  uint32_t ms = s_wifiTGotIp.load() - (boot ? 0 : s_wifiTLost.load());
+  if (boot) {
+    s_wifiBootMs = ms;
   } else {
-    logPrintf(" fallo (%d)\n", mqtt.state());
-    mqttRetryDelayMs = (mqttRetryDelayMs < MQTT_RETRY_DELAY_MAX) ? (mqttRetryDelayMs * 2) : MQTT_RETRY_DELAY_MAX;
-    tNextMqttRetry = now + mqttRetryDelayMs;
+    s_wifiReconnects++;
+    s_wifiLastMs = ms;
+    if (ms > s_wifiMaxMs) s_wifiMaxMs = ms;
+  }
+  if (s_wifiWasFast) s_wifiFastOk++;
+  s_wifiPhase = WIFI_UP;
+  s_wifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+  wifiCacheStore();
+
+  IPAddress ip = WiFi.localIP();
+  logPrintf("\n[WiFi] Conectado: %u.%u.%u.%u (%s, %lu ms)\n", ip[0], ip[1], ip[2], ip[3],
+            s_wifiWasFast ? "directo" : "escaneo", (unsigned long)ms);
+}
+
+// Devuelve true con IP. Tras una pérdida: intento dirigido y, si falla,
+// intentos con escaneo separados por wifiWait().
+static bool wifiStep(uint32_t now) {
+  if (s_wifiUp) {
+    if (s_wifiGotIp.load() != s_wifiGotIpSeen)
+      wifiOnConnected();
+    return true;
+  }
+
+  if (s_wifiPhase == WIFI_UP) {
+    logPrintf("[WiFi] Perdido (motivo %u)\n", (unsigned)s_wifiReason.load());
+    s_wifiBackoffMs = WIFI_BACKOFF_MIN_MS;
+    if (wifiCacheValid()) wifiAttempt(now, true);
+    else                  wifiWait(now);
+    return false;
+  }
+
+  // Un intento termina con DISCONNECTED (fallo inmediato) o por tiempo
+  bool failed = (s_wifiPhase != WIFI_WAIT) && s_wifiDisc.load() != s_wifiDiscSeen;
+  if (!failed && now - s_wifiTAttempt < s_wifiTimeout)
     return false;
+
+  if (s_wifiPhase == WIFI_WAIT) {
+    logPrint(".");
+    wifiAttempt(now, false);
+  } else {
+    if (!failed) WiFi.disconnect(false, false);   // cancelar el intento colgado
+    wifiWait(now);
+  }
+  return false;
+}
+
+
+// =====================================================
+//            CONEXIÓN MQTT (esp-mqtt, asíncrona)
+// =====================================================
+
+static void mqttStart() {
+  static char clientId[32];
+  StackText<32> id;
+  id.str("esp32-garaje-").hex((uint32_t)ESP.getEfuseMac());
+  strncpy(clientId, id.c_str(), sizeof(clientId) - 1);
+
+  esp_mqtt_client_config_t cfg = {};
+  cfg.broker.address.hostname = mqtt_host;
+  cfg.broker.address.port = mqtt_port;
+  cfg.broker.address.transport = MQTT_TRANSPORT_OVER_TCP;
+  cfg.credentials.client_id = clientId;
+  if (mqtt_user && strlen(mqtt_user)) {
+    cfg.credentials.username = mqtt_user;
+    cfg.credentials.authentication.password = mqtt_pass;
+  }
+  cfg.session.keepalive = 10;                          // keepalive corto
+  cfg.network.reconnect_timeout_ms = MQTT_RECONNECT_MS;
+  cfg.network.timeout_ms = MQTT_NETWORK_TIMEOUT_MS;
+  cfg.buffer.size = MQTT_BUFFER_BYTES;
+  cfg.outbox.limit = MQTT_OUTBOX_BYTES;
+
+  s_mqtt = esp_mqtt_client_init(&cfg);
+  esp_mqtt_client_register_event(s_mqtt, MQTT_EVENT_ANY, mqttEventHandler, nullptr);
+  esp_mqtt_client_start(s_mqtt);   // a partir de aquí reconecta sola
+  s_mqttStarted = true;
+  logPrintln("[MQTT] Cliente iniciado");
+}
+
+// Cambios de conexión vistos desde la tarea de red
+static void mqttPollConnection() {
+  uint32_t c = s_mqttConnects.load();
+  if (c != s_mqttConnectsSeen && net_mqtt_connected()) {
+    s_mqttConnectsSeen = c;
+    logPrintln("[MQTT] Conectado");
+    pubq_on_connected();       // reenviar los retenidos
+    logx_on_mqtt_connected();
   }
 }
 
 
+// =====================================================
+//          TELEMETRÍA MQTT (trabajos del planificador)
+// =====================================================
+// Cada publicación es un trabajo periódico de la tarea de red; sin conexión
+// se saltan. La telemetría no debe reservar heap (HeapWatch).
+
+static SchedJob jobSignals, jobIoffset, jobCtl, jobProf, jobSched, jobSys;
+
+// ---- Señales en vivo: política adaptativa al movimiento ----
+// Cada señal tiene un intervalo mínimo en movimiento y otro en reposo y una
+// banda muerta: se publica cuando vence el intervalo y el valor ha cambiado
+// al menos la banda, o cuando vence el latido (TELEM_HEARTBEAT_MS). Al
+// pararse la puerta salen todas enseguida con la muestra final.
+struct SignalPolicy {
+  const char* name;
+  const char* topic;
+  uint16_t    moveMs;
+  uint16_t    idleMs;
+  float       deadband;
+  uint8_t     decimals;   // 0 = entero
+  float     (*read)(const CtlSnapshot& s);
+};
+
+static const SignalPolicy SIGNALS[] = {
+  { "imeas", TOPIC_IMEAS,   100, 1000, 0.05f, 2, [](const CtlSnapshot& s) { return s.mA * 0.001f; } },
+  { "pos",   TOPIC_ENC_POS, 100, 1000, 1.0f,  0, [](const CtlSnapshot& s) { return (float)s.pos; } },
+  { "dir",   TOPIC_ENC_DIR, 100, 1000, 1.0f,  0, [](const CtlSnapshot& s) { return (float)s.dir; } },
+  { "vel",   TOPIC_ENC_VEL, 100, 1000, 20.0f, 1, [](const CtlSnapshot& s) { return s.vel; } },
+};
+static const uint8_t SIGNAL_COUNT = sizeof(SIGNALS) / sizeof(SIGNALS[0]);
+
+struct SignalState {
+  float    last;
+  uint32_t lastMs;
+  bool     sent;
+  uint32_t pubs;          // publicaciones en la ventana de estadísticas
+};
+static SignalState s_sig[SIGNAL_COUNT];
+static bool        s_sigWasMoving = false;
+static uint32_t    s_sigWindowStart = 0;
+
+static void publishSignal(uint8_t i, float v, uint32_t now) {
+  const SignalPolicy& p = SIGNALS[i];
+  StackText<16> t;
+  if (p.decimals) t.fix(v, p.decimals);
+  else            t.num(lroundf(v));
+  net_mqtt_publish(p.topic, t.c_str(), false);
+  s_sig[i] = { v, now, true, s_sig[i].pubs + 1 };
+}
+
+static void telemSignals(uint32_t now) {
+  if (!net_mqtt_connected()) return;
+  HeapWatch hw;
+  const CtlSnapshot& snap = tasks_snapshot();
+  bool moving  = (snap.estado == ABRIENDO || snap.estado == CERRANDO);
+  bool stopped = s_sigWasMoving && !moving;
+  s_sigWasMoving = moving;
+
+  for (uint8_t i = 0; i < SIGNAL_COUNT; ++i) {
+    const SignalPolicy& p = SIGNALS[i];
+    SignalState& st = s_sig[i];
+    float v = p.read(snap);
+    uint32_t age = now - st.lastMs;
+    bool due = !st.sent || stopped || age >= TELEM_HEARTBEAT_MS ||
+               (age >= (moving ? p.moveMs : p.idleMs) && fabsf(v - st.last) >= p.deadband);
+    if (due) publishSignal(i, v, now);
+  }
+}
+
+// Offset del sensor y deriva cada 60s
+static void telemIoffset(uint32_t) {
+  if (!net_mqtt_connected()) return;
+  HeapWatch hw;
+  StackText<64> js;
+  JsonBuf(js)
+    .fix("vzero", current_get_offset_V(), 4)
+    .fix("drift_mv", current_offset_drift_mV(), 1)
+    .flag("valid", current_offset_valid())
+    .end();
+  net_mqtt_publish(TOPIC_IOFFSET, js.c_str(), false);
+}
+
+// Jitter del periodo de control cada 10s
+static void telemCtl(uint32_t) {
+  if (!net_mqtt_connected()) return;
+  HeapWatch hw;
+  CtlTiming tm;
+  tasks_get_timing(tm, true);
+  StackText<128> js;
+  JsonBuf(js)
+    .unum("period_us", CONTROL_PERIOD_MS * 1000UL)
+    .unum("n", tm.samples)
+    .unum("min_us", tm.periodMinUs)
+    .unum("avg_us", tm.periodAvgUs)
+    .unum("max_us", tm.periodMaxUs)
+    .unum("exec_max_us", tm.execMaxUs)
+    .unum("overruns", tm.overruns)
+    .end();
+  net_mqtt_publish(TOPIC_CTL_TIMING, js.c_str(), false);
+}
+
+// Tiempos por subsistema (ventana de PROF_PUBLISH_MS)
+static void telemProf(uint32_t) {
+  if (!net_mqtt_connected()) return;
+  HeapWatch hw;
+  StackText<MQTT_BUFFER_BYTES - 64> js;
+  prof_format(js, true);
+  net_mqtt_publish(TOPIC_PROF, js.c_str(), false);
+}
+
+// Overruns y retrasos del planificador
+static void telemSched(uint32_t) {
+  if (!net_mqtt_connected()) return;
+  HeapWatch hw;
+  StackText<MQTT_BUFFER_BYTES - 64> js;
+  sched_format(js);
+  net_mqtt_publish(TOPIC_SCHED, js.c_str(), false);
+}
+
+// Heap (reservas en rutas vigiladas, estado general), log y NVS cada 60s
+static void telemSys(uint32_t) {
+  if (!net_mqtt_connected()) return;
+  HeapWatch hw;
+  HeapStats hs;
+  heapmon_stats(hs);
+  StackText<128> js;
+  JsonBuf j(js);
+  if (heapmon_supported()) j.unum("allocs", heapmon_watched_allocs());
+  else                     j.num("allocs", -1);
+  j.unum("free", hs.freeBytes)
+   .unum("min_free", hs.minFree)
+   .unum("largest", hs.largest)
+   .unum("blocks", hs.blocks)
+   .end();
+  net_mqtt_publish(TOPIC_HEAP, js.c_str(), false);
+
+  LogStats ls;
+  logx_get_stats(ls);
+  js.clear();
+  JsonBuf(js)
+    .unum("lines", ls.lines)
+    .unum("truncated", ls.truncated)
+    .unum("drop_serial", ls.dropSerial)
+    .unum("drop_mqtt", ls.dropMqtt)
+    .unum("high_water", ls.highWater)
+    .end();
+  net_mqtt_publish(TOPIC_LOG_STATS, js.c_str(), false);
+
+  StackText<256> nv;
+  JsonBuf jn(nv);
+  jn.unum("flushes", cfg_flush_count());
+  for (uint8_t k = 0; k < CFG_KEY_COUNT; ++k)
+    jn.unum(cfg_key_name((CfgKey)k), cfg_write_count((CfgKey)k));
+  jn.end();
+  net_mqtt_publish(TOPIC_NVS_STATS, nv.c_str(), false);
+
+  // Publicaciones por señal desde el último informe (ahorro de la política)
+  js.clear();
+  JsonBuf jt(js);
+  jt.unum("window_s", (millis() - s_sigWindowStart) / 1000UL);
+  for (uint8_t i = 0; i < SIGNAL_COUNT; ++i) {
+    jt.unum(SIGNALS[i].name, s_sig[i].pubs);
+    s_sig[i].pubs = 0;
+  }
+  jt.unum("bin", telem_batches_sent(true)).end();
+  s_sigWindowStart = millis();
+  net_mqtt_publish(TOPIC_TELEM_STATS, js.c_str(), false);
+
+  PubqStats ps;
+  pubq_get_stats(ps, true);
+  js.clear();
+  JsonBuf(js)
+    .unum("sent", ps.sent)
+    .unum("dedup", ps.dedup)
+    .unum("coalesced", ps.coalesced)
+    .unum("dropped", ps.dropped)
+    .unum("high_water", ps.highWater)
+    .end();
+  net_mqtt_publish(TOPIC_PUBQ_STATS, js.c_str(), false);
+
+  // Conectividad: peor duración de net_tick(), reconexiones Wi-Fi y eventos MQTT
+  StackText<320> nt;
+  JsonBuf(nt)
+    .unum("tick_max_us", s_tickMaxUs)
+    .unum("tick_max_ever_us", s_tickMaxEverUs)
+    .unum("wifi_boot_ms", s_wifiBootMs)
+    .unum("wifi_reconnects", s_wifiReconnects)
+    .unum("wifi_fast_ok", s_wifiFastOk)
+    .unum("wifi_last_ms", s_wifiLastMs)
+    .unum("wifi_max_ms", s_wifiMaxMs)
+    .unum("wifi_reason", s_wifiReason.load())
+    .unum("mqtt_connects", s_mqttConnects.load())
+    .unum("mqtt_disconnects", s_mqttDisconnects.load())
+    .unum("in_dropped", s_inDropped.load())
+    .end();
+  s_tickMaxUs = 0;
+  net_mqtt_publish(TOPIC_NET_STATS, nt.c_str(), false);
+}
+
+
 // =====================================================
 //                   INICIO DE LA RED
 // =====================================================
 
 void net_begin() {
+  Serial.setTxBufferSize(LOG_SERIAL_TX_BUF);   // el log escribe sin bloquear
   Serial.begin(115200);
   delay(50);
   logPrintln("\n[BOOT] ESP32 Garaje");
 
   WiFi.mode(WIFI_STA);
   WiFi.setSleep(true);
-  WiFi.begin(ssid, password);
-  retryDelayMs = 1000;
-  tNextRetry = millis() + retryDelayMs;
-
-  // Configuración MQTT para minimizar bloqueos
-  mqtt.setServer(mqtt_host, mqtt_port);
-  mqtt.setCallback(mqttCallback);
-  mqtt.setKeepAlive(10);     // keepalive corto
-  mqtt.setSocketTimeout(1);  // timeout corto
-
+  WiFi.persistent(false);         // credenciales y caché son nuestras
+  WiFi.setAutoReconnect(false);   // la reconexión la lleva wifiStep()
+  WiFi.onEvent(wifiEvent);
+  wifiCacheLoad();
+  wifiAttempt(millis(), wifiCacheValid());
+
+  sched_every(jobSignals, SCHED_NET, "t_signals", TELEM_MOVE_MS,    6, telemSignals);
+  sched_every(jobIoffset, SCHED_NET, "t_ioffset", 60000,            7, telemIoffset);
+  sched_every(jobCtl,     SCHED_NET, "t_ctl",     10000,            7, telemCtl);
+  sched_every(jobProf,    SCHED_NET, "t_prof",    PROF_PUBLISH_MS,  7, telemProf);
+  sched_every(jobSched,   SCHED_NET, "t_sched",   SCHED_PUBLISH_MS, 7, telemSched);
+  sched_every(jobSys,     SCHED_NET, "t_sys",     60000,            7, telemSys);
+
+  net_mqtt_publish(TOPIC_INFO, "{\"boot\":true}", false);   // sale con la primera conexión
   logPrintln("[WiFi] Conectando...");
 }
 
@@ -321,95 +868,35 @@ void net_begin() {
 //                   CICLO PRINCIPAL
 // =====================================================
 
-void net_tick() {
-  uint32_t now = millis();
-
-  // -----------------------------------------
-  // 1) CONTROL LOCAL (funciona sin WiFi)
-  // -----------------------------------------
-
-  // a) Detectar inicio de movimiento -> blanking sobrecorriente
-  static uint32_t tMoveSince = 0;
-  static int prevEstadoInt = -1;
-  int eNow = (int)getEstado();
-  if (eNow != prevEstadoInt) {
-    if (eNow == ABRIENDO || eNow == CERRANDO)
-      tMoveSince = now;
-    prevEstadoInt = eNow;
-  }
-
-  // b) Rampa del motor (local)
-  static uint32_t tLastMotor = 0;
-  if (now - tLastMotor >= MOTOR_TICK_MS) {
-    motor_tick();
-    tLastMotor = now;
-  }
+static void netTickBody(uint32_t now) {
+  // El control local (rampa del motor, guardia de sobrecorriente) corre en
+  // la tarea de control; aquí solo conectividad. La telemetría son trabajos
+  // del planificador registrados en net_begin().
 
-  // c) Guardia de sobrecorriente
-  static uint32_t tLastIcheck = 0;
-  static bool overIEvent = false;
-  if ((eNow == ABRIENDO || eNow == CERRANDO) &&
-      (now - tMoveSince) >= CURRENT_BLANKING_MS &&
-      (now - tLastIcheck) >= CURRENT_CHECK_PERIOD_MS) {
-    if (current_guard_stop_if_over()) {
-      overIEvent = true;
-      Serial.println("[I] Corte por sobrecorriente");
-    }
-    tLastIcheck = now;
-  }
+  // Log pendiente: Serial siempre, MQTT si hay conexión
+  logx_flush();
 
   // -----------------------------------------
-  // 2) CONECTIVIDAD (WiFi + MQTT)
+  // 1) CONECTIVIDAD (WiFi + MQTT)
   // -----------------------------------------
 
-  // WiFi reconexión
-  if (WiFi.status() != WL_CONNECTED) {
-    if (now >= tNextRetry) {
-      logPrint(".");
-      WiFi.reconnect();
-      retryDelayMs = (retryDelayMs < RETRY_DELAY_MAX) ? (retryDelayMs * 2) : RETRY_DELAY_MAX;
-      tNextRetry = now + retryDelayMs;
-    }
-    ipShown = false;
+  // WiFi (eventos + reconexión rápida)
+  if (!wifiStep(now))
     return;  // sin WiFi, termina aquí
-  }
-
-  if (!ipShown) {
-    ipShown = true;
-    logPrintf("\n[WiFi] Conectado: %s\n", WiFi.localIP().toString().c_str());
-  }
 
-  // MQTT reconexión + loop
-  (void)mqttEnsureConnected();
-  if (mqtt.connected())
-    mqtt.loop();
-
-  // -----------------------------------------
-  // 3) TELEMETRÍA MQTT (si hay conexión)
-  // -----------------------------------------
-
-  if (mqtt.connected()) {
-    // Corriente cada 2s
-    static uint32_t tLastCurrent = 0;
-    if (now - tLastCurrent >= 2000) {
-      float I = current_readA();
-      net_mqtt_publish(TOPIC_IMEAS, String(I, 2), false);
-      tLastCurrent = now;
-    }
-
-    // Encoder cada 500ms
-    static uint32_t tLastEnc = 0;
-    if (now - tLastEnc >= 500) {
-      long pos = hall_get_count();
-      int dir = hall_get_dir();
-      net_mqtt_publish(TOPIC_ENC_POS, String(pos), false);
-      net_mqtt_publish(TOPIC_ENC_DIR, String(dir), false);
-      tLastEnc = now;
-    }
+  // MQTT: el cliente arranca con la primera IP y después se gestiona solo
+  if (!s_mqttStarted)
+    mqttStart();
+  mqttPollConnection();
+  mqttDispatchInbox();
+  if (net_mqtt_connected())
+    pubq_flush(mqttSend);      // todo lo encolado desde la pasada anterior (al outbox)
+}
 
-    if (overIEvent) {
-      net_mqtt_publish(TOPIC_LOG, String("[I] Corte por sobrecorriente"), false);
-      overIEvent = false;
-    }
-  }
+void net_tick() {
+  int64_t t0 = esp_timer_get_time();
+  netTickBody(millis());
+  uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+  if (us > s_tickMaxUs) s_tickMaxUs = us;
+  if (us > s_tickMaxEverUs) s_tickMaxEverUs = us;
 }
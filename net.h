@@ -2,9 +2,15 @@
 #include <Arduino.h>
 
 void net_begin();              // iniciar WiFi + MQTT (siempre ON)
-void net_tick();               // reconexiones, mqtt.loop()
+void net_tick();               // Wi-Fi, entradas MQTT y cola de salida (no bloquea)
+void net_publish_state();      // valores iniciales de los topics retenidos (tras los *_begin)
 
 bool net_wifi_connected();
 bool net_mqtt_connected();
 
-void net_mqtt_publish(const char* topic, const String& payload, bool retain=false);
\ No newline at end of file
+// Publicación sin heap desde cualquier tarea: se copia a la cola de salida
+// (pubq.h) y la tarea de red la envía en su próxima pasada. false = la cola
+// no la admite; con keep el llamante conserva el mensaje y lo reintenta
+// (no se cuenta como descarte).
+bool net_mqtt_publish(const char* topic, const char* payload, bool retain=false);
+bool net_mqtt_publish(const char* topic, const uint8_t* payload, size_t len, bool retain=false, bool keep=false);
\ No newline at end of file
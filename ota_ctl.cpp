@@ -2,6 +2,8 @@
 #include <ArduinoOTA.h>
 #include "logx.h"
 #include "net.h"
+#include "heapmon.h"
+#include "cfgstore.h"
 #include "config.h"
 #include "secrets.h"
 
@@ -9,14 +11,18 @@ static bool     otaOn   = false;
 static uint32_t otaUntil = 0; // millis límite
 
 static void publishOtaStatus() {
-  net_mqtt_publish(TOPIC_OTA, String(otaOn ? "ON" : "OFF"), true);
+  HeapWatch hw;
+  net_mqtt_publish(TOPIC_OTA, otaOn ? "ON" : "OFF", true);
 }
 
 void ota_enable_for(uint32_t minutes) {
   if (!otaOn) {
     ArduinoOTA.setHostname("esp32-garaje");
     ArduinoOTA.setPassword(ota_password);
-    ArduinoOTA.onStart([](){ logPrintln("\n[OTA] Inicio de actualización"); });
+    ArduinoOTA.onStart([](){
+      cfg_flush_now();   // lo pendiente a flash antes de reescribir la app
+      logPrintln("\n[OTA] Inicio de actualización");
+    });
     ArduinoOTA.onEnd([](){ logPrintln("\n[OTA] Fin. Reiniciando..."); });
     ArduinoOTA.onProgress([](unsigned int p, unsigned int t){
       static uint8_t last = 255; uint8_t pct = (p*100)/t;
@@ -0,0 +1,264 @@
+#include "params.h"
+#include <stddef.h>   // offsetof
+#include "cfgstore.h"
+#include "logx.h"
+#include "net.h"
+
+// Valores en uso, arrancan con los de config.h
+Params params = {
+#define PARAM_INIT(f, ct, pt, n, mn, mx, d, u) (ct)(d),
+  PARAM_TABLE(PARAM_INIT)
+#undef PARAM_INIT
+};
+
+struct ParamDef {
+  const char* name;
+  const char* unit;
+  ParamType   type;
+  uint16_t    offset;    // dentro de Params
+  float       min, max, def;
+};
+
+static const ParamDef DEFS[] = {
+#define PARAM_DEF(f, ct, pt, n, mn, mx, d, u) { n, u, pt, (uint16_t)offsetof(Params, f), (float)(mn), (float)(mx), (float)(d) },
+  PARAM_TABLE(PARAM_DEF)
+#undef PARAM_DEF
+};
+static const size_t PARAM_COUNT = sizeof(DEFS) / sizeof(DEFS[0]);
+
+// Todos los campos ocupan 32 bits: se leen/escriben como palabra (atómico)
+#define PARAM_SIZE_CHECK(f, ct, pt, n, mn, mx, d, u) static_assert(sizeof(ct) == 4, "param " n " no es de 32 bits");
+PARAM_TABLE(PARAM_SIZE_CHECK)
+#undef PARAM_SIZE_CHECK
+
+// ---------------- Blob en NVS ----------------
+// Cada valor va con el hash de su nombre: añadir, quitar o reordenar
+// parámetros no invalida lo guardado (lo desconocido se ignora).
+static const uint16_t PARAM_BLOB_VERSION  = 1;
+static const size_t   PARAM_BLOB_MAX_RECS = 256;   // más es un blob corrupto
+
+struct ParamRec  { uint32_t nameHash; uint32_t raw; };
+struct ParamBlob { uint16_t version; uint16_t count; ParamRec rec[PARAM_COUNT]; };
+
+static ParamBlob s_blob;      // cfgstore lo escribe desde aquí (debe seguir vivo)
+
+static uint32_t* slot(size_t i) {
+  return (uint32_t*)((uint8_t*)&params + DEFS[i].offset);
+}
+
+static float as_float(size_t i, uint32_t raw) {
+  switch (DEFS[i].type) {
+    case PT_I32: return (float)(int32_t)raw;
+    case PT_U32: return (float)raw;
+    case PT_F32: { float f; memcpy(&f, &raw, 4); return f; }
+  }
+  return 0.0f;
+}
+
+static bool in_range(size_t i, uint32_t raw) {
+  float v = as_float(i, raw);
+  return v >= DEFS[i].min && v <= DEFS[i].max;
+}
+
+static void save() {
+  s_blob.version = PARAM_BLOB_VERSION;
+  s_blob.count   = (uint16_t)PARAM_COUNT;
+  for (size_t i = 0; i < PARAM_COUNT; ++i) {
+    s_blob.rec[i].nameHash = fnv1a32(DEFS[i].name);
+    s_blob.rec[i].raw      = *slot(i);
+  }
+  cfg_set_blob(CFG_PARAMS, &s_blob, sizeof(s_blob));
+}
+
+void params_begin() {
+  // Lo guardado puede traer más o menos registros que esta versión: se lee
+  // con su tamaño real (NVS no lee un blob a trozos). Solo en el arranque.
+  size_t len = cfg_get_blob_len(CFG_PARAMS);
+  if (len == 0) return;   // nunca guardado: valores de config.h
+  if (len < 4 || len > 4 + PARAM_BLOB_MAX_RECS * sizeof(ParamRec)) {
+    logPrintf("[PARAM] Blob de %u bytes no válido; valores por defecto\n", (unsigned)len);
+    return;
+  }
+  uint8_t* raw = (uint8_t*)malloc(len);
+  if (!raw || cfg_get_blob(CFG_PARAMS, raw, len) != len) {
+    logPrintf("[PARAM] No se pudo leer el blob (%u bytes); valores por defecto\n", (unsigned)len);
+    free(raw);
+    return;
+  }
+
+  uint16_t version, count;
+  memcpy(&version, raw, 2);
+  memcpy(&count, raw + 2, 2);
+  if (version != PARAM_BLOB_VERSION) {
+    logPrintf("[PARAM] Blob v%u ignorado (esperado v%u)\n", (unsigned)version, (unsigned)PARAM_BLOB_VERSION);
+    free(raw);
+    return;
+  }
+  size_t n = (len - 4) / sizeof(ParamRec);
+  if (count < n) n = count;
+
+  unsigned loaded = 0, bad = 0;
+  for (size_t r = 0; r < n; ++r) {
+    ParamRec rec;
+    memcpy(&rec, raw + 4 + r * sizeof(ParamRec), sizeof(rec));
+    for (size_t i = 0; i < PARAM_COUNT; ++i) {
+      if (fnv1a32(DEFS[i].name) != rec.nameHash) continue;
+      if (in_range(i, rec.raw)) { *slot(i) = rec.raw; loaded++; }
+      else bad++;
+      break;
+    }
+  }
+  free(raw);
+  logPrintf("[PARAM] %u parametros cargados de NVS (%u fuera de rango)\n", loaded, bad);
+}
+
+// ---------------- MQTT ----------------
+
+static int find_param(MsgView name) {
+  for (size_t i = 0; i < PARAM_COUNT; ++i)
+    if (name.eq(DEFS[i].name)) return (int)i;
+  return -1;
+}
+
+static bool parse_value(size_t i, MsgView v, uint32_t& raw) {
+  if (DEFS[i].type == PT_F32) {
+    float f;
+    if (!v.to_float(f)) return false;
+    memcpy(&raw, &f, 4);
+    return true;
+  }
+  long l;
+  if (!v.to_long(l)) return false;
+  if (DEFS[i].type == PT_U32 && l < 0) return false;
+  raw = (uint32_t)l;
+  return true;
+}
+
+static void put_value(JsonBuf& js, const char* key, size_t i, float v) {
+  if (DEFS[i].type == PT_F32) js.fix(key, v, 3);
+  else                        js.num(key, (long)v);
+}
+
+static void put_current(JsonBuf& js, size_t i) {
+  uint32_t raw = *slot(i);
+  switch (DEFS[i].type) {
+    case PT_I32: js.num(DEFS[i].name, (int32_t)raw); break;
+    case PT_U32: js.unum(DEFS[i].name, raw);         break;
+    case PT_F32: js.fix(DEFS[i].name, as_float(i, raw), 3); break;
+  }
+}
+
+static bool is_sep(char c) {
+  return c == ' ' || c == ',' || c == ';' || c == '\t' || c == '\n' || c == '\r' || c == '{' || c == '}';
+}
+
+// Recorre "clave=valor" / "clave":valor separados por espacios, ',' o ';'
+template<typename Fn>
+static void for_each_pair(MsgView m, Fn fn) {
+  size_t k = 0;
+  while (k < m.n) {
+    while (k < m.n && is_sep(m.p[k])) ++k;
+    if (k >= m.n) break;
+    bool quoted = (m.p[k] == '"');
+    if (quoted) ++k;
+    size_t k0 = k;
+    while (k < m.n && m.p[k] != '=' && m.p[k] != ':' && m.p[k] != '"' && !is_sep(m.p[k])) ++k;
+    MsgView key(m.p + k0, k - k0);
+    if (quoted && k < m.n && m.p[k] == '"') ++k;
+    while (k < m.n && m.p[k] == ' ') ++k;
+    if (k < m.n && (m.p[k] == '=' || m.p[k] == ':')) ++k;
+    while (k < m.n && m.p[k] == ' ') ++k;
+    size_t v0 = k;
+    while (k < m.n && !is_sep(m.p[k])) ++k;
+    fn(key, MsgView(m.p + v0, k - v0));
+  }
+}
+
+// Respuestas troceadas para no pasar del buffer del cliente MQTT
+static const size_t PARAM_MSG_MAX   = 200;
+static const size_t PARAM_PER_CHUNK = 5;
+
+static bool selected(MsgView filter, const char* name) {
+  MsgView f = filter.trimmed();
+  if (f.n == 0 || f.ieq("all")) return true;
+  // Lista de nombres o prefijos separados por espacios o comas
+  size_t k = 0;
+  while (k < f.n) {
+    while (k < f.n && is_sep(f.p[k])) ++k;
+    size_t t0 = k;
+    while (k < f.n && !is_sep(f.p[k])) ++k;
+    if (k > t0 && strncmp(name, f.p + t0, k - t0) == 0) return true;
+  }
+  return false;
+}
+
+void params_handle_get(MsgView msg) {
+  MsgView m = msg.trimmed();
+
+  if (m.ieq("meta")) {
+    for (size_t i = 0; i < PARAM_COUNT; ++i) {
+      StackText<PARAM_MSG_MAX> t;
+      JsonBuf js(t);
+      js.str("name", DEFS[i].name);
+      put_value(js, "min", i, DEFS[i].min);
+      put_value(js, "max", i, DEFS[i].max);
+      put_value(js, "def", i, DEFS[i].def);
+      js.str("unit", DEFS[i].unit);
+      net_mqtt_publish(TOPIC_PARAM, js.end().c_str(), false);
+    }
+    return;
+  }
+
+  size_t i = 0, sent = 0;
+  while (i < PARAM_COUNT) {
+    StackText<PARAM_MSG_MAX> t;
+    JsonBuf js(t);
+    size_t inChunk = 0;
+    for (; i < PARAM_COUNT && inChunk < PARAM_PER_CHUNK; ++i) {
+      if (!selected(m, DEFS[i].name)) continue;
+      put_current(js, i);
+      inChunk++;
+    }
+    if (inChunk) net_mqtt_publish(TOPIC_PARAM, js.end().c_str(), false);
+    sent += inChunk;
+  }
+  if (sent == 0) net_mqtt_publish(TOPIC_PARAM, "{\"error\":\"no match\"}", false);
+}
+
+void params_handle_set(MsgView msg) {
+  MsgView m = msg.trimmed();
+  unsigned ok = 0, bad = 0;
+
+  if (m.ieq("defaults")) {
+    for (size_t i = 0; i < PARAM_COUNT; ++i) {
+      uint32_t raw;
+      if (DEFS[i].type == PT_F32) memcpy(&raw, &DEFS[i].def, 4);
+      else raw = (DEFS[i].type == PT_I32) ? (uint32_t)(int32_t)DEFS[i].def : (uint32_t)DEFS[i].def;
+      *slot(i) = raw;
+    }
+    ok = PARAM_COUNT;
+    LOGI("[PARAM] Valores por defecto restaurados\n");
+  } else {
+    for_each_pair(m, [&](MsgView key, MsgView val) {
+      int i = find_param(key);
+      uint32_t raw;
+      if (i < 0) {
+        LOGW("[PARAM] Desconocido: %.*s\n", (int)key.n, key.p);
+        bad++;
+      } else if (!parse_value(i, val, raw) || !in_range(i, raw)) {
+        LOGW("[PARAM] Rechazado %s=%.*s (rango %g..%g)\n", DEFS[i].name, (int)val.n, val.p, (double)DEFS[i].min, (double)DEFS[i].max);
+        bad++;
+      } else {
+        *slot(i) = raw;
+        ok++;
+      }
+    });
+  }
+
+  if (ok) save();
+
+  StackText<64> t;
+  JsonBuf js(t);
+  js.unum("set", ok).unum("rejected", bad);
+  net_mqtt_publish(TOPIC_PARAM, js.end().c_str(), false);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "msgbuf.h"
+
+// =====================================================
+//        Registro de parámetros ajustables en caliente
+// =====================================================
+// Cada parámetro tiene nombre, tipo, rango, valor por defecto (el #define de
+// config.h) y unidad. Los módulos leen el campo de `params` directamente: es
+// una variable global, igual de barata que antes la constante. Solo la tarea
+// de red escribe (MQTT); las escrituras son de 32 bits, atómicas en el ESP32.
+// Se guardan juntos en un blob versionado de NVS (params/blob, vía cfgstore).
+
+enum ParamType : uint8_t { PT_I32, PT_U32, PT_F32 };
+
+// X(campo, tipo C, tipo, nombre, mín, máx, defecto, unidad)
+#define PARAM_TABLE(X) \
+  X(currentBlankingMs,  uint32_t, PT_U32, "current.blanking_ms",   0,     5000,   CURRENT_BLANKING_MS,             "ms")  \
+  X(currentCheckMs,     uint32_t, PT_U32, "current.check_ms",      5,     500,    CURRENT_CHECK_PERIOD_MS,         "ms")  \
+  X(currentRequiredOver,uint32_t, PT_U32, "current.required_over", 1,     200,    CURRENT_REQUIRED_OVER,           "n")   \
+  X(ienvMarginMa,       int32_t,  PT_I32, "ienv.margin_ma",        0,     10000,  IENV_MARGIN_MA,                  "mA")  \
+  X(ienvMarginPct,      int32_t,  PT_I32, "ienv.margin_pct",       0,     200,    IENV_MARGIN_PCT,                 "%")   \
+  X(ienvRequiredOver,   uint32_t, PT_U32, "ienv.required_over",    1,     50,     IENV_REQUIRED_OVER,              "n")   \
+  X(motorRampStep,      int32_t,  PT_I32, "motor.ramp_step",       1,     100,    MOTOR_RAMP_STEP_PERCENT,         "%")   \
+  X(motorVelKp,         float,    PT_F32, "motor.vel_kp",          0,     10,     MOTOR_VEL_KP,                    "%/%") \
+  X(motorVelKi,         float,    PT_F32, "motor.vel_ki",          0,     50,     MOTOR_VEL_KI,                    "%/%s")\
+  X(motorVelIMax,       float,    PT_F32, "motor.vel_i_max",       0,     100,    MOTOR_VEL_I_MAX,                 "%")   \
+  X(trajAccMax,         float,    PT_F32, "traj.acc_max",          50,    20000,  TRAJ_ACC_MAX_CPS2,               "c/s2")\
+  X(trajJerkMax,        float,    PT_F32, "traj.jerk_max",         50,    100000, TRAJ_JERK_MAX_CPS3,              "c/s3")\
+  X(trajVMin,           float,    PT_F32, "traj.vmin",             1,     1000,   TRAJ_VMIN_CPS,                   "c/s") \
+  X(trajPosTol,         int32_t,  PT_I32, "traj.pos_tol",          0,     200,    TRAJ_POS_TOL,                    "c")   \
+  X(hallSlowPct,        int32_t,  PT_I32, "hall.slow_pct",         0,     50,     HALL_SLOWDOWN_THRESHOLD_PERCENT, "%")   \
+  X(hallStopDebounceMs, uint32_t, PT_U32, "hall.stop_debounce_ms", 0,     2000,   HALL_STOP_DEBOUNCE_MS,           "ms")  \
+  X(safetyMinCurrentA,  float,    PT_F32, "safety.min_current_a",  0,     5,      SAFETY_MIN_CURRENT_A,            "A")   \
+  X(safetyZeroIMs,      uint32_t, PT_U32, "safety.zero_i_ms",      100,   10000,  SAFETY_ZERO_CURRENT_TIMEOUT_MS,  "ms")  \
+  X(safetyNoEncMs,      uint32_t, PT_U32, "safety.no_enc_ms",      100,   10000,  SAFETY_NO_ENCODER_TIMEOUT_MS,    "ms")  \
+  X(safetyMinPulses,    int32_t,  PT_I32, "safety.min_pulses",     1,     1000,   SAFETY_MIN_PULSES_TOTAL,         "c")   \
+  X(safetyCheckMs,      uint32_t, PT_U32, "safety.check_ms",       5,     1000,   SAFETY_CHECK_PERIOD_MS,          "ms")  \
+  X(lightAutoOffMs,     uint32_t, PT_U32, "light.auto_off_ms",     0,     3600000, LIGHT_AUTO_OFF_MS,              "ms")
+
+struct Params {
+#define PARAM_FIELD(f, ct, pt, n, mn, mx, d, u) ct f;
+  PARAM_TABLE(PARAM_FIELD)
+#undef PARAM_FIELD
+};
+
+// Valores en uso (lectura directa desde cualquier tarea)
+extern Params params;
+
+// Carga el blob de NVS (una lectura) sobre los valores por defecto
+void params_begin();
+
+// MQTT (tarea de red):
+//  - get: payload vacío o "all" -> todos; "meta" -> rango/defecto/unidad;
+//         o una lista de nombres o prefijos ("traj.", "safety.min_pulses").
+//  - set: "nombre=valor ..." o {"nombre":valor,...}; "defaults" restaura todo.
+void params_handle_get(MsgView msg);
+void params_handle_set(MsgView msg);
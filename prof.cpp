@@ -0,0 +1,123 @@
+#include "prof.h"
+
+// Histograma log-lineal: 0..3 µs exactos y, desde ahí, 4 tramos por octava
+// hasta ~131 ms (lo que pase va al último tramo)
+static const uint8_t PROF_BUCKETS = 64;
+
+struct ProfSlotData {
+  uint32_t n;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint16_t hist[PROF_BUCKETS];   // satura en 65535
+  uint32_t lastStart;            // prof_period(): ciclos de la llamada anterior
+  volatile bool resetReq;
+};
+
+static ProfSlotData s_slots[PROF_SLOT_COUNT];
+static uint32_t     s_cyclesPerUs = 240;
+
+static const char* const SLOT_NAMES[PROF_SLOT_COUNT] = {
+  "ctl_per", "ctl", "btn", "cur", "mot", "grd", "saf", "hall",
+  "net_per", "net_all", "ui", "disp", "light", "net", "ota", "cfg",
+};
+
+static inline uint8_t bucket_of(uint32_t us) {
+  if (us < 4) return (uint8_t)us;
+  uint8_t msb = 31 - __builtin_clz(us);
+  uint32_t idx = (uint32_t)(msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+  return (idx < PROF_BUCKETS) ? (uint8_t)idx : (PROF_BUCKETS - 1);
+}
+
+static uint32_t bucket_upper(uint8_t idx) {
+  if (idx < 4) return idx;
+  uint8_t  msb  = idx / 4 + 1;
+  uint32_t step = 1UL << (msb - 2);
+  return ((4UL + idx % 4) << (msb - 2)) + step - 1;
+}
+
+static void slot_clear(ProfSlotData& d) {
+  d.n = 0;
+  d.minUs = UINT32_MAX;
+  d.maxUs = 0;
+  d.sumUs = 0;
+  memset(d.hist, 0, sizeof(d.hist));
+  d.resetReq = false;
+}
+
+#if PROF_ENABLED
+
+void prof_begin() {
+  s_cyclesPerUs = getCpuFrequencyMhz();
+  if (s_cyclesPerUs == 0) s_cyclesPerUs = 1;
+  for (uint8_t i = 0; i < PROF_SLOT_COUNT; ++i) slot_clear(s_slots[i]);
+}
+
+void prof_record(ProfSlot s, uint32_t cycles) {
+  ProfSlotData& d = s_slots[s];
+  if (d.resetReq) slot_clear(d);
+  uint32_t us = cycles / s_cyclesPerUs;
+  d.n++;
+  d.sumUs += us;
+  if (us < d.minUs) d.minUs = us;
+  if (us > d.maxUs) d.maxUs = us;
+  uint16_t& h = d.hist[bucket_of(us)];
+  if (h != 0xFFFF) h++;
+}
+
+void prof_period(ProfSlot s) {
+  uint32_t now = prof_now();
+  ProfSlotData& d = s_slots[s];
+  if (d.lastStart != 0) prof_record(s, now - d.lastStart);
+  d.lastStart = now;
+}
+
+#endif
+
+// La lectura no bloquea al escritor: una muestra puede quedar a medias entre
+// contadores, irrelevante para la telemetría
+void prof_get(ProfSlot s, ProfStats& out) {
+  const ProfSlotData& d = s_slots[s];
+  out = {};
+  if (d.resetReq || d.n == 0) return;
+  out.n     = d.n;
+  out.minUs = d.minUs;
+  out.maxUs = d.maxUs;
+  out.avgUs = (uint32_t)(d.sumUs / d.n);
+
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < PROF_BUCKETS; ++i) total += d.hist[i];
+  uint32_t target = total - total / 100;   // primer tramo que deja ≥99% por debajo
+  uint32_t acc = 0;
+  for (uint8_t i = 0; i < PROF_BUCKETS; ++i) {
+    acc += d.hist[i];
+    if (acc >= target && acc > 0) { out.p99Us = bucket_upper(i); break; }
+  }
+  if (out.p99Us > out.maxUs) out.p99Us = out.maxUs;
+  if (out.p99Us < out.minUs) out.p99Us = out.minUs;
+}
+
+const char* prof_slot_name(ProfSlot s) {
+  return (s < PROF_SLOT_COUNT) ? SLOT_NAMES[s] : "?";
+}
+
+void prof_reset() {
+  for (uint8_t i = 0; i < PROF_SLOT_COUNT; ++i) s_slots[i].resetReq = true;
+}
+
+void prof_format(TextBuf& out, bool reset) {
+  out.ch('{');
+  bool first = true;
+  for (uint8_t i = 0; i < PROF_SLOT_COUNT; ++i) {
+    ProfStats st;
+    prof_get((ProfSlot)i, st);
+    if (st.n == 0) continue;
+    if (!first) out.ch(',');
+    first = false;
+    out.ch('"').str(SLOT_NAMES[i]).str("\":[")
+       .unum(st.n).ch(',').unum(st.minUs).ch(',').unum(st.avgUs).ch(',')
+       .unum(st.p99Us).ch(',').unum(st.maxUs).ch(']');
+  }
+  out.ch('}');
+  if (reset) prof_reset();
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_cpu.h>
+#include "config.h"
+#include "msgbuf.h"
+
+// =====================================================
+//     Perfilado por subsistema (histogramas de tiempos)
+// =====================================================
+// Cada slot acumula n/min/max/suma y un histograma log-lineal en µs (4
+// tramos por octava, ~±10%) medido con el contador de ciclos de la CPU.
+// Registrar cuesta dos lecturas del contador y unas sumas: se deja activo.
+// Cada slot lo escribe una sola tarea (sin bloqueos); la de red lo lee para
+// publicarlo y pide el reinicio, que aplica la tarea dueña en su siguiente
+// muestra.
+
+enum ProfSlot : uint8_t {
+  // Tarea de control
+  PROF_CTL_PERIOD = 0,   // periodo real entre pasos
+  PROF_CTL_STEP,         // paso completo
+  PROF_BUTTON,
+  PROF_CURRENT,
+  PROF_MOTOR,            // traj_tick + motor_tick
+  PROF_GUARD,            // guardia de sobrecorriente
+  PROF_SAFETY,
+  PROF_HALL,
+  // Tarea de red/UI
+  PROF_NET_PERIOD,
+  PROF_NET_STEP,
+  PROF_STATE_UI,
+  PROF_DISPLAY,
+  PROF_LIGHT,
+  PROF_NET,
+  PROF_OTA,
+  PROF_CFG,
+  PROF_SLOT_COUNT
+};
+
+struct ProfStats {
+  uint32_t n;
+  uint32_t minUs;
+  uint32_t avgUs;
+  uint32_t p99Us;        // límite superior del tramo del percentil 99
+  uint32_t maxUs;
+};
+
+#if PROF_ENABLED
+
+static inline uint32_t prof_now() { return (uint32_t)esp_cpu_get_cycle_count(); }
+
+void prof_begin();
+void prof_record(ProfSlot s, uint32_t cycles);
+void prof_period(ProfSlot s);    // tiempo desde la llamada anterior en este slot
+
+struct ProfScope {
+  ProfSlot slot;
+  uint32_t t0;
+  explicit ProfScope(ProfSlot s) : slot(s), t0(prof_now()) {}
+  ~ProfScope() { prof_record(slot, prof_now() - t0); }
+};
+
+#define PROF_CAT2(a, b) a##b
+#define PROF_CAT(a, b)  PROF_CAT2(a, b)
+#define PROF_SCOPE(slot) ProfScope PROF_CAT(_prof_, __LINE__)(slot)
+
+#else
+
+static inline void prof_begin() {}
+static inline void prof_period(ProfSlot) {}
+#define PROF_SCOPE(slot) do {} while (0)
+
+#endif
+
+// Lectura (tarea de red)
+void        prof_get(ProfSlot s, ProfStats& out);
+const char* prof_slot_name(ProfSlot s);
+void        prof_reset();                    // todos los slots
+
+// {"ctl_per":[n,min,avg,p99,max],...} en µs; reset=true abre ventana nueva
+void prof_format(TextBuf& out, bool reset);
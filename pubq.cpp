@@ -0,0 +1,177 @@
+#include "pubq.h"
+#include <string.h>
+#include "config.h"
+
+// ---------------- Retenidos: último valor por topic ----------------
+static const char* const RETAINED_TOPICS[] = {
+  TOPIC_STATE, TOPIC_OTA, TOPIC_LIGHT_STATE, TOPIC_LIGHT_DIM, TOPIC_LIGHT_BREATH_STATE,
+  TOPIC_HALL_EN_STATE, TOPIC_SPEED, TOPIC_ILIMIT,
+};
+static const uint8_t RETAINED_COUNT = sizeof(RETAINED_TOPICS) / sizeof(RETAINED_TOPICS[0]);
+
+struct RetainedSlot {
+  char    value[PUBQ_RETAINED_MAX];
+  uint8_t len;
+  bool    has;          // hay valor
+  bool    dirty;        // pendiente de enviar
+  char    sent[PUBQ_RETAINED_MAX];   // lo que tiene el broker
+  uint8_t sentLen;
+  bool    sentValid;
+};
+
+static RetainedSlot s_ret[RETAINED_COUNT];
+
+// ---------------- Eventos: anillo de bytes ----------------
+// Registro = [topic (puntero)][len u16][retain u8][payload]
+struct EventHdr {
+  const char* topic;
+  uint16_t    len;
+  uint8_t     retain;
+};
+
+static_assert((PUBQ_EVENT_BYTES & (PUBQ_EVENT_BYTES - 1)) == 0, "PUBQ_EVENT_BYTES debe ser potencia de 2");
+
+static uint8_t  s_ring[PUBQ_EVENT_BYTES];
+static uint32_t s_head = 0, s_tail = 0;   // contadores libres (mod tamaño al indexar)
+static uint16_t s_events = 0;
+
+static PubqStats   s_stats = {};
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void ringWrite(uint32_t pos, const void* src, size_t n) {
+  size_t at = pos % PUBQ_EVENT_BYTES;
+  size_t first = (n < PUBQ_EVENT_BYTES - at) ? n : PUBQ_EVENT_BYTES - at;
+  memcpy(s_ring + at, src, first);
+  memcpy(s_ring, (const uint8_t*)src + first, n - first);
+}
+
+static void ringRead(uint32_t pos, void* dst, size_t n) {
+  size_t at = pos % PUBQ_EVENT_BYTES;
+  size_t first = (n < PUBQ_EVENT_BYTES - at) ? n : PUBQ_EVENT_BYTES - at;
+  memcpy(dst, s_ring + at, first);
+  memcpy((uint8_t*)dst + first, s_ring, n - first);
+}
+
+static int retainedIndex(const char* topic) {
+  for (uint8_t i = 0; i < RETAINED_COUNT; ++i)
+    if (RETAINED_TOPICS[i] == topic || strcmp(RETAINED_TOPICS[i], topic) == 0) return i;
+  return -1;
+}
+
+bool pubq_push(const char* topic, const uint8_t* payload, size_t len, bool retain, bool keep) {
+  int ri = retain ? retainedIndex(topic) : -1;
+  if (ri >= 0 && len <= PUBQ_RETAINED_MAX) {
+    RetainedSlot& r = s_ret[ri];
+    portENTER_CRITICAL(&s_mux);
+    if (r.sentValid && r.sentLen == len && memcmp(r.sent, payload, len) == 0) {
+      r.dirty = false;          // vuelve a lo que ya tiene el broker
+      s_stats.dedup++;
+    } else {
+      if (r.dirty) s_stats.coalesced++;
+      r.dirty = true;
+    }
+    memcpy(r.value, payload, len);
+    r.len = (uint8_t)len;
+    r.has = true;
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+  }
+
+  // Evento (o retenido no registrado): a la cola
+  const size_t need = sizeof(EventHdr) + len;
+  if (len > MQTT_BUFFER_BYTES) {
+    portENTER_CRITICAL(&s_mux);
+    s_stats.dropped++;
+    portEXIT_CRITICAL(&s_mux);
+    return false;
+  }
+  EventHdr h = { topic, (uint16_t)len, (uint8_t)retain };
+  portENTER_CRITICAL(&s_mux);
+  uint32_t used = s_head - s_tail;
+  if (s_events >= PUBQ_EVENT_DEPTH || used + need > PUBQ_EVENT_BYTES) {
+    if (!keep) s_stats.dropped++;
+    portEXIT_CRITICAL(&s_mux);
+    return false;
+  }
+  ringWrite(s_head, &h, sizeof(h));
+  ringWrite(s_head + sizeof(h), payload, len);
+  s_head += need;
+  s_events++;
+  if (used + need > s_stats.highWater) s_stats.highWater = used + need;
+  portEXIT_CRITICAL(&s_mux);
+  return true;
+}
+
+void pubq_on_connected() {
+  // Broker nuevo o sesión limpia: reenviar el último valor de cada retenido
+  portENTER_CRITICAL(&s_mux);
+  for (uint8_t i = 0; i < RETAINED_COUNT; ++i) {
+    s_ret[i].sentValid = false;
+    if (s_ret[i].has) s_ret[i].dirty = true;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void pubq_flush(PubqSendFn send) {
+  // 1) Retenidos pendientes
+  for (uint8_t i = 0; i < RETAINED_COUNT; ++i) {
+    RetainedSlot& r = s_ret[i];
+    char v[PUBQ_RETAINED_MAX];
+    uint8_t n;
+    portENTER_CRITICAL(&s_mux);
+    bool dirty = r.dirty;
+    n = r.len;
+    memcpy(v, r.value, n);
+    portEXIT_CRITICAL(&s_mux);
+    if (!dirty) continue;
+
+    PubqSendResult res = send(RETAINED_TOPICS[i], (const uint8_t*)v, n, true);
+    if (res == PUBQ_RETRY) return;
+    portENTER_CRITICAL(&s_mux);
+    if (res == PUBQ_SENT) {
+      memcpy(r.sent, v, n);
+      r.sentLen = n;
+      r.sentValid = true;
+      s_stats.sent++;
+    } else {
+      r.sentValid = false;   // el broker no tiene este valor
+      s_stats.dropped++;
+    }
+    // Si cambió mientras se enviaba, sigue sucio
+    r.dirty = !(r.len == n && memcmp(r.value, v, n) == 0);
+    portEXIT_CRITICAL(&s_mux);
+  }
+
+  // 2) Eventos en orden (un solo consumidor: se lee fuera del cerrojo)
+  static uint8_t payload[MQTT_BUFFER_BYTES];
+  for (;;) {
+    EventHdr h;
+    portENTER_CRITICAL(&s_mux);
+    bool any = (s_events > 0);
+    uint32_t tail = s_tail;
+    portEXIT_CRITICAL(&s_mux);
+    if (!any) break;
+
+    ringRead(tail, &h, sizeof(h));
+    ringRead(tail + sizeof(h), payload, h.len);
+    PubqSendResult res = send(h.topic, payload, h.len, h.retain != 0);
+    if (res == PUBQ_RETRY) return;   // se queda para la próxima
+
+    portENTER_CRITICAL(&s_mux);
+    s_tail = tail + sizeof(h) + h.len;
+    s_events--;
+    if (res == PUBQ_SENT) s_stats.sent++;
+    else                  s_stats.dropped++;
+    portEXIT_CRITICAL(&s_mux);
+  }
+}
+
+void pubq_get_stats(PubqStats& out, bool reset) {
+  portENTER_CRITICAL(&s_mux);
+  out = s_stats;
+  if (reset) {
+    s_stats = {};
+    s_stats.highWater = s_head - s_tail;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
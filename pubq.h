@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+// =====================================================
+//   Cola de salida MQTT (productores → tarea de red)
+// =====================================================
+// net_mqtt_publish() deja aquí cada mensaje, desde cualquier tarea; la de
+// red lo envía todo junto en pubq_flush().
+// - Topics retenidos conocidos: solo el último valor por topic, y no se
+//   envía si coincide con lo que ya tiene el broker. Al reconectar se
+//   reenvían todos (pubq_on_connected).
+// - Resto (eventos): cola FIFO acotada (PUBQ_EVENT_BYTES / PUBQ_EVENT_DEPTH);
+//   llena, el mensaje nuevo se descarta y se cuenta, salvo que el productor
+//   lo conserve para reintentarlo (keep): entonces solo se rechaza.
+// Los topics deben ser literales (se guarda el puntero).
+
+// Resultado del envío real
+enum PubqSendResult : uint8_t {
+  PUBQ_SENT,      // entregado al cliente MQTT
+  PUBQ_RETRY,     // sin conexión o cliente ocupado: se queda para otra pasada
+  PUBQ_DROPPED,   // rechazado: se descarta y se cuenta en dropped
+};
+typedef PubqSendResult (*PubqSendFn)(const char* topic, const uint8_t* payload, size_t len, bool retain);
+
+struct PubqStats {
+  uint32_t sent;        // publicaciones enviadas
+  uint32_t dedup;       // retenidos iguales a lo que ya tiene el broker
+  uint32_t coalesced;   // retenidos sustituidos antes de enviarse
+  uint32_t dropped;     // descartados (cola llena sin keep, demasiado grandes o PUBQ_DROPPED)
+  uint32_t highWater;   // máximo de bytes en la cola de eventos
+};
+
+// false = no admitido (con keep y la cola llena no cuenta como descarte)
+bool pubq_push(const char* topic, const uint8_t* payload, size_t len, bool retain, bool keep = false);
+
+// Solo tarea de red
+void pubq_on_connected();
+void pubq_flush(PubqSendFn send);
+
+void pubq_get_stats(PubqStats& out, bool reset);
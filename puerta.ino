@@ -1,4 +1,5 @@
 #include "config.h"
+#include "params.h"
 #include "display.h"
 #include "state.h"
 #include "net.h"
@@ -9,11 +10,18 @@
 #include "hall.h"
 #include "light.h"
 #include "safety.h"
+#include "tasks.h"
+#include "traj.h"
+#include "ienv.h"
+#include "cfgstore.h"
+#include "prof.h"
+#include "sched.h"
+#include "telem.h"
 
 static unsigned long tUltimoCambio = 0;
 
 
-void handleButton(unsigned long ahora) {
+void handleButton(uint32_t ahora) {
   static uint32_t tLastRead = 0;
   static int lastStable = (BUTTON_ACTIVE_LVL == LOW) ? HIGH : LOW;
   static int lastRead   = lastStable;
@@ -59,28 +67,40 @@ void handleButton(unsigned long ahora) {
 }
 
 
-void setup() {
-  net_begin();
-  motor_begin();     // <- importante
-  display_begin();
-  current_begin(); 
-  light_begin(); 
-  safety_begin();
-  setEstado(DETENIDO);
-  renderEstado(getEstado());
-  pinMode(BUTTON_PIN, (BUTTON_ACTIVE_LVL == LOW) ? INPUT_PULLUP : INPUT);
-  // Encoder Hall
-  hall_begin();
-  if (BOOT_OTA_MINUTES > 0) ota_enable_for(BOOT_OTA_MINUTES);
+// =====================================================
+//   Tarea de control (periodo fijo CONTROL_PERIOD_MS)
+// =====================================================
+// Cada subsistema es un trabajo del planificador; a igual plazo corren por
+// prioridad (botón, corriente, motor, guardia, safety, hall).
+static SchedJob jobButton, jobCurrent, jobMotor, jobGuard, jobHall;
+static SchedJob jobStateUi, jobDisplay, jobLight, jobNet, jobOta, jobCfg;
+
+static uint32_t tMoveSince = 0;
+static bool     moving = false;
+
+// Planificador de trayectorias + rampa del motor
+static void motorJob(uint32_t ahora) {
+  traj_tick(ahora);
+  motor_tick();
 }
 
-void loop() {
-  unsigned long ahora = millis();
+// Guardia de sobrecorriente (periodo vivo: params.currentCheckMs)
+static void guardJob(uint32_t ahora) {
+  if (!moving || (ahora - tMoveSince) < params.currentBlankingMs) return;
+  if (current_guard_stop_if_over()) {
+    LOGW("[I] Corte por sobrecorriente\n");
+  }
+}
+
+// Hall (aplica o no según flag)
+static void hallJob(uint32_t ahora) {
+  if (hall_is_enabled()) hall_tick(ahora);
+}
 
-  // 1) Animación del display
-  display_tick();
+static void currentJob(uint32_t ahora) { current_tick(ahora); }
 
-  // 2) Demo de rotación de estados (si INTERVALO_ESTADO_MS > 0)
+static void controlStep(uint32_t ahora) {
+  // Demo de rotación de estados (si INTERVALO_ESTADO_MS > 0)
   #if (INTERVALO_ESTADO_MS > 0)
   if (ahora - tUltimoCambio >= INTERVALO_ESTADO_MS) {
     tUltimoCambio = ahora;
@@ -89,21 +109,76 @@ void loop() {
   }
   #endif
 
-    // Botón local siempre
-  handleButton(ahora);
-  current_tick(ahora);
-  light_tick(ahora);
-  safety_tick(ahora); 
+  // Detectar inicio de movimiento -> blanking sobrecorriente
+  static int prevEstadoInt = -1;
+  int eNow = (int)getEstado();
+  if (eNow != prevEstadoInt) {
+    if (eNow == ABRIENDO || eNow == CERRANDO)
+      tMoveSince = ahora;
+    prevEstadoInt = eNow;
+  }
+  moving = (eNow == ABRIENDO || eNow == CERRANDO);
 
+  sched_run(SCHED_CONTROL, ahora);
+}
 
-  // Hall (aplica o no según flag)
-  if (hall_is_enabled()) {
-    hall_tick(ahora);
-  }
+// =====================================================
+//   Tarea de red / UI
+// =====================================================
+static void stateUiJob(uint32_t) { state_ui_tick(); }   // cambios de estado → display + MQTT
+static void displayJob(uint32_t) { display_tick(); }
+static void netJob(uint32_t)     { net_tick(); }        // Wi-Fi/MQTT
+static void otaJob(uint32_t)     { ota_tick(); }        // OTA on-demand
+
+// Devuelve ms hasta el próximo plazo: la tarea de red duerme hasta entonces
+static uint32_t netStep(uint32_t ahora) {
+  return sched_run(SCHED_NET, ahora);
+}
+
+static void sched_setup() {
+  // Control (botón local siempre: no depende de la red)
+  sched_every(jobButton,  SCHED_CONTROL, "button",  CONTROL_PERIOD_MS, 0, handleButton, PROF_BUTTON);
+  sched_every(jobCurrent, SCHED_CONTROL, "current", CONTROL_PERIOD_MS, 1, currentJob,   PROF_CURRENT);
+  sched_every(jobMotor,   SCHED_CONTROL, "motor",   MOTOR_TICK_MS,     2, motorJob,     PROF_MOTOR);
+  sched_every_ref(jobGuard, SCHED_CONTROL, "guard", params.currentCheckMs, 3, guardJob, PROF_GUARD);
+  sched_every(jobHall,    SCHED_CONTROL, "hall",    CONTROL_PERIOD_MS, 5, hallJob,      PROF_HALL);
+
+  // Red / UI
+  sched_every(jobStateUi, SCHED_NET, "state_ui", NET_TASK_DELAY_MS, 0, stateUiJob, PROF_STATE_UI);
+  sched_every(jobDisplay, SCHED_NET, "display",  NET_TASK_DELAY_MS, 1, displayJob, PROF_DISPLAY);
+  sched_every(jobLight,   SCHED_NET, "light",    NET_TASK_DELAY_MS, 2, light_tick, PROF_LIGHT);
+  sched_every(jobNet,     SCHED_NET, "net",      NET_TASK_DELAY_MS, 3, netJob,     PROF_NET);
+  sched_every(jobOta,     SCHED_NET, "ota",      NET_TASK_DELAY_MS, 4, otaJob,     PROF_OTA);
+  sched_every(jobCfg,     SCHED_NET, "cfg",      NET_TASK_DELAY_MS, 5, cfg_tick,   PROF_CFG);   // configuración pendiente a flash
+}
 
-  // 4) Red (Wi-Fi/MQTT)
-  net_tick();
 
-  // 5) OTA on-demand
-  ota_tick();
+void setup() {
+  cfg_begin();       // configuración persistente antes que los módulos
+  params_begin();    // parámetros ajustables (blob en NVS)
+  prof_begin();
+  net_begin();
+  telem_begin();     // telemetría binaria (TOPIC_TELEM)
+  motor_begin();     // <- importante
+  display_begin();
+  current_begin(); 
+  light_begin(); 
+  safety_begin();
+  setEstado(DETENIDO);
+  renderEstado(getEstado());
+  pinMode(BUTTON_PIN, (BUTTON_ACTIVE_LVL == LOW) ? INPUT_PULLUP : INPUT);
+  // Encoder Hall
+  hall_begin();
+  ienv_begin();
+  if (BOOT_OTA_MINUTES > 0) ota_enable_for(BOOT_OTA_MINUTES);
+  net_publish_state();   // retenidos iniciales a la cola de salida
+  sched_setup();
+
+  // A partir de aquí todo corre en las tareas de control y red/UI
+  tasks_begin(controlStep, netStep);
+}
+
+void loop() {
+  // El loop de Arduino ya no hace nada: liberamos su tarea
+  vTaskDelete(NULL);
 }
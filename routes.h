@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <string.h>
+#include "msgbuf.h"
+
+// =====================================================
+//   Tabla de topics → manejador, ordenada en compilación
+// =====================================================
+// Cada entrada lleva el hash FNV-1a de su topic. sortRoutes() ordena la
+// tabla por hash en compilación y routesUnique() permite rechazar
+// colisiones con un static_assert. findRoute() hace una búsqueda binaria
+// por hash y confirma con strncmp: un topic desconocido cuesta un hash y
+// unas pocas comparaciones de enteros.
+
+typedef void (*TopicHandler)(MsgView msg);
+
+struct TopicRoute {
+  uint32_t     hash;
+  const char  *topic;
+  TopicHandler fn;
+};
+
+#define ROUTE(t, fn) TopicRoute{ fnv1a32(t), t, fn }
+
+template <size_t N>
+constexpr std::array<TopicRoute, N> sortRoutes(std::array<TopicRoute, N> r) {
+  for (size_t i = 1; i < N; ++i)
+    for (size_t j = i; j > 0 && r[j - 1].hash > r[j].hash; --j) {
+      TopicRoute tmp = r[j - 1];
+      r[j - 1] = r[j];
+      r[j] = tmp;
+    }
+  return r;
+}
+
+template <size_t N>
+constexpr bool routesUnique(const std::array<TopicRoute, N> &r) {
+  for (size_t i = 1; i < N; ++i)
+    if (r[i - 1].hash == r[i].hash) return false;
+  return true;
+}
+
+// topic sin terminador (n bytes); nullptr si no está en la tabla
+template <size_t N>
+const TopicRoute *findRoute(const std::array<TopicRoute, N> &routes, const char *topic, size_t n) {
+  const uint32_t h = fnv1a32(topic, n);
+  size_t lo = 0, hi = N;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (routes[mid].hash < h) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo < N && routes[lo].hash == h &&
+      strncmp(routes[lo].topic, topic, n) == 0 && routes[lo].topic[n] == '\0')
+    return &routes[lo];
+  return nullptr;
+}
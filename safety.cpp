@@ -1,34 +1,19 @@
 #include "safety.h"
 #include "config.h"
+#include "params.h"
 #include "state.h"
 #include "motor.h"
 #include "current.h"
 #include "hall.h"
 #include "logx.h"
-#include "net.h"
 #include "light.h"
+#include "sched.h"
 #include <stdlib.h>   // labs()
 
-// --- Salvaguardas de plausibilidad (valores por defecto) ---
-// Puedes sobreescribir en config.h si quieres
-#ifndef SAFETY_MIN_CURRENT_A
-#define SAFETY_MIN_CURRENT_A              0.15f
-#endif
-#ifndef SAFETY_ZERO_CURRENT_TIMEOUT_MS
-#define SAFETY_ZERO_CURRENT_TIMEOUT_MS    800
-#endif
-#ifndef SAFETY_NO_ENCODER_TIMEOUT_MS
-#define SAFETY_NO_ENCODER_TIMEOUT_MS      700
-#endif
-#ifndef SAFETY_MIN_PULSES_TOTAL
-#define SAFETY_MIN_PULSES_TOTAL           2    // pulsos acumulados mínimos dentro de la ventana
-#endif
-#ifndef SAFETY_CHECK_PERIOD_MS
-#define SAFETY_CHECK_PERIOD_MS            50
-#endif
+// Umbrales de las salvaguardas: params.safety* (params.h)
 
 // Estado interno
-static uint32_t tLastCheck   = 0;
+static SchedJob s_job;                   // periodo vivo: params.safetyCheckMs
 static long     lastEnc      = 0;
 static uint32_t tZeroISince  = 0;
 static uint32_t tNoEncSince  = 0;
@@ -39,27 +24,23 @@ static void safety_emergency_stop(const char* reason) {
   motor_emergency_stop();      // si no existe, usa motor_stop()
   setEstado(DETENIDO);
 
+  // Corre en la tarea de control: el log llega a MQTT a través de logx
   logPrintf("[SAFETY] Parada de emergencia: %s\n", reason);
-  net_mqtt_publish(TOPIC_LOG, String("[SAFETY] ") + reason, false);
 
 #if LIGHT_PWM_ENABLED
-  light_set_level((1U << LIGHT_PWM_RES_BITS) - 1);
-  light_on();
+  light_request_full();   // la luz la gestiona la tarea de red/UI
 #endif
 }
 
 void safety_begin() {
-  tLastCheck    = 0;
   lastEnc       = hall_get_count();
   tZeroISince   = 0;
   tNoEncSince   = 0;
   accumEncDelta = 0;
+  sched_every_ref(s_job, SCHED_CONTROL, "safety", params.safetyCheckMs, 4, safety_tick, PROF_SAFETY);
 }
 
 void safety_tick(uint32_t now) {
-  if (now - tLastCheck < SAFETY_CHECK_PERIOD_MS) return;
-  tLastCheck = now;
-
   EstadoPuerta e = getEstado();
   bool moving = (e == ABRIENDO || e == CERRANDO);
 
@@ -72,14 +53,23 @@ void safety_tick(uint32_t now) {
     return;
   }
 
-  // Lecturas actuales
-  float I  = current_readA();
+  // Lecturas actuales: estadística de la ventana del ADC (~160 ms), no solo
+  // el último valor filtrado. Una ventana sin tramas recientes (ADC parado)
+  // cuenta como corriente ~0.
+  CurrentStats st;
+  current_window_stats(st);
+  bool  fresh = st.samples > 0 && st.ageMs < params.safetyZeroIMs;
+  float iMax  = fresh ? st.maxA  : 0.0f;
+  float iMean = fresh ? st.meanA : 0.0f;
   long enc = hall_get_count();
 
-  // (1) Movimiento declarado pero corriente ~0 durante demasiado tiempo
-  if (I <= SAFETY_MIN_CURRENT_A) {
+  // (1) Movimiento declarado pero corriente ~0 durante demasiado tiempo: ni
+  // el máximo de la ventana llega al umbral. No cuenta mientras el lazo de
+  // velocidad frena a propósito (zona lenta, fin de trayectoria): ahí la
+  // corriente baja a ~0 sin que falte el motor.
+  if (iMax <= params.safetyMinCurrentA && !motor_is_decelerating()) {
     if (tZeroISince == 0) tZeroISince = now;
-    if (now - tZeroISince >= SAFETY_ZERO_CURRENT_TIMEOUT_MS) {
+    if (now - tZeroISince >= params.safetyZeroIMs) {
       safety_emergency_stop("Motor moviendo pero corriente ~0 (posible cable suelto/driver abierto).");
       tZeroISince   = 0;
       tNoEncSince   = 0;
@@ -91,8 +81,9 @@ void safety_tick(uint32_t now) {
     tZeroISince = 0;
   }
 
-  // (2) Corriente presente pero no hay suficientes pulsos Hall en la ventana
-  if (hall_is_enabled() && I > SAFETY_MIN_CURRENT_A) {
+  // (2) Corriente presente (media de la ventana) pero no hay suficientes
+  // pulsos Hall en la ventana
+  if (hall_is_enabled() && iMean > params.safetyMinCurrentA) {
     long dp = enc - lastEnc;
     if (tNoEncSince == 0) {
       tNoEncSince   = now;
@@ -103,11 +94,11 @@ void safety_tick(uint32_t now) {
       accumEncDelta += labs(dp);
     }
 
-    if (accumEncDelta >= SAFETY_MIN_PULSES_TOTAL) {
+    if (accumEncDelta >= params.safetyMinPulses) {
       // Hemos visto suficientes pasos dentro de la ventana -> todo OK, reseteamos
       tNoEncSince   = 0;
       accumEncDelta = 0;
-    } else if (now - tNoEncSince >= SAFETY_NO_ENCODER_TIMEOUT_MS) {
+    } else if (now - tNoEncSince >= params.safetyNoEncMs) {
       safety_emergency_stop("Corriente presente pero sin pulsos Hall suficientes en ventana (atasco/sensor/cable).");
       tNoEncSince   = 0;
       tZeroISince   = 0;
@@ -1,8 +1,9 @@
 #pragma once
 #include <Arduino.h>
 
-// Inicialización (resetea estados internos de seguridad)
+// Inicialización (resetea estados internos de seguridad y registra el
+// trabajo periódico de la tarea de control, cada params.safetyCheckMs)
 void safety_begin();
 
-// Tick periódico (llamar en loop principal con millis())
+// Comprobación (la ejecuta el planificador)
 void safety_tick(uint32_t now);
@@ -0,0 +1,185 @@
+#include "sched.h"
+#include "config.h"
+
+struct SchedWheel {
+  SchedJob* slot[SCHED_WHEEL_SLOTS];
+  SchedJob* all;          // todos los registrados
+  uint32_t  lastRun;      // último millis procesado
+  bool      started;
+};
+
+static SchedWheel s_wheels[SCHED_TASK_COUNT];
+
+static_assert((SCHED_WHEEL_SLOTS & (SCHED_WHEEL_SLOTS - 1)) == 0, "SCHED_WHEEL_SLOTS debe ser potencia de 2");
+
+static inline bool due_by(uint32_t due, uint32_t now) { return (int32_t)(now - due) >= 0; }
+
+static void wheel_insert(SchedJob& j) {
+  SchedJob*& head = s_wheels[j.task].slot[j.due & (SCHED_WHEEL_SLOTS - 1)];
+  j.next = head;
+  head = &j;
+}
+
+static void wheel_remove(SchedJob& j) {
+  SchedJob** pp = &s_wheels[j.task].slot[j.due & (SCHED_WHEEL_SLOTS - 1)];
+  while (*pp && *pp != &j) pp = &(*pp)->next;
+  if (*pp) *pp = j.next;
+  j.next = nullptr;
+}
+
+static void arm_at(SchedJob& j, uint32_t due) {
+  if (j.armed) wheel_remove(j);
+  j.due = due;
+  j.armed = true;
+  wheel_insert(j);
+}
+
+static void job_register(SchedJob& j, SchedTask t, const char* name, uint8_t prio,
+                         SchedFn fn, ProfSlot prof) {
+  j.name = name;
+  j.fn = fn;
+  j.prio = prio;
+  j.task = t;
+  j.prof = prof;
+  j.armed = false;
+  j.next = nullptr;
+  j.runs = j.overruns = j.lateMaxMs = 0;
+  j.link = s_wheels[t].all;
+  s_wheels[t].all = &j;
+}
+
+void sched_every(SchedJob& j, SchedTask t, const char* name, uint32_t periodMs,
+                 uint8_t prio, SchedFn fn, ProfSlot prof) {
+  j.ownPeriod = periodMs ? periodMs : 1;
+  sched_every_ref(j, t, name, j.ownPeriod, prio, fn, prof);
+}
+
+void sched_every_ref(SchedJob& j, SchedTask t, const char* name, const uint32_t& periodMs,
+                     uint8_t prio, SchedFn fn, ProfSlot prof) {
+  job_register(j, t, name, prio, fn, prof);
+  j.period = &periodMs;
+  arm_at(j, millis() + (periodMs ? periodMs : 1));
+}
+
+void sched_once(SchedJob& j, SchedTask t, const char* name, uint8_t prio, SchedFn fn) {
+  job_register(j, t, name, prio, fn, PROF_SLOT_COUNT);
+  j.period = nullptr;
+}
+
+void sched_after(SchedJob& j, uint32_t delayMs) {
+  arm_at(j, millis() + (delayMs ? delayMs : 1));   // nunca en el pasado: lo vería la siguiente pasada
+}
+
+void sched_cancel(SchedJob& j) {
+  if (!j.armed) return;
+  wheel_remove(j);
+  j.armed = false;
+}
+
+bool sched_pending(const SchedJob& j) { return j.armed; }
+
+// Lista de listos ordenada por (plazo, prioridad)
+static void ready_insert(SchedJob*& ready, SchedJob& j) {
+  SchedJob** pp = &ready;
+  while (*pp) {
+    SchedJob* o = *pp;
+    int32_t d = (int32_t)(j.due - o->due);
+    if (d < 0 || (d == 0 && j.prio < o->prio)) break;
+    pp = &o->next;
+  }
+  j.next = *pp;
+  *pp = &j;
+}
+
+static void collect_slot(SchedJob*& head, SchedJob*& ready, uint32_t now) {
+  SchedJob** pp = &head;
+  while (*pp) {
+    SchedJob* j = *pp;
+    if (due_by(j->due, now)) {
+      *pp = j->next;
+      ready_insert(ready, *j);
+    } else {
+      pp = &j->next;
+    }
+  }
+}
+
+uint32_t sched_run(SchedTask t, uint32_t now) {
+  SchedWheel& w = s_wheels[t];
+  SchedJob* ready = nullptr;
+
+  // Tramos desde la última pasada (si hace más de una vuelta, todos)
+  uint32_t span = w.started ? (now - w.lastRun) : SCHED_WHEEL_SLOTS;
+  if (span > SCHED_WHEEL_SLOTS) span = SCHED_WHEEL_SLOTS;
+  for (uint32_t k = 0; k < span; ++k) {
+    uint32_t ms = now - k;
+    collect_slot(w.slot[ms & (SCHED_WHEEL_SLOTS - 1)], ready, now);
+  }
+  w.lastRun = now;
+  w.started = true;
+
+  while (ready) {
+    SchedJob& j = *ready;
+    ready = j.next;
+    j.next = nullptr;
+    j.armed = false;
+
+    uint32_t late = now - j.due;
+    if (late > j.lateMaxMs) j.lateMaxMs = late;
+    j.runs++;
+
+#if PROF_ENABLED
+    if (j.prof < PROF_SLOT_COUNT) {
+      PROF_SCOPE((ProfSlot)j.prof);
+      j.fn(now);
+    } else
+#endif
+    j.fn(now);
+
+    // Periódico: siguiente plazo sobre el anterior (sin deriva). El trabajo
+    // puede haberse rearmado o cancelado a sí mismo; eso manda.
+    if (j.period && !j.armed) {
+      uint32_t p = *j.period ? *j.period : 1;
+      uint32_t next = j.due + p;
+      if (due_by(next, now)) {
+        j.overruns++;
+        next = now + p;
+      }
+      arm_at(j, next);
+    }
+  }
+  return sched_next_in(t, now);
+}
+
+uint32_t sched_next_in(SchedTask t, uint32_t now) {
+  uint32_t best = UINT32_MAX;
+  for (SchedJob* j = s_wheels[t].all; j; j = j->link) {
+    if (!j->armed) continue;
+    uint32_t in = due_by(j->due, now) ? 0 : (j->due - now);
+    if (in < best) best = in;
+  }
+  return best;
+}
+
+// Lee contadores de 32 bits de ambas tareas sin bloqueo: lecturas atómicas,
+// como mucho una muestra desfasada.
+void sched_format(TextBuf& out) {
+  uint32_t jobs = 0, over = 0, lateMax = 0;
+  for (uint8_t t = 0; t < SCHED_TASK_COUNT; ++t)
+    for (const SchedJob* j = s_wheels[t].all; j; j = j->link) {
+      jobs++;
+      over += j->overruns;
+      if (j->lateMaxMs > lateMax) lateMax = j->lateMaxMs;
+    }
+
+  out.str("{\"jobs\":").unum(jobs)
+     .str(",\"overruns\":").unum(over)
+     .str(",\"late_max\":").unum(lateMax);
+  for (uint8_t t = 0; t < SCHED_TASK_COUNT; ++t)
+    for (const SchedJob* j = s_wheels[t].all; j; j = j->link) {
+      if (j->overruns == 0) continue;
+      out.str(",\"").str(j->name).str("\":[")
+         .unum(j->runs).ch(',').unum(j->overruns).ch(',').unum(j->lateMaxMs).ch(']');
+    }
+  out.ch('}');
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <Arduino.h>
+#include "prof.h"
+#include "msgbuf.h"
+
+// =====================================================
+//     Planificador cooperativo por plazos (rueda de tiempos)
+// =====================================================
+// Cada tarea (control, red/UI) tiene su rueda de SCHED_WHEEL_SLOTS tramos de
+// 1 ms. Los módulos registran trabajos periódicos o de un disparo; en cada
+// pasada sched_run() ejecuta los vencidos por orden de plazo y, a igual
+// plazo, por prioridad (0 = primero). Un periódico que pierde un periodo
+// entero cuenta un overrun y se realinea sin ráfagas de recuperación.
+//
+// Los SchedJob son del módulo que los registra (estáticos, sin heap) y solo
+// la tarea dueña los arma, cancela o ejecuta.
+
+typedef void (*SchedFn)(uint32_t nowMs);
+
+enum SchedTask : uint8_t { SCHED_CONTROL = 0, SCHED_NET, SCHED_TASK_COUNT };
+
+struct SchedJob {
+  const char*     name;
+  SchedFn         fn;
+  const uint32_t* period;     // periodo vivo (ms); nullptr = un disparo
+  uint32_t        ownPeriod;  // almacén cuando el periodo es fijo
+  uint32_t        due;        // plazo (millis)
+  uint8_t         prio;
+  uint8_t         task;
+  uint8_t         prof;       // ProfSlot o PROF_SLOT_COUNT
+  bool            armed;
+  SchedJob*       next;       // lista del tramo de la rueda / lista de listos
+  SchedJob*       link;       // lista de todos los trabajos de la tarea
+  uint32_t        runs;
+  uint32_t        overruns;   // periodos completos perdidos
+  uint32_t        lateMaxMs;  // máximo retraso sobre el plazo
+};
+
+// Periódico con periodo fijo; primer disparo a un periodo de ahora
+void sched_every(SchedJob& j, SchedTask t, const char* name, uint32_t periodMs,
+                 uint8_t prio, SchedFn fn, ProfSlot prof = PROF_SLOT_COUNT);
+
+// Periódico cuyo periodo se relee en cada rearme (p. ej. un campo de params)
+void sched_every_ref(SchedJob& j, SchedTask t, const char* name, const uint32_t& periodMs,
+                     uint8_t prio, SchedFn fn, ProfSlot prof = PROF_SLOT_COUNT);
+
+// Un disparo: se registra desarmado; sched_after() lo arma (o lo rearma)
+void sched_once(SchedJob& j, SchedTask t, const char* name, uint8_t prio, SchedFn fn);
+void sched_after(SchedJob& j, uint32_t delayMs);
+void sched_cancel(SchedJob& j);
+bool sched_pending(const SchedJob& j);
+
+// Ejecuta lo vencido (desde la tarea dueña); devuelve ms hasta el próximo plazo
+uint32_t sched_run(SchedTask t, uint32_t nowMs);
+uint32_t sched_next_in(SchedTask t, uint32_t nowMs);
+
+// {"jobs":n,"overruns":n,"late_max":ms,"<trabajo>":[runs,overruns,late_max],...}
+// (solo los trabajos con overruns, para que quepa)
+void sched_format(TextBuf& out);
@@ -0,0 +1,39 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+
+// Cola lock-free de un solo productor y un solo consumidor (pueden estar en
+// tareas y núcleos distintos). N debe ser potencia de 2; caben N-1 elementos.
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+public:
+  // Productor: false si la cola está llena (el elemento se descarta)
+  bool push(const T& v) {
+    size_t h    = head.load(std::memory_order_relaxed);
+    size_t next = (h + 1) & (N - 1);
+    if (next == tail.load(std::memory_order_acquire)) return false;
+    buf[h] = v;
+    head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumidor: false si no hay nada
+  bool pop(T& out) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    out = buf[t];
+    tail.store((t + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+private:
+  T buf[N];
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+};
@@ -2,8 +2,14 @@
 #include "net.h"
 #include "config.h"
 #include "motor.h"
+#include "tasks.h"
+#include "spsc.h"
+#include "heapmon.h"
 
-static EstadoPuerta estadoActual = DETENIDO;
+static volatile EstadoPuerta estadoActual = DETENIDO;
+
+// Cambios pendientes de mostrar/publicar (control → red/UI)
+static SpscQueue<EstadoPuerta, 8> s_cambios;
 
 static const char* estadoToText(EstadoPuerta e) {
   switch (e) {
@@ -18,6 +24,11 @@ static const char* estadoToText(EstadoPuerta e) {
 EstadoPuerta getEstado() { return estadoActual; }
 
 void setEstado(EstadoPuerta e) {
+  if (!tasks_in_control_context()) {
+    tasks_post_cmd(CMD_SET_ESTADO, (int32_t)e);
+    return;
+  }
+
   if (estadoActual == e) return;
   estadoActual = e;
 
@@ -34,7 +45,15 @@ void setEstado(EstadoPuerta e) {
       break;
   }
 
-  // Renderizar y publicar MQTT
-  renderEstado(estadoActual);
-  net_mqtt_publish(TOPIC_STATE, String(estadoToText(estadoActual)), true);
+  // Renderizar y publicar MQTT desde la tarea de red/UI
+  (void)s_cambios.push(e);
+}
+
+void state_ui_tick() {
+  EstadoPuerta e;
+  while (s_cambios.pop(e)) {
+    renderEstado(e);
+    HeapWatch hw;
+    net_mqtt_publish(TOPIC_STATE, estadoToText(e), true);
+  }
 }
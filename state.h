@@ -3,4 +3,10 @@
 #include "display.h"
 
 EstadoPuerta getEstado();
-void setEstado(EstadoPuerta e);
\ No newline at end of file
+
+// Cambia el estado y actúa sobre el motor. Fuera de la tarea de control el
+// cambio se encola y se aplica en el siguiente periodo de control.
+void setEstado(EstadoPuerta e);
+
+// Desde la tarea de red/UI: renderiza y publica por MQTT cada cambio de estado
+void state_ui_tick();
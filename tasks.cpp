@@ -0,0 +1,161 @@
+#include "tasks.h"
+#include <esp_timer.h>
+#include <math.h>
+#include "config.h"
+#include "spsc.h"
+#include "state.h"
+#include "hall.h"
+#include "motor.h"
+#include "current.h"
+#include "traj.h"
+#include "ienv.h"
+#include "prof.h"
+#include "telem.h"
+
+static TaskHandle_t s_controlTask = nullptr;
+static TaskHandle_t s_netTask     = nullptr;
+static TaskStepFn   s_controlStep = nullptr;
+static TaskNetStepFn s_netStep    = nullptr;
+
+struct TaskCmd {
+  TaskCmdType type;
+  int32_t     arg;
+};
+
+static SpscQueue<TaskCmd, 16>    s_cmds;      // red → control
+static SpscQueue<CtlSnapshot, 8> s_snaps;     // control → red
+static CtlSnapshot s_lastSnap = {};
+
+// Estadísticas de jitter (escribe control, lee red)
+static portMUX_TYPE s_timingMux = portMUX_INITIALIZER_UNLOCKED;
+static CtlTiming    s_timing = {};
+static uint64_t     s_periodSumUs = 0;
+
+static void timing_reset_locked() {
+  s_timing = {};
+  s_timing.periodMinUs = UINT32_MAX;
+  s_periodSumUs = 0;
+}
+
+static void timing_record(uint32_t periodUs, uint32_t execUs) {
+  const uint32_t nominalUs = CONTROL_PERIOD_MS * 1000UL;
+  portENTER_CRITICAL(&s_timingMux);
+  s_timing.samples++;
+  s_periodSumUs += periodUs;
+  if (periodUs < s_timing.periodMinUs) s_timing.periodMinUs = periodUs;
+  if (periodUs > s_timing.periodMaxUs) s_timing.periodMaxUs = periodUs;
+  if (execUs > s_timing.execMaxUs)     s_timing.execMaxUs   = execUs;
+  if (periodUs > nominalUs + nominalUs / 2) s_timing.overruns++;
+  portEXIT_CRITICAL(&s_timingMux);
+}
+
+static void apply_cmd(const TaskCmd& c) {
+  switch (c.type) {
+    case CMD_SET_ESTADO:       setEstado((EstadoPuerta)c.arg); break;
+    case CMD_HALL_MARK_CLOSED: hall_mark_closed();             break;
+    case CMD_HALL_MARK_OPEN:   hall_mark_open();               break;
+    case CMD_GOTO:             traj_start(c.arg);              break;
+    case CMD_IENV_RESET:       ienv_reset();                   break;
+    case CMD_ADC_LUT:          current_lut_apply();            break;
+  }
+}
+
+static void push_snapshot(uint32_t nowMs) {
+  CtlSnapshot s;
+  s.ms     = nowMs;
+  s.pos    = hall_get_count();
+  s.dir    = (int8_t)hall_get_dir();
+  s.vel    = hall_get_velocity();
+  s.estado = (uint8_t)getEstado();
+  s.speed  = (uint8_t)motor_get_speed();
+  s.mA     = current_read_mA();
+  s.duty   = (uint16_t)lroundf(motor_get_duty() * 100.0f);
+  s.flags  = telem_ctl_flags();
+  (void)s_snaps.push(s);   // si red va atrasada, se pierde esta muestra
+}
+
+static void controlTask(void*) {
+  const TickType_t period = pdMS_TO_TICKS(CONTROL_PERIOD_MS);
+  TickType_t lastWake = xTaskGetTickCount();
+  int64_t tPrev = esp_timer_get_time();
+
+  for (;;) {
+    xTaskDelayUntil(&lastWake, period);
+    int64_t t0 = esp_timer_get_time();
+
+    TaskCmd c;
+    while (s_cmds.pop(c)) apply_cmd(c);
+
+    uint32_t now = millis();
+    prof_period(PROF_CTL_PERIOD);
+    {
+      PROF_SCOPE(PROF_CTL_STEP);
+      s_controlStep(now);
+    }
+    push_snapshot(now);
+
+    int64_t t1 = esp_timer_get_time();
+    timing_record((uint32_t)(t0 - tPrev), (uint32_t)(t1 - t0));
+    tPrev = t0;
+  }
+}
+
+static void netTask(void*) {
+  for (;;) {
+    CtlSnapshot s;
+    while (s_snaps.pop(s)) {
+      s_lastSnap = s;
+      telem_push(s);   // cada captura cuenta para la telemetría de 50 Hz
+    }
+
+    uint32_t sleepMs;
+    prof_period(PROF_NET_PERIOD);
+    {
+      PROF_SCOPE(PROF_NET_STEP);
+      sleepMs = s_netStep(millis());
+    }
+    // Duerme hasta el próximo plazo; al menos un tick (idle/watchdog del núcleo)
+    if (sleepMs > SCHED_NET_MAX_SLEEP_MS) sleepMs = SCHED_NET_MAX_SLEEP_MS;
+    TickType_t ticks = pdMS_TO_TICKS(sleepMs);
+    vTaskDelay(ticks ? ticks : 1);
+  }
+}
+
+void tasks_begin(TaskStepFn controlStep, TaskNetStepFn netStep) {
+  s_controlStep = controlStep;
+  s_netStep     = netStep;
+
+  portENTER_CRITICAL(&s_timingMux);
+  timing_reset_locked();
+  portEXIT_CRITICAL(&s_timingMux);
+
+  // Red primero: así los comandos y logs del arranque ya tienen consumidor
+  xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, nullptr,
+                          NET_TASK_PRIO, &s_netTask, NET_TASK_CORE);
+  xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK, nullptr,
+                          CONTROL_TASK_PRIO, &s_controlTask, CONTROL_TASK_CORE);
+}
+
+bool tasks_in_control_context() {
+  return s_controlTask == nullptr || xTaskGetCurrentTaskHandle() == s_controlTask;
+}
+
+bool tasks_in_net_context() {
+  return s_netTask == nullptr || xTaskGetCurrentTaskHandle() == s_netTask;
+}
+
+bool tasks_post_cmd(TaskCmdType type, int32_t arg) {
+  TaskCmd c = { type, arg };
+  return s_cmds.push(c);
+}
+
+const CtlSnapshot& tasks_snapshot() { return s_lastSnap; }
+
+void tasks_get_timing(CtlTiming& out, bool reset) {
+  portENTER_CRITICAL(&s_timingMux);
+  out = s_timing;
+  out.periodAvgUs = s_timing.samples ? (uint32_t)(s_periodSumUs / s_timing.samples) : 0;
+  if (out.samples == 0) out.periodMinUs = 0;
+  if (reset) timing_reset_locked();
+  portEXIT_CRITICAL(&s_timingMux);
+}
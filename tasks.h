@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+
+// =====================================================
+//   Tareas FreeRTOS: control en tiempo real + red/UI
+// =====================================================
+// - Control: núcleo CONTROL_TASK_CORE, prioridad alta, periodo fijo
+//   CONTROL_PERIOD_MS (rampa motor, guardia de corriente, safety, hall).
+// - Red/UI: núcleo NET_TASK_CORE (Wi-Fi, MQTT, display, luz, OTA); duerme
+//   hasta el próximo plazo del planificador (sched.h).
+// Se comunican con colas lock-free: comandos red → control e instantáneas
+// de telemetría control → red.
+
+// Paso de cada tarea (lo define el sketch); recibe millis(). El de red
+// devuelve los ms hasta su próximo plazo.
+typedef void     (*TaskStepFn)(uint32_t nowMs);
+typedef uint32_t (*TaskNetStepFn)(uint32_t nowMs);
+
+void tasks_begin(TaskStepFn controlStep, TaskNetStepFn netStep);
+
+// ¿Se está ejecutando en la tarea de control / red?
+// Antes de tasks_begin() ambas devuelven true (setup corre en un solo hilo).
+bool tasks_in_control_context();
+bool tasks_in_net_context();
+
+// -----------------------
+// Comandos red → control
+// -----------------------
+enum TaskCmdType : uint8_t {
+  CMD_SET_ESTADO,        // arg = EstadoPuerta
+  CMD_HALL_MARK_CLOSED,
+  CMD_HALL_MARK_OPEN,
+  CMD_GOTO,              // arg = posición objetivo (cuentas)
+  CMD_IENV_RESET,
+  CMD_ADC_LUT,           // aplica la tabla ADC preparada por current_lut_from_points()
+};
+
+// Encola un comando para el próximo periodo de control.
+// Solo desde la tarea de red (cola de un productor). false si la cola está llena.
+bool tasks_post_cmd(TaskCmdType type, int32_t arg = 0);
+
+// -----------------------
+// Telemetría control → red
+// -----------------------
+struct CtlSnapshot {
+  uint32_t ms;        // millis() de la captura
+  long     pos;       // hall_get_count()
+  int8_t   dir;       // hall_get_dir()
+  float    vel;       // hall_get_velocity() (cuentas/s)
+  uint8_t  estado;    // EstadoPuerta
+  uint8_t  speed;     // % aplicado al motor
+  int32_t  mA;        // corriente filtrada
+  uint16_t duty;      // motor_get_duty() en 0.01 %
+  uint8_t  flags;     // TELEM_F_* (telem.h)
+};
+
+// Última instantánea recibida (leer solo desde la tarea de red)
+const CtlSnapshot& tasks_snapshot();
+
+// -----------------------
+// Jitter del periodo de control
+// -----------------------
+struct CtlTiming {
+  uint32_t samples;
+  uint32_t periodMinUs;
+  uint32_t periodMaxUs;
+  uint32_t periodAvgUs;
+  uint32_t execMaxUs;    // duración máxima del paso de control
+  uint32_t overruns;     // periodos > 1.5x el nominal
+};
+
+// Copia las estadísticas acumuladas; con reset=true empieza una ventana nueva
+void tasks_get_timing(CtlTiming& out, bool reset);
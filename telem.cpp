@@ -0,0 +1,97 @@
+#include "telem.h"
+#include <string.h>
+#include <math.h>
+#include "config.h"
+#include "net.h"
+#include "state.h"
+#include "hall.h"
+#include "motor.h"
+#include "traj.h"
+#include "current.h"
+#include "sched.h"
+
+// Lote en curso (solo tarea de red)
+static uint8_t  s_batch[4 + TELEM_BATCH_FRAMES * sizeof(TelemFrame)];
+static uint8_t  s_frames = 0;
+static uint16_t s_seq = 0;
+static uint32_t s_sent = 0;
+
+static uint32_t s_lastSampleMs = 0;
+static bool     s_haveSample = false;
+static bool     s_wasMoving = false;
+
+static SchedJob s_job;                // un disparo: publicar el lote listo
+
+static inline int16_t sat16(long v) {
+  return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : (int16_t)v;
+}
+
+static void append(const CtlSnapshot& s) {
+  TelemFrame f;
+  f.ms     = s.ms;
+  f.pos    = (int32_t)s.pos;
+  f.vel    = sat16(lroundf(s.vel));
+  f.mA     = sat16(s.mA);
+  f.duty   = s.duty;
+  f.estado = s.estado;
+  f.flags  = s.flags;
+  memcpy(s_batch + 4 + s_frames * sizeof(TelemFrame), &f, sizeof(f));
+  s_frames++;
+  s_lastSampleMs = s.ms;
+  s_haveSample = true;
+}
+
+// Publica el lote (sin conexión o con la cola de salida llena se descarta:
+// es telemetría en vivo). Solo cuenta los lotes que la cola admite.
+static void flush(uint32_t) {
+  if (s_frames == 0) return;
+  s_batch[0] = TELEM_VERSION;
+  s_batch[1] = sizeof(TelemFrame);
+  s_batch[2] = (uint8_t)(s_seq & 0xFF);
+  s_batch[3] = (uint8_t)(s_seq >> 8);
+  s_seq++;
+  if (net_mqtt_connected() &&
+      net_mqtt_publish(TOPIC_TELEM, s_batch, 4 + s_frames * sizeof(TelemFrame), false))
+    s_sent++;
+  s_frames = 0;
+}
+
+void telem_begin() {
+  s_frames = 0;
+  s_haveSample = false;
+  s_wasMoving = false;
+  sched_once(s_job, SCHED_NET, "telem", 6, flush);
+}
+
+uint8_t telem_ctl_flags() {
+  uint8_t f = 0;
+  if (hall_is_enabled())      f |= TELEM_F_HALL;
+  if (motor_isSlowMode())     f |= TELEM_F_SLOW;
+  if (traj_active())          f |= TELEM_F_TRAJ;
+  if (current_offset_valid()) f |= TELEM_F_IOFF_OK;
+  if (hall_get_dir() < 0)     f |= TELEM_F_CLOSING;
+  return f;
+}
+
+void telem_push(const CtlSnapshot& s) {
+  bool moving = (s.estado == ABRIENDO || s.estado == CERRANDO);
+  uint32_t every = moving ? TELEM_MOVE_MS : TELEM_IDLE_MS;
+
+  // La muestra con la que termina el movimiento sale siempre, y enseguida
+  bool stopped = s_wasMoving && !moving;
+  s_wasMoving = moving;
+
+  if (!stopped && s_haveSample && (s.ms - s_lastSampleMs) < every) return;
+  if (s_frames >= TELEM_BATCH_FRAMES) return;   // lote lleno sin publicar: se pierde la muestra
+  append(s);
+
+  // Lote completo, o en reposo (no se espera a llenarlo): publicar ya
+  if ((s_frames >= TELEM_BATCH_FRAMES || !moving) && !sched_pending(s_job))
+    sched_after(s_job, 0);
+}
+
+uint32_t telem_batches_sent(bool reset) {
+  uint32_t n = s_sent;
+  if (reset) s_sent = 0;
+  return n;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include "tasks.h"
+
+// =====================================================
+//   Telemetría binaria de movimiento (TOPIC_TELEM)
+// =====================================================
+// Muestras de la tarea de control empaquetadas en tramas fijas de 16 bytes
+// (little-endian), TELEM_MOVE_MS entre muestras en movimiento y una cada
+// TELEM_IDLE_MS en reposo. Se publican por lotes:
+//
+//   lote   = [versión u8][tamaño de trama u8][seq u16] trama*
+//   trama  = [ms u32][pos i32][vel i16 cuentas/s][mA i16][duty u16 0.01 %]
+//            [estado u8][flags u8]
+//
+// Decodificador en tools/telemdecode.py.
+
+static const uint8_t TELEM_VERSION = 1;
+
+enum TelemFlag : uint8_t {
+  TELEM_F_HALL     = 0x01,   // encoder aplicado (hall_is_enabled)
+  TELEM_F_SLOW     = 0x02,   // modo lento
+  TELEM_F_TRAJ     = 0x04,   // planificador de trayectorias activo
+  TELEM_F_IOFF_OK  = 0x08,   // offset del sensor de corriente válido
+  TELEM_F_CLOSING  = 0x10,   // sentido del encoder: cerrando
+};
+
+struct __attribute__((packed)) TelemFrame {
+  uint32_t ms;
+  int32_t  pos;
+  int16_t  vel;
+  int16_t  mA;
+  uint16_t duty;
+  uint8_t  estado;
+  uint8_t  flags;
+};
+static_assert(sizeof(TelemFrame) == 16, "TelemFrame: 16 bytes");
+
+void telem_begin();
+
+// Flags del instante actual (desde la tarea de control, al capturar)
+uint8_t telem_ctl_flags();
+
+// Cada instantánea recibida por la tarea de red (diezma y acumula)
+void telem_push(const CtlSnapshot& s);
+
+// Lotes admitidos en la cola de salida MQTT (opcionalmente reinicia el contador)
+uint32_t telem_batches_sent(bool reset);
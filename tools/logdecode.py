@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""Decodificador del log binario del ESP32 (topic garage/door/log/bin).
+
+Cada lote MQTT es una secuencia de registros:
+    [nivel u8][long. args u8][id u32 LE][ms u32 LE][argumentos...]
+El id es el FNV-1a de 32 bits del literal de formato. La tabla id -> formato
+se genera recorriendo las fuentes (LOGE/LOGW/LOGI/LOGD, logPrintf,
+logPrint, logPrintln), con las mismas reglas de argumentos que logx.cpp.
+
+Uso:
+    logdecode.py --gen-table logtable.json          # generar la tabla
+    logdecode.py [--table logtable.json] lote.bin   # decodificar ficheros
+    logdecode.py --mqtt broker[:puerto]             # escuchar en vivo (paho-mqtt)
+"""
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+TOPIC_BIN = "garage/door/log/bin"
+LOG_STR_MAX = 96   # config.h
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D"}
+
+CALL_RE = re.compile(r'\b(LOG[EWID]|logPrintf|logPrintln|logPrint)\s*\(\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LIT_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+SPEC_RE = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|ll|[hlzjtL])?([diuxXocfFeEgGaAspn%])')
+
+
+def fnv1a32(data):
+    h = 2166136261
+    for b in data:
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def c_unescape(s):
+    out = bytearray()
+    i = 0
+    raw = s.encode("utf-8")
+    while i < len(raw):
+        c = raw[i]
+        if c != 0x5C:
+            out.append(c)
+            i += 1
+            continue
+        i += 1
+        e = chr(raw[i])
+        simple = {"n": 10, "r": 13, "t": 9, "0": 0, "\\": 92, '"': 34, "'": 39, "a": 7, "b": 8, "f": 12, "v": 11}
+        if e == "x":
+            j = i + 1
+            while j < len(raw) and chr(raw[j]) in "0123456789abcdefABCDEF":
+                j += 1
+            out.append(int(raw[i + 1:j], 16) & 0xFF)
+            i = j
+        elif e in "01234567":
+            j = i
+            while j < len(raw) and j < i + 3 and chr(raw[j]) in "01234567":
+                j += 1
+            out.append(int(raw[i:j], 8) & 0xFF)
+            i = j
+        else:
+            out.append(simple.get(e, raw[i]))
+            i += 1
+    return bytes(out)
+
+
+def build_table(src_dir):
+    table = {}
+    for name in sorted(os.listdir(src_dir)):
+        if not name.endswith((".cpp", ".h", ".ino")):
+            continue
+        with open(os.path.join(src_dir, name), encoding="utf-8") as f:
+            text = f.read()
+        for m in CALL_RE.finditer(text):
+            fn, lits = m.group(1), m.group(2)
+            fmt = b"".join(c_unescape(x) for x in LIT_RE.findall(lits))
+            if fn == "logPrintln":
+                fmt += b"\n"
+            fid = fnv1a32(fmt)
+            prev = table.get(fid)
+            if prev is not None and prev != fmt:
+                print("aviso: colisión de id %08x: %r / %r" % (fid, prev, fmt), file=sys.stderr)
+            table[fid] = fmt
+    return {k: v.decode("utf-8", "replace") for k, v in table.items()}
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+        self.ok = True
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            self.ok = False
+            return b"\0" * n
+        b = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return b
+
+    def i32(self):
+        return struct.unpack("<i", self.take(4))[0]
+
+
+def format_record(fmt, args, cut):
+    r = Reader(args)
+    out = []
+    last = 0
+    for m in SPEC_RE.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, prec, lmod, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(r.i32())
+        if prec == "*":
+            prec = str(r.i32())
+        spec = "%" + flags + (width or "") + ("." + prec if prec not in (None, "") else ("." if prec == "" else ""))
+        wide = lmod in ("ll", "j")
+        if conv in "di":
+            v = struct.unpack("<q" if wide else "<i", r.take(8 if wide else 4))[0]
+            out.append((spec + "d") % v)
+        elif conv in "uxXo":
+            v = struct.unpack("<Q" if wide else "<I", r.take(8 if wide else 4))[0]
+            out.append((spec + ("d" if conv == "u" else conv)) % v)
+        elif conv == "c":
+            out.append((spec + "c") % chr(r.take(1)[0]))
+        elif conv in "fFeEgGaA":
+            v = struct.unpack("<f", r.take(4))[0]
+            out.append((spec + ("f" if conv in "aA" else conv)) % v)
+        elif conv == "s":
+            n = r.take(1)[0]
+            if n > LOG_STR_MAX:
+                r.ok = False
+                n = 0
+            out.append((spec + "s") % r.take(n).decode("utf-8", "replace"))
+        elif conv == "p":
+            out.append("0x%08x" % struct.unpack("<I", r.take(4))[0])
+        if not r.ok:
+            out.pop()
+            break
+    else:
+        out.append(fmt[last:])
+    text = "".join(out)
+    if cut or not r.ok:
+        text += "…\n"
+    return text
+
+
+def decode_batch(data, table):
+    pos = 0
+    while pos + 10 <= len(data):
+        level, alen = data[pos], data[pos + 1]
+        fid, ms = struct.unpack_from("<II", data, pos + 2)
+        args = data[pos + 10:pos + 10 + alen]
+        pos += 10 + alen
+        fmt = table.get(fid)
+        lvl = LEVELS.get(level & 0x7F, "?")
+        if fmt is None:
+            text = "<id %08x desconocido, %d bytes>\n" % (fid, alen)
+        else:
+            text = format_record(fmt, args, bool(level & 0x80))
+        yield "%10.3f %s %s" % (ms / 1000.0, lvl, text)
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("files", nargs="*", help="lotes binarios (payloads de %s)" % TOPIC_BIN)
+    ap.add_argument("--src", default=os.path.join(here, ".."), help="directorio de fuentes")
+    ap.add_argument("--table", help="tabla JSON generada con --gen-table")
+    ap.add_argument("--gen-table", metavar="OUT", help="escribir la tabla id -> formato y salir")
+    ap.add_argument("--mqtt", metavar="HOST[:PORT]", help="suscribirse a %s y decodificar en vivo" % TOPIC_BIN)
+    a = ap.parse_args()
+
+    if a.table:
+        with open(a.table, encoding="utf-8") as f:
+            table = {int(k, 16): v for k, v in json.load(f).items()}
+    else:
+        table = build_table(a.src)
+
+    if a.gen_table:
+        with open(a.gen_table, "w", encoding="utf-8") as f:
+            json.dump({"%08x" % k: v for k, v in sorted(table.items())}, f, ensure_ascii=False, indent=1)
+        print("%d formatos" % len(table), file=sys.stderr)
+        return
+
+    for name in a.files:
+        with open(name, "rb") as f:
+            for line in decode_batch(f.read(), table):
+                sys.stdout.write(line)
+
+    if a.mqtt:
+        import paho.mqtt.client as mqtt
+        host, _, port = a.mqtt.partition(":")
+        cli = mqtt.Client()
+        cli.on_message = lambda c, u, msg: [sys.stdout.write(l) for l in decode_batch(msg.payload, table)]
+        cli.connect(host, int(port or 1883))
+        cli.subscribe(TOPIC_BIN)
+        cli.loop_forever()
+
+
+if __name__ == "__main__":
+    main()
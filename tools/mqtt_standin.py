@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""Broker MQTT 3.1.1 mínimo para probar el cliente asíncrono del ESP32.
+
+Sin dependencias: acepta CONNECT, SUBSCRIBE, PUBLISH (QoS 0/1), PINGREQ y
+DISCONNECT, imprime lo publicado y reenvía a los suscriptores. Sirve para
+inyectar fallos de red que con un broker real cuestan de provocar:
+
+    --connect-delay S   retrasa el CONNACK S segundos (broker lento / DNS)
+    --drop-after S      corta cada conexión a los S segundos (reconexiones)
+    --send TOPIC=VAL    publica VAL al dispositivo tras cada SUBSCRIBE
+
+El firmware publica en garage/sys/net el peor net_tick() en µs
+(tick_max_us). Con --max-tick-us el stand-in lo comprueba y termina con
+código 1 si se supera: la tarea de red no debe bloquearse aunque el broker
+tarde en responder. La misma comprobación sin red ni equipo, contra el
+net.cpp real, es tools/sim/net_block (make -C tools/sim block; también en
+make -C tools/sim check).
+
+Uso:
+    mqtt_standin.py --port 1883 --connect-delay 8 --drop-after 30 \\
+                    --max-tick-us 20000 --duration 600
+"""
+import argparse
+import json
+import socket
+import sys
+import threading
+import time
+
+TOPIC_NET = "garage/sys/net"
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 1, 2, 3, 4
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 12, 13, 14
+
+
+def encode_len(n):
+    out = bytearray()
+    while True:
+        b, n = n & 0x7F, n >> 7
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def packet(ptype, flags, body):
+    return bytes([(ptype << 4) | flags]) + encode_len(len(body)) + body
+
+
+def mqtt_str(s):
+    b = s.encode()
+    return len(b).to_bytes(2, "big") + b
+
+
+def publish_packet(topic, payload, retain=False):
+    return packet(PUBLISH, 1 if retain else 0, mqtt_str(topic) + payload)
+
+
+def recv_exact(sock, n):
+    buf = bytearray()
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("cerrada")
+        buf += chunk
+    return bytes(buf)
+
+
+def read_packet(sock):
+    h = recv_exact(sock, 1)[0]
+    n, shift = 0, 0
+    while True:
+        b = recv_exact(sock, 1)[0]
+        n |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            break
+    return h >> 4, h & 0x0F, recv_exact(sock, n)
+
+
+class Broker:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.subs = {}           # socket -> set(topic)
+        self.retained = {}       # topic -> payload
+        self.connects = 0
+        self.tick_max = 0
+        self.tick_over = []
+
+    def log(self, msg):
+        print("%s %s" % (time.strftime("%H:%M:%S"), msg), flush=True)
+
+    def on_publish(self, topic, payload, retain):
+        text = payload.decode(errors="replace")
+        self.log("PUB %s%s %s" % (topic, " (r)" if retain else "", text[:200]))
+        if retain:
+            with self.lock:
+                self.retained[topic] = payload
+        if topic == TOPIC_NET:
+            self.check_tick(text)
+        with self.lock:
+            targets = [s for s, t in self.subs.items() if topic in t]
+        for s in targets:
+            try:
+                s.sendall(publish_packet(topic, payload))
+            except OSError:
+                pass
+
+    def check_tick(self, text):
+        try:
+            us = int(json.loads(text).get("tick_max_us", 0))
+        except (ValueError, AttributeError):
+            return
+        self.tick_max = max(self.tick_max, us)
+        limit = self.args.max_tick_us
+        if limit and us > limit:
+            self.tick_over.append(us)
+            self.log("!! net_tick %d µs > %d µs" % (us, limit))
+
+    def client(self, sock, addr):
+        sock.settimeout(None)
+        t_conn = time.monotonic()
+        try:
+            ptype, _, body = read_packet(sock)
+            if ptype != CONNECT:
+                return
+            # [nombre][nivel][flags][keepalive][client id]...
+            name_len = int.from_bytes(body[0:2], "big")
+            p = 2 + name_len + 4
+            cid_len = int.from_bytes(body[p:p + 2], "big")
+            cid = body[p + 2:p + 2 + cid_len].decode(errors="replace")
+            self.connects += 1
+            self.log("CONNECT %s desde %s:%d (#%d)" % (cid, addr[0], addr[1], self.connects))
+            if self.args.connect_delay:
+                self.log("   CONNACK retrasado %.1f s" % self.args.connect_delay)
+                time.sleep(self.args.connect_delay)
+            sock.sendall(packet(CONNACK, 0, b"\x00\x00"))
+            if self.args.drop_after:
+                sock.settimeout(0.5)
+            while True:
+                if self.args.drop_after and time.monotonic() - t_conn > self.args.drop_after:
+                    self.log("   corte forzado de %s" % cid)
+                    return
+                try:
+                    ptype, flags, body = read_packet(sock)
+                except socket.timeout:
+                    continue
+                if ptype == PUBLISH:
+                    tlen = int.from_bytes(body[0:2], "big")
+                    topic = body[2:2 + tlen].decode(errors="replace")
+                    p = 2 + tlen
+                    qos = (flags >> 1) & 3
+                    if qos:
+                        sock.sendall(packet(PUBACK, 0, body[p:p + 2]))
+                        p += 2
+                    self.on_publish(topic, body[p:], bool(flags & 1))
+                elif ptype == SUBSCRIBE:
+                    pid, p, topics = body[0:2], 2, []
+                    while p < len(body):
+                        tlen = int.from_bytes(body[p:p + 2], "big")
+                        topics.append(body[p + 2:p + 2 + tlen].decode())
+                        p += 2 + tlen + 1
+                    with self.lock:
+                        self.subs.setdefault(sock, set()).update(topics)
+                        retained = [(t, self.retained[t]) for t in topics if t in self.retained]
+                    sock.sendall(packet(SUBACK, 0, pid + bytes(len(topics))))
+                    self.log("SUB %s" % " ".join(topics))
+                    for t, v in retained:
+                        sock.sendall(publish_packet(t, v, retain=True))
+                    for spec in self.args.send:
+                        t, _, v = spec.partition("=")
+                        if t in topics:
+                            self.log("-> %s %s" % (t, v))
+                            sock.sendall(publish_packet(t, v.encode()))
+                elif ptype == PINGREQ:
+                    sock.sendall(packet(PINGRESP, 0, b""))
+                elif ptype == DISCONNECT:
+                    return
+        except (ConnectionError, OSError):
+            pass
+        finally:
+            with self.lock:
+                self.subs.pop(sock, None)
+            sock.close()
+            self.log("fin de %s:%d" % addr)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--connect-delay", metavar="S", type=float, default=0.0,
+                    help="segundos antes de responder CONNACK")
+    ap.add_argument("--drop-after", metavar="S", type=float, default=0.0,
+                    help="cortar cada conexión a los S segundos")
+    ap.add_argument("--send", metavar="TOPIC=VAL", action="append", default=[],
+                    help="publicar al dispositivo tras suscribirse (repetible)")
+    ap.add_argument("--max-tick-us", metavar="US", type=int, default=0,
+                    help="fallar si %s informa tick_max_us mayor" % TOPIC_NET)
+    ap.add_argument("--duration", metavar="S", type=float, default=0.0,
+                    help="terminar a los S segundos (0 = hasta Ctrl-C)")
+    args = ap.parse_args()
+
+    broker = Broker(args)
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind((args.host, args.port))
+    srv.listen(4)
+    srv.settimeout(0.5)
+    broker.log("escuchando en %s:%d" % (args.host, args.port))
+
+    t_end = time.monotonic() + args.duration if args.duration else None
+    try:
+        while t_end is None or time.monotonic() < t_end:
+            try:
+                sock, addr = srv.accept()
+            except socket.timeout:
+                continue
+            threading.Thread(target=broker.client, args=(sock, addr), daemon=True).start()
+    except KeyboardInterrupt:
+        pass
+    srv.close()
+
+    print("conexiones=%d  peor net_tick=%d µs" % (broker.connects, broker.tick_max))
+    if broker.tick_over:
+        print("FALLO: %d informes por encima de %d µs" % (len(broker.tick_over), args.max_tick_us))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,185 @@
+// =====================================================
+//   Vaciado de tramas del ADC continuo (host)
+// =====================================================
+// Inyecta tramas en el pool del ADC simulado sin avanzar el tiempo y llama a
+// current_tick() como lo haría el lazo de control. Comprueba que:
+//   - cada pasada vacía todas las tramas pendientes, en orden y sin repetir;
+//   - una trama que llega a mitad del vaciado no se pierde (la lee la
+//     pasada siguiente);
+//   - sin desbordamiento nunca se lee el pool vacío (en el equipo es un
+//     timeout del driver);
+//   - con el pool desbordado se leen las que quedan y solo una lectura da
+//     con el pool vacío (el ISR contó más tramas de las que se guardaron).
+// Mide además el coste en el host de current_tick() por trama (lectura del
+// pool simulado, conversión, filtro y ventana), con una trama por pasada y
+// con ráfagas que llenan el pool, y el de current_window_stats() que safety
+// llama en cada pasada de control. Las tramas se inyectan fuera de la
+// medida. Las cifras son del host: sirven para comparar, no como tiempos
+// del ESP32.
+// Sale con código 1 si falla alguna.
+//
+//   make -C tools/sim adc
+#include <Arduino.h>
+#include <chrono>
+#include "config.h"
+#include "cfgstore.h"
+#include "params.h"
+#include "current.h"
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+// Raw por encima del cero del sensor (~2070): más raw, más corriente
+static const int RAW_BASE = 2300;
+static const int RAW_HIGH = 3000;
+
+static int s_fails = 0;
+
+static void check(const char* name, bool ok) {
+  printf("  %-5s  %s\n", ok ? "ok" : "FALLO", name);
+  if (!ok) s_fails++;
+}
+
+static void tick() {
+  sim_set_context(SIM_CTX_CONTROL);
+  current_tick(millis());
+  sim_set_context(SIM_CTX_DRIVER);
+}
+
+static uint16_t samples() {
+  CurrentStats st;
+  current_window_stats(st);
+  return st.samples;
+}
+
+// Llena la ventana con la base para partir siempre del mismo filtro
+static void settle() {
+  for (int i = 0; i < 64; ++i) { sim_adc_inject(RAW_BASE); tick(); }
+}
+
+static void inject_mid_drain() { sim_adc_inject(RAW_BASE); }
+
+// ---- Coste por trama ----
+static const uint32_t BENCH_FRAMES = 200000;
+
+typedef std::chrono::steady_clock Clock;
+
+static double ns_since(Clock::time_point t0) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+// ns por trama vaciando ráfagas de 'burst' tramas en cada current_tick()
+static double ns_per_frame(size_t burst) {
+  sim_set_context(SIM_CTX_CONTROL);
+  double ns = 0;
+  for (uint32_t n = 0; n < BENCH_FRAMES; n += burst) {
+    for (size_t i = 0; i < burst; ++i) sim_adc_inject(RAW_BASE + (int)((n + i) & 63));
+    unsigned long now = millis();
+    auto t0 = Clock::now();
+    current_tick(now);
+    ns += ns_since(t0);
+  }
+  sim_set_context(SIM_CTX_DRIVER);
+  return ns / BENCH_FRAMES;
+}
+
+static void bench() {
+  double nsEmpty = 0;
+  for (uint32_t i = 0; i < BENCH_FRAMES; ++i) {
+    auto t0 = Clock::now();
+    nsEmpty += ns_since(t0);
+  }
+  const double base = nsEmpty / BENCH_FRAMES;
+
+  double one   = ns_per_frame(1) - base;
+  double burst = ns_per_frame(8) - base / 8;
+
+  double nsStats = 0;
+  CurrentStats st;
+  for (uint32_t i = 0; i < BENCH_FRAMES; ++i) {
+    auto t0 = Clock::now();
+    current_window_stats(st);
+    nsStats += ns_since(t0);
+  }
+
+  printf("  current_tick, 1 trama/pasada   %6.1f ns/trama\n", one);
+  printf("  current_tick, ráfagas de 8     %6.1f ns/trama\n", burst);
+  printf("  current_window_stats           %6.1f ns/llamada (%u muestras)\n",
+         nsStats / BENCH_FRAMES - base, (unsigned)st.samples);
+}
+
+int main() {
+  sim_set_context(SIM_CTX_BOOT);
+  cfg_begin();
+  params_begin();
+  current_begin();
+  sim_set_context(SIM_CTX_DRIVER);
+  sim_adc_set_pool(8);
+
+  printf("adc_drain: pool de %u tramas\n", 8u);
+
+  {
+    uint32_t r0 = sim_adc_reads();
+    sim_adc_inject(RAW_BASE);
+    tick();
+    uint16_t s1 = samples();
+    tick();   // sin tramas nuevas: no se vuelve a leer la anterior
+    check("una trama, una lectura", sim_adc_reads() - r0 == 1 && s1 == 1 && samples() == 1);
+  }
+
+  {
+    uint32_t r0 = sim_adc_reads();
+    uint16_t s0 = samples();
+    for (int i = 0; i < 3; ++i) sim_adc_inject(RAW_BASE);
+    tick();
+    check("ráfaga de 3: se vacía entera",
+          sim_adc_reads() - r0 == 3 && samples() == s0 + 3 && sim_adc_pending() == 0);
+  }
+
+  {
+    // El filtro ve las tramas de la más antigua a la más reciente
+    settle();
+    sim_adc_inject(RAW_HIGH); sim_adc_inject(RAW_BASE); sim_adc_inject(RAW_BASE);
+    tick();
+    float highFirst = current_readA();
+    settle();
+    sim_adc_inject(RAW_BASE); sim_adc_inject(RAW_BASE); sim_adc_inject(RAW_HIGH);
+    tick();
+    float highLast = current_readA();
+    printf("    alta primero %.3f A, alta al final %.3f A\n", highFirst, highLast);
+    check("orden: la última trama pesa más en el filtro", highLast > highFirst);
+  }
+
+  {
+    uint32_t r0 = sim_adc_reads();
+    sim_adc_inject(RAW_BASE); sim_adc_inject(RAW_BASE);
+    sim_adc_on_next_read(inject_mid_drain);
+    tick();
+    size_t left = sim_adc_pending();
+    tick();
+    check("trama a mitad del vaciado: se lee después",
+          left == 1 && sim_adc_reads() - r0 == 3 && sim_adc_pending() == 0);
+  }
+
+  check("nunca se lee el pool vacío", sim_adc_empty_reads() == 0);
+
+  {
+    sim_adc_set_pool(2);
+    uint32_t r0 = sim_adc_reads(), o0 = sim_adc_overflows(), e0 = sim_adc_empty_reads();
+    for (int i = 0; i < 5; ++i) sim_adc_inject(RAW_BASE);
+    tick();
+    tick();
+    check("pool desbordado: se leen las 2 que quedan",
+          sim_adc_overflows() - o0 == 3 && sim_adc_reads() - r0 == 2 &&
+          sim_adc_pending() == 0 && sim_adc_empty_reads() - e0 == 1);
+    sim_adc_set_pool(8);
+  }
+
+  {
+    uint32_t e0 = sim_adc_empty_reads();
+    bench();
+    check("medida: sin lecturas del pool vacío", sim_adc_empty_reads() == e0 && sim_adc_pending() == 0);
+  }
+
+  puts(s_fails ? "  FALLO" : "  ok");
+  return s_fails ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+#include "door_model.h"
+#include <math.h>
+
+void DoorModel::reset(float pos) {
+  m_pos = pos;
+  m_vel = 0.0f;
+  m_i   = 0.0f;
+  m_stalled = false;
+}
+
+// Rozamiento en marcha (sin signo) en la posición actual
+float DoorModel::friction(float v) const {
+  float f = cfg.fCoulombA + cfg.fViscousA * fabsf(v);
+  if (cfg.tightA > 0.0f) {
+    // Campana centrada a mitad de recorrido, ancho ~10% del recorrido
+    float x = (m_pos - cfg.travel * 0.5f) / (cfg.travel * 0.05f);
+    f += cfg.tightA * expf(-x * x);
+  }
+  return f * cfg.frictionScale;
+}
+
+void DoorModel::step(float dt, float dutyOpen, float dutyClose) {
+  float u = (dutyOpen - dutyClose) * cfg.supplyV;
+  m_i = (u - cfg.kE * m_vel) / cfg.rOhm;
+
+  const float lo = -(float)cfg.overTravel;
+  const float hi = (float)(cfg.travel + cfg.overTravel);
+
+  if (m_vel == 0.0f) {
+    // Parada: solo arranca si vence el rozamiento estático (y no empuja contra el tope)
+    float fs = cfg.fStaticA * cfg.frictionScale;
+    bool pushHi = (m_i > 0.0f) && (m_pos >= hi);
+    bool pushLo = (m_i < 0.0f) && (m_pos <= lo);
+    m_stalled = pushHi || pushLo;
+    if (fabsf(m_i) <= fs || m_stalled) return;
+    m_vel = (m_i - (m_i > 0.0f ? fs : -fs)) / cfg.inertia * dt;
+  } else {
+    float f = friction(m_vel);
+    float vNew = m_vel + (m_i - (m_vel > 0.0f ? f : -f)) / cfg.inertia * dt;
+    // El rozamiento frena hasta 0, no invierte el sentido
+    if ((m_vel > 0.0f && vNew < 0.0f) || (m_vel < 0.0f && vNew > 0.0f)) vNew = 0.0f;
+    m_vel = vNew;
+  }
+
+  m_pos += m_vel * dt;
+  m_stalled = false;
+  if (m_pos >= hi) { m_pos = hi; if (m_vel > 0.0f) m_vel = 0.0f; }
+  if (m_pos <= lo) { m_pos = lo; if (m_vel < 0.0f) m_vel = 0.0f; }
+}
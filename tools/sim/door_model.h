@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+// =====================================================
+//      Modelo físico de la puerta (motor DC + carro)
+// =====================================================
+// Todo en unidades del encoder: posición en cuentas (0 = cerrada) y
+// velocidad en cuentas/s. Las fuerzas se expresan como "corriente
+// equivalente" (A): el par del motor es kE·I, así que el rozamiento se
+// indica directamente en amperios que el motor necesita para vencerlo.
+//
+//   I = (duty·V - kE·v) / R                 (sin inductancia: τe << 100 µs)
+//   inercia · dv/dt = I - roz(v, pos)       (inercia en A·s por cuenta/s)
+//
+// Más allá del recorrido nominal hay un tope mecánico rígido: si el
+// control no para a tiempo el motor se bloquea y la corriente sube a V/R.
+
+struct DoorModelCfg {
+  float supplyV     = 24.0f;     // alimentación del puente H (V)
+  float rOhm        = 1.0f;      // resistencia de inducido (Ω)
+  float kE          = 0.020f;    // fcem: V por cuenta/s (≈1150 c/s en vacío)
+  float inertia     = 0.003f;    // A·s por cuenta/s (τ mecánica ≈ 150 ms)
+  float fStaticA    = 4.8f;      // rozamiento de arranque (A equivalentes)
+  float fCoulombA   = 1.5f;      // rozamiento seco en marcha
+  float fViscousA   = 0.0005f;   // A por cuenta/s
+  float tightA      = 0.0f;      // punto duro a mitad de recorrido (A extra)
+  float frictionScale = 1.0f;    // multiplicador del rozamiento (variación por ciclo)
+
+  long  travel      = 10000;     // cuentas entre cerrada y abierta
+  long  overTravel  = 80;        // holgura hasta el tope mecánico (cuentas)
+
+  // Sensor ACS712 + divisor + ADC (como en current.cpp)
+  float acsVPerA    = 0.100f;
+  float acsZeroV    = 2.5f;
+  float dividerGain = 1.5f;
+  float vref        = 3.3f;
+  int   adcMax      = 4095;
+  float noiseMv     = 15.0f;     // ruido por conversión a la salida del sensor (mV rms)
+};
+
+class DoorModel {
+public:
+  DoorModelCfg cfg;
+
+  void reset(float pos = 0.0f);
+
+  // Avanza dt segundos con el duty aplicado a cada lado del puente (0..1)
+  void step(float dt, float dutyOpen, float dutyClose);
+
+  float pos()     const { return m_pos; }
+  float vel()     const { return m_vel; }
+  float current() const { return m_i; }        // con signo (+ abrir)
+  long  counts()  const { return (long)floorf(m_pos); }
+  bool  atHardStop() const { return m_stalled; }
+
+  // Tensión a la salida del ACS712 para la corriente actual
+  float sensorV() const { return cfg.acsZeroV + cfg.acsVPerA * m_i; }
+
+private:
+  float friction(float v) const;
+  float m_pos = 0.0f;
+  float m_vel = 0.0f;
+  float m_i   = 0.0f;
+  bool  m_stalled = false;
+};
@@ -0,0 +1,396 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <esp_cpu.h>
+#include <esp_heap_caps.h>
+#include <driver/pulse_cnt.h>
+#include <driver/ledc.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <random>
+#include "config.h"
+#include "sim_hal.h"
+#include "tasks.h"
+
+// ---------------- Estado del HAL ----------------
+static DoorModel    s_door;
+static uint64_t     s_nowUs = 0;
+static std::mt19937 s_rng(1);
+static bool         s_console = false;
+
+DoorModel& sim_door() { return s_door; }
+void       sim_seed(uint32_t seed) { s_rng.seed(seed); }
+uint64_t   sim_now_us() { return s_nowUs; }
+void       sim_set_console(bool on) { s_console = on; }
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+  if (s_console) fwrite(buf, 1, n, stdout);
+  return n;
+}
+
+// ---------------- Tiempo ----------------
+unsigned long millis() { return (unsigned long)(s_nowUs / 1000); }
+unsigned long micros() { return (unsigned long)s_nowUs; }
+int64_t esp_timer_get_time() { return (int64_t)s_nowUs; }
+void delay(uint32_t ms) { sim_advance_us(ms * 1000UL); }
+uint32_t getCpuFrequencyMhz() { return 240; }
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count() { return (esp_cpu_cycle_count_t)(s_nowUs * 240); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return (TaskHandle_t)&s_nowUs; }
+void vTaskDelete(TaskHandle_t) {}
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t) { *info = {}; }
+
+// ---------------- Sistema ----------------
+EspClass ESP;
+
+uint32_t esp_random() { return (uint32_t)s_rng(); }
+
+void EspClass::restart() {
+  fprintf(stderr, "ESP.restart()\n");
+  exit(2);
+}
+
+// ---------------- GPIO ----------------
+static uint8_t s_pinLevel[64];
+static void (*s_isr[64])(void);
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t val) { if (pin < 64) s_pinLevel[pin] = val ? HIGH : LOW; }
+
+int digitalRead(uint8_t pin) {
+  if (pin == HALL_DIR_PIN) {
+    // Nivel de dirección según el sentido real de giro
+    bool closing = s_door.vel() < 0.0f;
+#if HALL_DIR_ACTIVE_HIGH_CLOSE
+    return closing ? HIGH : LOW;
+#else
+    return closing ? LOW : HIGH;
+#endif
+  }
+  if (pin == BUTTON_PIN) return (BUTTON_ACTIVE_LVL == LOW) ? HIGH : LOW;   // sin pulsar
+  return (pin < 64) ? s_pinLevel[pin] : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int) { if (pin < 64) s_isr[pin] = isr; }
+void detachInterrupt(uint8_t pin) { if (pin < 64) s_isr[pin] = nullptr; }
+
+// ---------------- LEDC ----------------
+static uint8_t  s_ledcRes[64];
+static uint32_t s_ledcDuty[64];
+static ledc_channel_handle_t s_ledcBus[64];
+static uint8_t  s_ledcChanPin[2 * SOC_LEDC_CHANNEL_NUM];
+static uint8_t  s_ledcChannels = 0;
+
+// Fade hardware: interpolación lineal entre duty inicial y final
+struct LedcFade { uint32_t from, to; uint64_t t0Us; uint32_t durUs; };
+static LedcFade s_ledcFade[64];
+static uint32_t s_ledcWrites = 0, s_ledcFades = 0, s_ledcBlocked = 0;
+
+static bool ledc_fading(uint8_t pin) {
+  const LedcFade& f = s_ledcFade[pin];
+  return f.durUs != 0 && s_nowUs - f.t0Us < f.durUs;
+}
+
+bool ledcAttach(uint8_t pin, uint32_t, uint8_t res) {
+  if (pin >= 64 || s_ledcChannels >= sizeof(s_ledcChanPin)) return false;
+  s_ledcRes[pin] = res;
+  s_ledcDuty[pin] = 0;
+  s_ledcBus[pin] = { pin, s_ledcChannels, res };
+  s_ledcChanPin[s_ledcChannels++] = pin;
+  return true;
+}
+
+void* perimanGetPinBus(uint8_t pin, peripheral_bus_type_t type) {
+  if (pin >= 64 || type != ESP32_BUS_TYPE_LEDC || s_ledcRes[pin] == 0) return nullptr;
+  return &s_ledcBus[pin];
+}
+
+// En el equipo, ledcWrite() y ledcFade() esperan a que acabe el fade en
+// curso del canal; aquí vuelven enseguida y se cuentan
+bool ledcWrite(uint8_t pin, uint32_t duty) {
+  if (pin >= 64 || s_ledcRes[pin] == 0) return false;
+  if (ledc_fading(pin)) s_ledcBlocked++;
+  s_ledcDuty[pin] = duty;
+  s_ledcFade[pin].durUs = 0;
+  s_ledcWrites++;
+  return true;
+}
+
+bool ledcFade(uint8_t pin, uint32_t start, uint32_t target, int ms) {
+  if (pin >= 64 || s_ledcRes[pin] == 0 || ms < 0) return false;
+  if (ledc_fading(pin)) s_ledcBlocked++;
+  s_ledcFade[pin] = { start, target, s_nowUs, (uint32_t)(ms * 1000L) };
+  s_ledcDuty[pin] = start;
+  s_ledcFades++;
+  return true;
+}
+
+uint32_t ledcRead(uint8_t pin) {
+  if (pin >= 64) return 0;
+  const LedcFade& f = s_ledcFade[pin];
+  if (f.durUs == 0) return s_ledcDuty[pin];
+  uint64_t dt = s_nowUs - f.t0Us;
+  if (dt >= f.durUs) return f.to;
+  return (uint32_t)((int64_t)f.from + ((int64_t)f.to - (int64_t)f.from) * (int64_t)dt / (int64_t)f.durUs);
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t ch) {
+  unsigned c = (unsigned)mode * SOC_LEDC_CHANNEL_NUM + (unsigned)ch;
+  if (c >= s_ledcChannels) return ESP_ERR_INVALID_ARG;
+  uint8_t pin = s_ledcChanPin[c];
+  s_ledcDuty[pin] = ledcRead(pin);
+  s_ledcFade[pin].durUs = 0;
+  return ESP_OK;
+}
+
+uint32_t sim_ledc_writes() { return s_ledcWrites; }
+uint32_t sim_ledc_fades()  { return s_ledcFades; }
+uint32_t sim_ledc_blocked() { return s_ledcBlocked; }
+
+static float ledc_fraction(uint8_t pin) {
+  if (s_ledcRes[pin] == 0) return 0.0f;
+  return (float)ledcRead(pin) / (float)((1UL << s_ledcRes[pin]) - 1);
+}
+
+// El BTS7960 solo conduce con los dos enables altos
+float sim_duty_open()  { return (s_pinLevel[MOTOR_REN_PIN] && s_pinLevel[MOTOR_LEN_PIN]) ? ledc_fraction(MOTOR_RPWM_PIN) : 0.0f; }
+float sim_duty_close() { return (s_pinLevel[MOTOR_REN_PIN] && s_pinLevel[MOTOR_LEN_PIN]) ? ledc_fraction(MOTOR_LPWM_PIN) : 0.0f; }
+
+// ---------------- ADC continuo ----------------
+// Una trama = media de 'conversions' lecturas del ACS712; la media de la
+// corriente se integra durante la trama y el ruido se reduce con √N.
+// Las tramas esperan en un pool como el del driver: analogContinuousRead()
+// saca la más antigua y devuelve false (timeout) si no hay ninguna. Con el
+// pool lleno la trama nueva se pierde, pero el ISR de fin de trama salta igual.
+static bool     s_adcOn = false;
+static uint32_t s_adcConv = 1;
+static uint64_t s_adcFrameUs = 5000;
+static uint64_t s_adcNextUs = 0;
+static void   (*s_adcIsr)(void) = nullptr;
+static double   s_adcAccV = 0.0;
+static uint32_t s_adcAccN = 0;
+static uint8_t  s_adcPin = 0;
+static std::deque<adc_continuous_data_t> s_adcPool;
+static size_t   s_adcPoolFrames = SIM_ADC_POOL_FRAMES;
+static adc_continuous_data_t s_adcResult;
+static uint32_t s_adcReads = 0, s_adcEmptyReads = 0, s_adcOverflows = 0;
+static void   (*s_adcOnRead)(void) = nullptr;
+
+bool analogContinuous(const uint8_t pins[], size_t, uint32_t conv, uint32_t hz, void (*cb)(void)) {
+  s_adcConv = conv ? conv : 1;
+  s_adcFrameUs = hz ? (uint64_t)conv * 1000000ULL / hz : 5000;
+  s_adcIsr = cb;
+  s_adcPin = pins[0];
+  s_adcPool.clear();
+  return true;
+}
+
+bool analogContinuousStart() { s_adcOn = true; s_adcNextUs = s_nowUs + s_adcFrameUs; return true; }
+bool analogContinuousStop()  { s_adcOn = false; return true; }
+void analogContinuousSetAtten(adc_attenuation_t) {}
+void analogContinuousSetWidth(uint8_t) {}
+
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t) {
+  if (s_adcPool.empty()) { s_adcEmptyReads++; return false; }
+  s_adcResult = s_adcPool.front();
+  s_adcPool.pop_front();
+  *buffer = &s_adcResult;
+  s_adcReads++;
+  if (s_adcOnRead) {             // una sola vez: el ISR llega a mitad del vaciado
+    void (*cb)(void) = s_adcOnRead;
+    s_adcOnRead = nullptr;
+    cb();
+  }
+  return true;
+}
+
+static void adc_pool_push(int raw, int mv) {
+  adc_continuous_data_t d = {};
+  d.pin = s_adcPin;
+  d.avg_read_raw = raw;
+  d.avg_read_mvolts = mv;
+  if (s_adcPool.size() < s_adcPoolFrames) s_adcPool.push_back(d);
+  else                                    s_adcOverflows++;
+  if (s_adcIsr) s_adcIsr();
+}
+
+static void adc_frame_done() {
+  const DoorModelCfg& c = s_door.cfg;
+  float v = s_adcAccN ? (float)(s_adcAccV / s_adcAccN) : c.acsZeroV;
+  std::normal_distribution<float> noise(0.0f, c.noiseMv * 1e-3f / sqrtf((float)s_adcConv));
+  v += noise(s_rng);
+  int raw = (int)lroundf(v / c.dividerGain / c.vref * c.adcMax);
+  if (raw < 0) raw = 0;
+  if (raw > c.adcMax) raw = c.adcMax;
+  s_adcAccV = 0.0;
+  s_adcAccN = 0;
+  adc_pool_push(raw, (int)(v / c.dividerGain * 1000.0f));
+}
+
+void     sim_adc_set_pool(size_t frames)    { s_adcPoolFrames = frames ? frames : 1; }
+void     sim_adc_inject(int raw)            { adc_pool_push(raw, 0); }
+size_t   sim_adc_pending()                  { return s_adcPool.size(); }
+uint32_t sim_adc_reads()                    { return s_adcReads; }
+uint32_t sim_adc_empty_reads()              { return s_adcEmptyReads; }
+uint32_t sim_adc_overflows()                { return s_adcOverflows; }
+void     sim_adc_on_next_read(void (*cb)(void)) { s_adcOnRead = cb; }
+
+// ---------------- Caracterización eFuse ----------------
+static float (*s_adcCali)(int raw) = nullptr;
+
+void sim_adc_set_cali(float (*mvOfRaw)(int raw)) { s_adcCali = mvOfRaw; }
+
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t*, adc_cali_handle_t* out) {
+  *out = nullptr;
+  return s_adcCali ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t adc_cali_delete_scheme_curve_fitting(adc_cali_handle_t) { return ESP_OK; }
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t, int raw, int* mv) {
+  if (!s_adcCali) return ESP_FAIL;
+  *mv = (int)lroundf(s_adcCali(raw));   // el driver da mV enteros
+  return ESP_OK;
+}
+
+// ---------------- PCNT ----------------
+// La cuenta hardware es la posición del modelo; enc_write() de hall.cpp
+// lleva su propio offset, así que aquí no hace falta más.
+static long s_pcntZero = 0;
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t*, pcnt_unit_handle_t* out) { *out = (pcnt_unit_handle_t)&s_pcntZero; return ESP_OK; }
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t, const pcnt_glitch_filter_config_t*) { return ESP_OK; }
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t, const pcnt_chan_config_t*, pcnt_channel_handle_t* out) { *out = nullptr; return ESP_OK; }
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t, pcnt_channel_edge_action_t, pcnt_channel_edge_action_t) { return ESP_OK; }
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t, pcnt_channel_level_action_t, pcnt_channel_level_action_t) { return ESP_OK; }
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t, int) { return ESP_OK; }
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t) { return ESP_OK; }
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t) { s_pcntZero = s_door.counts(); return ESP_OK; }
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t) { return ESP_OK; }
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t, int* value) {
+  *value = (int)(s_door.counts() - s_pcntZero);
+  return ESP_OK;
+}
+
+// ---------------- NVS en memoria ----------------
+static std::vector<std::string> s_nvsNs;
+static std::map<std::string, std::vector<uint8_t>, std::less<>> s_nvs;   // "ns/clave" -> bytes
+
+// "ns/clave" en un buffer fijo: leer o reescribir una clave que ya existe no
+// reserva heap (net_alloc cuenta las reservas de la tarea de red)
+struct NvsKey { char s[48]; };
+static NvsKey nvs_key(nvs_handle_t h, const char* key) {
+  NvsKey k;
+  snprintf(k.s, sizeof(k.s), "%s/%s", s_nvsNs[h - 1].c_str(), key);
+  return k;
+}
+
+esp_err_t nvs_open(const char* ns, nvs_open_mode_t, nvs_handle_t* out) {
+  for (size_t i = 0; i < s_nvsNs.size(); ++i)
+    if (s_nvsNs[i] == ns) { *out = (nvs_handle_t)(i + 1); return ESP_OK; }
+  s_nvsNs.push_back(ns);
+  *out = (nvs_handle_t)s_nvsNs.size();
+  return ESP_OK;
+}
+
+void      nvs_close(nvs_handle_t) {}
+esp_err_t nvs_commit(nvs_handle_t) { return ESP_OK; }
+
+static esp_err_t nvs_get_raw(nvs_handle_t h, const char* key, void* out, size_t len) {
+  auto it = s_nvs.find(nvs_key(h, key).s);
+  if (it == s_nvs.end() || it->second.size() != len) return ESP_ERR_NVS_NOT_FOUND;
+  memcpy(out, it->second.data(), len);
+  return ESP_OK;
+}
+
+// En el equipo solo cfgstore escribe NVS, desde la tarea de red: una
+// escritura desde el lazo de control es un fallo y para la simulación
+static esp_err_t nvs_set_raw(nvs_handle_t h, const char* key, const void* buf, size_t len) {
+  if (!tasks_in_net_context()) {
+    fprintf(stderr, "NVS: escritura de %s fuera de la tarea de red\n", nvs_key(h, key).s);
+    abort();
+  }
+  const uint8_t* p = (const uint8_t*)buf;
+  NvsKey k = nvs_key(h, key);
+  auto it = s_nvs.find(k.s);
+  if (it == s_nvs.end()) it = s_nvs.emplace(k.s, std::vector<uint8_t>()).first;
+  it->second.assign(p, p + len);
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t h, const char* k, int32_t* v)  { return nvs_get_raw(h, k, v, sizeof(*v)); }
+esp_err_t nvs_get_u16(nvs_handle_t h, const char* k, uint16_t* v) { return nvs_get_raw(h, k, v, sizeof(*v)); }
+esp_err_t nvs_get_u8(nvs_handle_t h, const char* k, uint8_t* v)   { return nvs_get_raw(h, k, v, sizeof(*v)); }
+esp_err_t nvs_set_i32(nvs_handle_t h, const char* k, int32_t v)   { return nvs_set_raw(h, k, &v, sizeof(v)); }
+esp_err_t nvs_set_u16(nvs_handle_t h, const char* k, uint16_t v)  { return nvs_set_raw(h, k, &v, sizeof(v)); }
+esp_err_t nvs_set_u8(nvs_handle_t h, const char* k, uint8_t v)    { return nvs_set_raw(h, k, &v, sizeof(v)); }
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* k, const void* b, size_t n) { return nvs_set_raw(h, k, b, n); }
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* len) {
+  auto it = s_nvs.find(nvs_key(h, key).s);
+  if (it == s_nvs.end()) return ESP_ERR_NVS_NOT_FOUND;
+  if (out == nullptr) { *len = it->second.size(); return ESP_OK; }
+  if (*len < it->second.size()) return ESP_FAIL;
+  *len = it->second.size();
+  memcpy(out, it->second.data(), *len);
+  return ESP_OK;
+}
+
+bool Preferences::begin(const char* ns, bool) { m_open = (nvs_open(ns, NVS_READWRITE, &m_h) == ESP_OK); return m_open; }
+void Preferences::end() { m_open = false; }
+bool Preferences::remove(const char* key) {
+  if (!m_open) return false;
+  auto it = s_nvs.find(nvs_key(m_h, key).s);
+  if (it == s_nvs.end()) return false;
+  s_nvs.erase(it);
+  return true;
+}
+
+size_t Preferences::putBytes(const char* key, const void* buf, size_t len) {
+  return (m_open && nvs_set_blob(m_h, key, buf, len) == ESP_OK) ? len : 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  size_t len = 0;
+  return (m_open && nvs_get_blob(m_h, key, nullptr, &len) == ESP_OK) ? len : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  size_t len = maxLen;
+  return (m_open && nvs_get_blob(m_h, key, buf, &len) == ESP_OK) ? len : 0;
+}
+
+// ---------------- Avance del tiempo ----------------
+static long s_lastEdgeCount = 0;
+
+void sim_advance_us(uint32_t us) {
+  const float dt = SIM_PHYS_STEP_US * 1e-6f;
+  for (uint32_t t = 0; t < us; t += SIM_PHYS_STEP_US) {
+    s_nowUs += SIM_PHYS_STEP_US;
+    s_door.step(dt, sim_duty_open(), sim_duty_close());
+
+    // Backend ISR: un flanco de subida por cuenta
+    long c = s_door.counts();
+    void (*isr)(void) = s_isr[HALL_PULSE_PIN];
+    while (c != s_lastEdgeCount) {
+      s_lastEdgeCount += (c > s_lastEdgeCount) ? 1 : -1;
+      if (isr) isr();
+    }
+
+    if (s_adcOn) {
+      s_adcAccV += s_door.sensorV();
+      s_adcAccN++;
+      if (s_nowUs >= s_adcNextUs) {
+        s_adcNextUs += s_adcFrameUs;
+        adc_frame_done();
+      }
+    }
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+// =====================================================
+//   HAL de simulación: subconjunto de Arduino-ESP32 (core 3.x)
+// =====================================================
+// Lo justo para compilar los módulos de control en Linux. El tiempo es
+// virtual (lo avanza el simulador) y los pines, el PWM, el ADC y el contador
+// de pulsos están conectados al modelo físico de la puerta (door_model.h).
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+using std::min;
+using std::max;
+typedef uint8_t byte;
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+#define RISING        0x01
+#define FALLING       0x02
+#define CHANGE        0x03
+
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+// Tiempo virtual
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+uint32_t getCpuFrequencyMhz();
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// LEDC (API por pin del core 3.x)
+bool     ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution);
+bool     ledcWrite(uint8_t pin, uint32_t duty);
+bool     ledcFade(uint8_t pin, uint32_t start_duty, uint32_t target_duty, int max_fade_time_ms);
+uint32_t ledcRead(uint8_t pin);
+
+// Bus de cada pin (periman): para LEDC, el canal que le asignó ledcAttach
+// (canal global = grupo * SOC_LEDC_CHANNEL_NUM + canal del grupo)
+typedef enum { ESP32_BUS_TYPE_INIT, ESP32_BUS_TYPE_GPIO, ESP32_BUS_TYPE_LEDC } peripheral_bus_type_t;
+typedef struct {
+  uint8_t pin;
+  uint8_t channel;
+  uint8_t channel_resolution;
+} ledc_channel_handle_t;
+void* perimanGetPinBus(uint8_t pin, peripheral_bus_type_t type);
+
+// ADC continuo
+typedef enum { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db } adc_attenuation_t;
+typedef struct {
+  uint8_t  pin;
+  uint8_t  channel;
+  int      avg_read_raw;
+  int      avg_read_mvolts;
+} adc_continuous_data_t;
+bool analogContinuous(const uint8_t pins[], size_t pins_count, uint32_t conversions_per_pin,
+                      uint32_t sampling_freq_hz, void (*userFunc)(void));
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t timeout_ms);
+bool analogContinuousStart();
+bool analogContinuousStop();
+void analogContinuousSetAtten(adc_attenuation_t attenuation);
+void analogContinuousSetWidth(uint8_t width_bits);
+
+// Consola (solo lo que usa logx)
+class HardwareSerial {
+public:
+  void   begin(unsigned long) {}
+  size_t setTxBufferSize(size_t n) { return n; }
+  int    availableForWrite() { return 4096; }
+  size_t write(const uint8_t* buf, size_t n);
+  size_t write(uint8_t c) { return write(&c, 1); }
+};
+extern HardwareSerial Serial;
+
+// Sistema (lo que usa net.cpp)
+uint32_t esp_random();
+class EspClass {
+public:
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+  void     restart();
+};
+extern EspClass ESP;
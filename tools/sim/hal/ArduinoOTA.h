@@ -0,0 +1,37 @@
+#pragma once
+// =====================================================
+//   HAL de simulación: ArduinoOTA
+// =====================================================
+// Lo que usa ota_ctl.cpp. No hay servidor: begin() y handle() no hacen nada.
+#include <Arduino.h>
+#include <functional>
+
+typedef enum {
+  OTA_AUTH_ERROR,
+  OTA_BEGIN_ERROR,
+  OTA_CONNECT_ERROR,
+  OTA_RECEIVE_ERROR,
+  OTA_END_ERROR,
+} ota_error_t;
+
+class ArduinoOTAClass {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+  typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+  ArduinoOTAClass& setHostname(const char*) { return *this; }
+  ArduinoOTAClass& setPassword(const char*) { return *this; }
+  ArduinoOTAClass& onStart(THandlerFunction fn) { m_start = fn; return *this; }
+  ArduinoOTAClass& onEnd(THandlerFunction fn) { m_end = fn; return *this; }
+  ArduinoOTAClass& onProgress(THandlerFunction_Progress fn) { m_progress = fn; return *this; }
+  ArduinoOTAClass& onError(THandlerFunction_Error fn) { m_error = fn; return *this; }
+  void begin() {}
+  void handle() {}
+
+private:
+  THandlerFunction          m_start, m_end;
+  THandlerFunction_Progress m_progress;
+  THandlerFunction_Error    m_error;
+};
+extern ArduinoOTAClass ArduinoOTA;
@@ -0,0 +1,17 @@
+#pragma once
+// Preferences sobre la NVS en memoria del simulador (solo lo que se usa)
+#include <Arduino.h>
+#include "nvs.h"
+
+class Preferences {
+public:
+  bool   begin(const char* ns, bool readOnly = false);
+  void   end();
+  bool   remove(const char* key);
+  size_t putBytes(const char* key, const void* buf, size_t len);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t getBytesLength(const char* key);
+private:
+  nvs_handle_t m_h = 0;
+  bool         m_open = false;
+};
@@ -0,0 +1,58 @@
+#pragma once
+// =====================================================
+//   HAL de simulación: WiFi de Arduino-ESP32 (core 3.x)
+// =====================================================
+// Lo que usa net.cpp. No hay radio: la conexión la marca la prueba con
+// sim_wifi_set_up() (sim_hal.h), que entrega GOT_IP / DISCONNECTED al
+// manejador registrado con onEvent() como la tarea de eventos de Arduino.
+#include <Arduino.h>
+
+class IPAddress {
+public:
+  IPAddress() : m_v(0) {}
+  IPAddress(uint32_t v) : m_v(v) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : m_v((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  uint8_t operator[](int i) const { return (uint8_t)(m_v >> (8 * i)); }
+  operator uint32_t() const { return m_v; }
+private:
+  uint32_t m_v;
+};
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+} arduino_event_id_t;
+
+typedef union {
+  struct { uint8_t reason; } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef void (*WiFiEventFuncCb)(arduino_event_id_t event, arduino_event_info_t info);
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t) { return true; }
+  bool setSleep(bool) { return true; }
+  void persistent(bool) {}
+  bool setAutoReconnect(bool) { return true; }
+  int  onEvent(WiFiEventFuncCb cb);
+  int  begin(const char* ssid, const char* pass, int32_t channel = 0, const uint8_t* bssid = nullptr,
+             bool connect = true);
+  bool config(IPAddress ip, IPAddress gw, IPAddress mask, IPAddress dns = IPAddress()) {
+    (void)ip; (void)gw; (void)mask; (void)dns;
+    return true;
+  }
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+
+  IPAddress localIP();
+  IPAddress gatewayIP()  { return IPAddress(192, 168, 1, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP()      { return IPAddress(192, 168, 1, 1); }
+  uint8_t*  BSSID();
+  int32_t   channel()    { return 6; }
+};
+extern WiFiClass WiFi;
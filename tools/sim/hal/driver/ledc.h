@@ -0,0 +1,14 @@
+#pragma once
+// LEDC del IDF: solo la parada de un fade en curso (light.cpp)
+#include "esp_err.h"
+
+#define SOC_LEDC_CHANNEL_NUM 8
+
+typedef enum { LEDC_HIGH_SPEED_MODE, LEDC_LOW_SPEED_MODE, LEDC_SPEED_MODE_MAX } ledc_mode_t;
+typedef enum {
+  LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2, LEDC_CHANNEL_3,
+  LEDC_CHANNEL_4, LEDC_CHANNEL_5, LEDC_CHANNEL_6, LEDC_CHANNEL_7, LEDC_CHANNEL_MAX,
+} ledc_channel_t;
+
+// Deja el canal en el duty que tenga en ese momento
+esp_err_t ledc_fade_stop(ledc_mode_t speed_mode, ledc_channel_t channel);
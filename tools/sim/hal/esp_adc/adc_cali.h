@@ -0,0 +1,8 @@
+#pragma once
+// Caracterización eFuse simulada (ver adc_cali_scheme.h y sim_adc_set_cali)
+#include "esp_err.h"
+typedef struct adc_cali_scheme_t* adc_cali_handle_t;
+typedef int adc_atten_t;
+typedef enum { ADC_UNIT_1, ADC_UNIT_2 } adc_unit_t;
+typedef enum { ADC_BITWIDTH_12 = 12 } adc_bitwidth_t;
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t h, int raw, int* mv);
@@ -0,0 +1,16 @@
+#pragma once
+#include "adc_cali.h"
+// Curva eFuse simulada: solo existe si la prueba instala una curva de
+// referencia con sim_adc_set_cali(); si no, la creación falla como en un
+// chip sin caracterizar y current.cpp usa el modelo lineal nominal.
+#define ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED 1
+#define ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED  0
+
+typedef struct {
+  adc_unit_t     unit_id;
+  adc_atten_t    atten;
+  adc_bitwidth_t bitwidth;
+} adc_cali_curve_fitting_config_t;
+
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t* cfg, adc_cali_handle_t* out);
+esp_err_t adc_cali_delete_scheme_curve_fitting(adc_cali_handle_t h);
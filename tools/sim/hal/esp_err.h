@@ -0,0 +1,9 @@
+#pragma once
+#include <stdlib.h>
+typedef int esp_err_t;
+#define ESP_OK                 0
+#define ESP_FAIL              -1
+#define ESP_ERR_INVALID_ARG    0x102
+#define ESP_ERR_NOT_FOUND      0x105
+#define ESP_ERR_NVS_NOT_FOUND  0x1102
+#define ESP_ERROR_CHECK(x) do { esp_err_t e_ = (x); if (e_ != ESP_OK) abort(); } while (0)
@@ -0,0 +1,18 @@
+#pragma once
+// El simulador es de un solo hilo: las secciones críticas no hacen nada
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(m)      ((void)(m))
+#define portEXIT_CRITICAL(m)       ((void)(m))
+#define portENTER_CRITICAL_ISR(m)  ((void)(m))
+#define portEXIT_CRITICAL_ISR(m)   ((void)(m))
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTRUE  1
+#define pdFALSE 0
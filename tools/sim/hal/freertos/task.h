@@ -0,0 +1,7 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void         vTaskDelete(TaskHandle_t t);
@@ -0,0 +1,78 @@
+#pragma once
+// =====================================================
+//   HAL de simulación: cliente esp-mqtt de ESP-IDF 5
+// =====================================================
+// Lo que usa net.cpp. No hay broker: la prueba hace de tarea MQTT con las
+// funciones sim_broker_*() de sim_hal.h (conexión, cortes y mensajes
+// entrantes), que llaman al manejador registrado como lo haría esp-mqtt.
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t base, int32_t id, void* data);
+
+typedef enum {
+  MQTT_EVENT_ANY = -1,
+  MQTT_EVENT_ERROR = 0,
+  MQTT_EVENT_CONNECTED,
+  MQTT_EVENT_DISCONNECTED,
+  MQTT_EVENT_SUBSCRIBED,
+  MQTT_EVENT_UNSUBSCRIBED,
+  MQTT_EVENT_PUBLISHED,
+  MQTT_EVENT_DATA,
+  MQTT_EVENT_BEFORE_CONNECT,
+  MQTT_EVENT_DELETED,
+} esp_mqtt_event_id_t;
+
+typedef enum {
+  MQTT_TRANSPORT_UNKNOWN,
+  MQTT_TRANSPORT_OVER_TCP,
+  MQTT_TRANSPORT_OVER_SSL,
+} esp_mqtt_transport_t;
+
+typedef struct esp_mqtt_client* esp_mqtt_client_handle_t;
+
+typedef struct {
+  esp_mqtt_event_id_t      event_id;
+  esp_mqtt_client_handle_t client;
+  char*                    data;
+  int                      data_len;
+  int                      total_data_len;
+  int                      current_data_offset;
+  char*                    topic;
+  int                      topic_len;
+  int                      msg_id;
+} esp_mqtt_event_t;
+typedef esp_mqtt_event_t* esp_mqtt_event_handle_t;
+
+typedef struct {
+  struct {
+    struct {
+      const char*          hostname;
+      esp_mqtt_transport_t transport;
+      uint32_t             port;
+    } address;
+  } broker;
+  struct {
+    const char* username;
+    const char* client_id;
+    struct { const char* password; } authentication;
+  } credentials;
+  struct { int keepalive; } session;
+  struct {
+    int reconnect_timeout_ms;
+    int timeout_ms;
+  } network;
+  struct { int size; } buffer;
+  struct { uint64_t limit; } outbox;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* config);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void* arg);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char* topic, int qos);
+// -1 error, -2 outbox lleno; si no, id del mensaje (0 con QoS 0)
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char* topic, const char* data,
+                            int len, int qos, int retain, bool store);
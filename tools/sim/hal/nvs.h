@@ -0,0 +1,21 @@
+#pragma once
+// NVS en memoria: persiste durante la ejecución del simulador
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* out);
+void      nvs_close(nvs_handle_t h);
+esp_err_t nvs_commit(nvs_handle_t h);
+esp_err_t nvs_get_i32(nvs_handle_t h, const char* key, int32_t* out);
+esp_err_t nvs_get_u16(nvs_handle_t h, const char* key, uint16_t* out);
+esp_err_t nvs_get_u8(nvs_handle_t h, const char* key, uint8_t* out);
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* len);
+esp_err_t nvs_set_i32(nvs_handle_t h, const char* key, int32_t v);
+esp_err_t nvs_set_u16(nvs_handle_t h, const char* key, uint16_t v);
+esp_err_t nvs_set_u8(nvs_handle_t h, const char* key, uint8_t v);
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* buf, size_t len);
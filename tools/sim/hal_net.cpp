@@ -0,0 +1,207 @@
+// =====================================================
+//   WiFi, esp-mqtt y ArduinoOTA simulados (net.cpp real)
+// =====================================================
+// Sin radio ni broker: la prueba decide cuándo hay IP y conexión MQTT y
+// entrega los eventos a los manejadores que registró net.cpp, a mano
+// (sim_broker_connect) o con la conexión automática de sim_broker_task().
+// El outbox solo guarda el último payload de cada topic en tablas fijas,
+// para que el propio simulador no reserve heap en las rutas que se miden.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ArduinoOTA.h>
+#include <mqtt_client.h>
+#include "config.h"
+#include "secrets.h"
+#include "sim_hal.h"
+
+// Credenciales de prueba (en el equipo, secrets.cpp)
+const char*    ssid         = "sim";
+const char*    password     = "sim";
+const char*    ota_password = "sim";
+const char*    mqtt_host    = "127.0.0.1";
+const uint16_t mqtt_port    = 1883;
+const char*    mqtt_user    = "";
+const char*    mqtt_pass    = "";
+
+ArduinoOTAClass ArduinoOTA;
+
+// ---------------- WiFi ----------------
+WiFiClass WiFi;
+
+static WiFiEventFuncCb s_wifiCb = nullptr;
+static bool            s_wifiUp = false;
+static uint8_t         s_bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+int WiFiClass::onEvent(WiFiEventFuncCb cb) {
+  s_wifiCb = cb;
+  return 1;
+}
+
+int WiFiClass::begin(const char*, const char*, int32_t, const uint8_t*, bool) { return 0; }
+
+bool WiFiClass::disconnect(bool, bool) { return true; }
+
+IPAddress WiFiClass::localIP() { return s_wifiUp ? IPAddress(192, 168, 1, 50) : IPAddress(); }
+uint8_t*  WiFiClass::BSSID()   { return s_wifiUp ? s_bssid : nullptr; }
+
+void sim_wifi_set_up(bool up) {
+  if (up == s_wifiUp) return;
+  s_wifiUp = up;
+  if (!s_wifiCb) return;
+  arduino_event_info_t info = {};
+  if (up) {
+    s_wifiCb(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+  } else {
+    info.wifi_sta_disconnected.reason = 8;   // WIFI_REASON_ASSOC_LEAVE
+    s_wifiCb(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+  }
+}
+
+// ---------------- esp-mqtt ----------------
+struct esp_mqtt_client {
+  esp_event_handler_t handler;
+  void*               arg;
+  bool                started;
+  bool                connected;
+  uint32_t            reconnectMs;
+};
+static esp_mqtt_client s_client = {};
+
+// Conexión automática (sim_broker_task)
+static bool     s_auto = false;
+static uint32_t s_connectMs = 0;
+static bool     s_connecting = false;
+static uint64_t s_lockUntilUs = 0;   // fin del intento en curso (cerrojo tomado)
+static uint64_t s_nextTryUs = 0;
+static uint32_t s_waits = 0;
+
+struct OutboxSlot {
+  char    topic[48];
+  char    payload[256];   // truncado (las pruebas miran el principio)
+};
+static const size_t OUTBOX_SLOTS = 64;
+static OutboxSlot   s_outbox[OUTBOX_SLOTS];
+static size_t       s_outboxUsed = 0;
+static uint32_t     s_received = 0;
+static uint32_t     s_subscriptions = 0;
+
+static void dispatch(esp_mqtt_event_id_t id, esp_mqtt_event_t* ev) {
+  if (s_client.handler) s_client.handler(s_client.arg, "MQTT_EVENTS", (int32_t)id, ev);
+}
+
+// Llamada desde otra tarea: con un intento en curso espera al cerrojo
+static void take_lock() {
+  if (!s_connecting || sim_now_us() >= s_lockUntilUs) return;
+  s_waits++;
+  sim_advance_us((uint32_t)(s_lockUntilUs - sim_now_us()));
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* cfg) {
+  s_client = {};
+  s_client.reconnectMs = (uint32_t)cfg->network.reconnect_timeout_ms;
+  return &s_client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t,
+                                         esp_event_handler_t handler, void* arg) {
+  c->handler = handler;
+  c->arg = arg;
+  return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t c) {
+  c->started = true;   // conecta la tarea MQTT, no quien llama
+  s_nextTryUs = sim_now_us();
+  return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t, const char*, int) {
+  take_lock();
+  s_subscriptions++;
+  return 0;
+}
+
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t c, const char* topic, const char* data, int len,
+                            int, int, bool) {
+  if (!c->started) return -1;
+  take_lock();
+  OutboxSlot* slot = nullptr;
+  for (size_t i = 0; i < s_outboxUsed && !slot; ++i)
+    if (strcmp(s_outbox[i].topic, topic) == 0) slot = &s_outbox[i];
+  if (!slot && s_outboxUsed < OUTBOX_SLOTS) {
+    slot = &s_outbox[s_outboxUsed++];
+    strncpy(slot->topic, topic, sizeof(slot->topic) - 1);
+  }
+  if (slot) {
+    size_t n = std::min((size_t)len, sizeof(slot->payload) - 1);
+    memcpy(slot->payload, data, n);
+    slot->payload[n] = '\0';
+  }
+  s_received++;
+  return 0;
+}
+
+void sim_broker_connect() {
+  if (!s_client.started || s_client.connected) return;
+  s_client.connected = true;
+  esp_mqtt_event_t ev = {};
+  ev.event_id = MQTT_EVENT_CONNECTED;
+  ev.client = &s_client;
+  dispatch(MQTT_EVENT_CONNECTED, &ev);
+}
+
+void sim_broker_drop() {
+  if (!s_client.connected) return;
+  s_client.connected = false;
+  s_nextTryUs = sim_now_us() + s_client.reconnectMs * 1000ULL;
+  esp_mqtt_event_t ev = {};
+  ev.event_id = MQTT_EVENT_DISCONNECTED;
+  ev.client = &s_client;
+  dispatch(MQTT_EVENT_DISCONNECTED, &ev);
+}
+
+void sim_broker_send(const char* topic, const char* payload) {
+  if (!s_client.connected) return;
+  esp_mqtt_event_t ev = {};
+  ev.event_id = MQTT_EVENT_DATA;
+  ev.client = &s_client;
+  ev.topic = (char*)topic;
+  ev.topic_len = (int)strlen(topic);
+  ev.data = (char*)payload;
+  ev.data_len = ev.total_data_len = (int)strlen(payload);
+  dispatch(MQTT_EVENT_DATA, &ev);
+}
+
+void sim_broker_set_connect_ms(uint32_t connectMs) {
+  s_auto = true;
+  s_connectMs = connectMs;
+}
+
+void sim_broker_task() {
+  if (!s_auto || !s_client.started) return;
+  if (s_client.connected) {
+    if (!s_wifiUp) sim_broker_drop();   // sin IP el socket cae
+    return;
+  }
+  uint64_t now = sim_now_us();
+  if (!s_connecting) {
+    if (now < s_nextTryUs) return;
+    s_connecting = true;
+    s_lockUntilUs = now + s_connectMs * 1000ULL;
+  }
+  if (now < s_lockUntilUs) return;
+  s_connecting = false;
+  if (s_wifiUp) sim_broker_connect();
+  else          s_nextTryUs = now + s_client.reconnectMs * 1000ULL;   // falla el intento
+}
+
+bool     sim_broker_connecting() { return s_connecting; }
+uint32_t sim_broker_waits() { return s_waits; }
+uint32_t sim_broker_subscriptions() { return s_subscriptions; }
+uint32_t sim_broker_received() { return s_received; }
+
+const char* sim_broker_last(const char* topic) {
+  for (size_t i = 0; i < s_outboxUsed; ++i)
+    if (strcmp(s_outbox[i].topic, topic) == 0) return s_outbox[i].payload;
+  return "";
+}
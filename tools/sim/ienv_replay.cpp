@@ -0,0 +1,151 @@
+// =====================================================
+//   Reproducción de trazas sintéticas contra la envolvente (host)
+// =====================================================
+// Alimenta ienv_sample() con trazas de corriente por posición, al ritmo de
+// la guardia (params.currentCheckMs) y ya pasado el blanking, sin el resto
+// del firmware:
+//   - Trazas limpias: base + un punto duro por sentido (uno en la zona lenta,
+//     donde el límite global baja a x0.8) + ruido y ±10 % de rozamiento.
+//   - Obstáculos: desde una posición al azar la corriente sube OBST_A_PER_S.
+// Aprende LEARN_MOVES movimientos y después cuenta cortes en falso y
+// latencia de detección de la envolvente frente al límite global solo
+// (corriente > límite durante currentRequiredOver muestras seguidas).
+// Comprueba también que lo aprendido vuelve igual de NVS (cfgstore).
+// Sale con código 1 si la envolvente da algún corte en falso, se le escapa
+// algún obstáculo o no detecta antes que el límite global.
+//
+//   make -C tools/sim replay
+#include <Arduino.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "config.h"
+#include "params.h"
+#include "cfgstore.h"
+#include "hall.h"
+#include "ienv.h"
+#include "sim_stubs.h"
+
+static const uint32_t MOVE_MS      = 10000;   // recorrido completo
+static const int      LEARN_MOVES  = 10;      // por sentido
+static const int      CLEAN_MOVES  = 500;
+static const int      OBST_MOVES   = 300;
+static const float    OBST_A_PER_S = 15.0f;   // subida de corriente contra el obstáculo
+static const float    LIMIT_A      = 8.0f;    // límite global por defecto (current.cpp)
+
+static std::mt19937 s_rng(0x1e5);
+
+// Corriente limpia (A) en la fracción x de recorrido (0 = cerrada)
+static float clean_a(bool open, float x, float scale) {
+  float base = open ? 2.2f : 1.8f;
+  // Punto duro: abriendo a mitad; cerrando al final, dentro de la zona lenta
+  // y rozando su límite (x0.8 = 6,4 A)
+  float c = open ? 0.45f : 0.12f, w = 0.05f, h = open ? 3.0f : 5.0f;
+  float hump = h * expf(-(x - c) * (x - c) / (2 * w * w));
+  return scale * (base + hump);
+}
+
+struct Outcome {
+  bool     envTrip = false, limTrip = false;
+  uint32_t envMs = 0, limMs = 0;   // desde el inicio del obstáculo
+};
+
+// obstX < 0: sin obstáculo
+static Outcome replay(bool open, float obstX) {
+  std::normal_distribution<float> noise(0.0f, 0.15f);
+  std::uniform_real_distribution<float> scaleD(0.9f, 1.1f);
+  const float scale = scaleD(s_rng);
+  const EstadoPuerta e = open ? ABRIENDO : CERRANDO;
+  const long total = hall_open_pulses;
+  const uint32_t dt = params.currentCheckMs;
+  const float slowX = params.hallSlowPct / 100.0f;
+
+  Outcome o;
+  uint32_t limOver = 0, tObst = 0;
+  bool obstOn = false;
+  for (uint32_t t = params.currentBlankingMs; t < MOVE_MS; t += dt) {
+    float frac = (float)t / MOVE_MS;
+    float x = open ? frac : 1.0f - frac;
+    float a = clean_a(open, x, scale) + noise(s_rng);
+    if (obstX >= 0.0f && (open ? x >= obstX : x <= obstX)) {
+      if (!obstOn) { obstOn = true; tObst = t; }
+      a += OBST_A_PER_S * (t - tObst) * 0.001f;
+    }
+    int32_t mA = (int32_t)(a * 1000.0f);
+
+    if (!o.envTrip && ienv_sample((long)(x * total), e, mA)) {
+      o.envTrip = true;
+      o.envMs = obstOn ? t - tObst : 0;
+    }
+    bool slow = x <= slowX || x >= 1.0f - slowX;
+    float lim = LIMIT_A * (slow ? 0.8f : 1.0f);
+    limOver = (a > lim) ? limOver + 1 : 0;
+    if (!o.limTrip && limOver >= params.currentRequiredOver) {
+      o.limTrip = true;
+      o.limMs = obstOn ? t - tObst : 0;
+    }
+    if (o.envTrip && o.limTrip) break;
+  }
+  if (o.envTrip || o.limTrip) ienv_note_trip();
+  ienv_end_cycle(!o.envTrip && !o.limTrip);
+  return o;
+}
+
+static uint32_t median(std::vector<uint32_t> v) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[v.size() / 2];
+}
+
+int main() {
+  sim_set_context(SIM_CTX_BOOT);
+  cfg_begin();
+  params_begin();
+  hall_set_enabled(true);
+  ienv_begin();
+  sim_set_context(SIM_CTX_CONTROL);
+
+  for (int i = 0; i < LEARN_MOVES; ++i) {
+    replay(true, -1.0f);
+    replay(false, -1.0f);
+  }
+  const uint16_t learned = ienv_learned_buckets();
+
+  int envFalse = 0, limFalse = 0;
+  for (int i = 0; i < CLEAN_MOVES; ++i) {
+    Outcome o = replay(i % 2 == 0, -1.0f);
+    envFalse += o.envTrip;
+    limFalse += o.limTrip;
+  }
+
+  std::uniform_real_distribution<float> where(0.10f, 0.90f);
+  int envMiss = 0, limMiss = 0;
+  std::vector<uint32_t> envLat, limLat;
+  for (int i = 0; i < OBST_MOVES; ++i) {
+    Outcome o = replay(i % 2 == 0, where(s_rng));
+    if (o.envTrip) envLat.push_back(o.envMs); else envMiss++;
+    if (o.limTrip) limLat.push_back(o.limMs); else limMiss++;
+  }
+
+  // Persistencia: lo aprendido se escribe desde cfgstore y se relee igual
+  sim_set_context(SIM_CTX_NET);
+  cfg_flush_now();
+  sim_set_context(SIM_CTX_BOOT);
+  ienv_begin();
+  const uint16_t reloaded = ienv_learned_buckets();
+
+  uint32_t envMed = median(envLat), limMed = median(limLat);
+  printf("ienv_replay: %d mov. de aprendizaje, %d limpios, %d con obstáculo (%.0f A/s)\n",
+         2 * LEARN_MOVES, CLEAN_MOVES, OBST_MOVES, OBST_A_PER_S);
+  printf("  tramos aprendidos  %u/%u (tras recargar de NVS: %u)\n",
+         (unsigned)learned, (unsigned)(2 * IENV_BUCKETS), (unsigned)reloaded);
+  printf("  %-16s cortes en falso %3d  obstáculos sin detectar %3d  latencia mediana %4u ms\n",
+         "envolvente", envFalse, envMiss, (unsigned)envMed);
+  printf("  %-16s cortes en falso %3d  obstáculos sin detectar %3d  latencia mediana %4u ms\n",
+         "límite global", limFalse, limMiss, (unsigned)limMed);
+
+  bool ok = envFalse == 0 && envMiss == 0 && envMed < limMed &&
+            learned == 2 * IENV_BUCKETS && reloaded == learned;
+  puts(ok ? "  ok" : "  FALLO");
+  return ok ? 0 : 1;
+}
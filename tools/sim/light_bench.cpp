@@ -0,0 +1,181 @@
+// =====================================================
+//   Coste del motor de luz (host)
+// =====================================================
+// Compara, por actualización de la respiración:
+//   float/30ms: la anterior, sinf/fmodf de las dos tiras y un ledcWrite por
+//               tira cada 30 ms;
+//   tabla/fade: breathStep() de light.cpp, tablas Q8/Q16 y un segmento de
+//               fade hardware por tira cada RESP_SEG_MS.
+// Las dos filas llaman al HAL simulado igual (una operación LEDC por tira);
+// "us/s CPU" es el coste por actualización por las actualizaciones por
+// segundo de cada una. Aparte, "planif." es lo que cuesta una pasada de red
+// de sched_run() sin trabajo vencido, lo que la luz paga por ir en el
+// planificador en lugar de mirar millis() en cada pasada. Las cifras son del
+// host: sirven para comparar, no como tiempos del ESP32.
+//
+// Comprueba además que ningún cambio inmediato (light_on, respiración,
+// cambio de estado de la puerta, OFF y ON a mitad de un fade) escribe en un
+// canal con un fade en curso: en el equipo ledcWrite() esperaría a que
+// terminase el segmento. Sale con código 1 si alguno lo hace.
+//
+// Se incluye light.cpp para medir breathStep() directamente (light.o no se
+// enlaza en este binario).
+//
+//   make -C tools/sim bench
+#include "../../light.cpp"
+#include <chrono>
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+static const uint32_t UPDATES = 200000;
+static const uint32_t REF_MS  = 30;
+
+typedef std::chrono::steady_clock Clock;
+
+// ---- Referencia: respiración en coma flotante, una escritura cada 30 ms ----
+static float refBreath(float ph) {
+  float s = sinf(ph * 2.0f * (float)M_PI);
+  return 0.20f + 0.80f * ((s + 1.0f) * 0.5f);
+}
+
+__attribute__((noinline)) static void refUpdate(float& phase) {
+  phase += (float)REF_MS / (float)RESP_PERIOD_MS;
+  if (phase >= 1.0f) phase -= 1.0f;
+  ledcWrite(PINS[0], (uint32_t)(levelMax() * refBreath(phase)));
+  ledcWrite(PINS[PIN_COUNT - 1], (uint32_t)(levelMax() * refBreath(fmodf(phase + 0.5f, 1.0f))));
+}
+
+static double ns_since(Clock::time_point t0) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+static void row(const char* name, double nsPerUpdate, double updatesPerS) {
+  printf("  %-10s %7.1f ns/actualización  %6.1f act./s  %7.2f us/s CPU\n", name, nsPerUpdate,
+         updatesPerS, nsPerUpdate * updatesPerS / 1000.0);
+}
+
+static void bench() {
+  // Cada actualización, un tiempo virtual distinto (los fades terminan)
+  float phase = 0.0f;
+  double nsRef = 0;
+  for (uint32_t i = 0; i < UPDATES; ++i) {
+    sim_advance_us(REF_MS * 1000UL);
+    auto t0 = Clock::now();
+    refUpdate(phase);
+    nsRef += ns_since(t0);
+  }
+
+  double nsNew = 0;
+  for (uint32_t i = 0; i < UPDATES; ++i) {
+    sim_advance_us(RESP_SEG_MS * 1000UL);
+    uint32_t now = millis();
+    auto t0 = Clock::now();
+    breathStep(now);
+    nsNew += ns_since(t0);
+  }
+
+  // Pasadas de red sin trabajo vencido (la respiración sigue registrada),
+  // tras terminar el último segmento de la fila anterior
+  sim_advance_us(RESP_SEG_MS * 1000UL);
+  double nsSched = 0;
+  uint32_t idle = 0;
+  for (uint32_t i = 0; i < UPDATES; ++i) {
+    sim_advance_us(NET_TASK_DELAY_MS * 1000UL);
+    uint32_t now = millis();
+    uint32_t runs = s_jobBreath.runs;
+    auto t0 = Clock::now();
+    sched_run(SCHED_NET, now);
+    double ns = ns_since(t0);
+    if (s_jobBreath.runs == runs) { nsSched += ns; idle++; }
+  }
+
+  // Coste de medir
+  double nsEmpty = 0;
+  for (uint32_t i = 0; i < UPDATES; ++i) {
+    auto t0 = Clock::now();
+    nsEmpty += ns_since(t0);
+  }
+  const double base = nsEmpty / UPDATES;
+
+  printf("light_bench: %u actualizaciones por fila\n", (unsigned)UPDATES);
+  row("float/30ms", nsRef / UPDATES - base, 1000.0 / REF_MS);
+  row("tabla/fade", nsNew / UPDATES - base, 1000.0 / RESP_SEG_MS);
+  printf("  %-10s %7.1f ns/pasada de red sin trabajo vencido (%u pasadas/s)\n", "planif.",
+         nsSched / idle - base, (unsigned)(1000 / NET_TASK_DELAY_MS));
+}
+
+// ---- Cambios inmediatos con un fade en curso ----
+static void net_for(uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t += NET_TASK_DELAY_MS) {
+    sim_advance_us(NET_TASK_DELAY_MS * 1000UL);
+    uint32_t now = millis();
+    light_tick(now);
+    sched_run(SCHED_NET, now);
+  }
+}
+
+// El estado lo cambia la tarea de control
+static void set_estado(EstadoPuerta e) {
+  sim_set_context(SIM_CTX_CONTROL);
+  setEstado(e);
+  sim_set_context(SIM_CTX_NET);
+}
+
+// Hasta la mitad del segmento de respiración que acaba de empezar
+static void mid_segment() {
+  uint32_t runs = s_jobBreath.runs;
+  while (s_jobBreath.runs == runs) net_for(NET_TASK_DELAY_MS);
+  net_for(RESP_SEG_MS / 2);
+}
+
+static bool no_blocking() {
+  const uint32_t blocked0 = sim_ledc_blocked();
+  bool ok = true;
+  auto step = [&](const char* name, void (*fn)()) {
+    uint32_t b0 = sim_ledc_blocked();
+    fn();
+    bool pass = sim_ledc_blocked() == b0;
+    printf("  %-5s  %s\n", pass ? "ok" : "FALLO", name);
+    ok &= pass;
+  };
+
+  light_set_breath_mode(true);
+  mid_segment();
+  step("light_on con respiración en curso", [] { light_on(); });
+
+  light_set_breath_mode(true);
+  mid_segment();
+  step("respiración OFF a mitad de segmento", [] { light_set_breath_mode(false); });
+
+  light_set_breath_mode(true);
+  mid_segment();
+  step("puerta en marcha a mitad de segmento", [] { set_estado(ABRIENDO); light_tick(millis()); });
+  mid_segment();
+  step("puerta parada a mitad de segmento", [] { set_estado(DETENIDO); light_tick(millis()); });
+
+  light_off();
+  net_for(s_fadeSegMs / 2);
+  step("ON a mitad del fade de apagado", [] { light_on(); });
+  light_off();
+  net_for(s_fadeSegMs / 2);
+  step("OFF de nuevo a mitad del fade", [] { light_off(); });
+
+  // También los segmentos programados entre medias (trabajos del planificador)
+  uint32_t blocked = sim_ledc_blocked() - blocked0;
+  printf("  escrituras con fade en curso en total: %u\n", (unsigned)blocked);
+  return ok && blocked == 0;
+}
+
+int main() {
+  sim_set_context(SIM_CTX_BOOT);
+  cfg_begin();
+  params_begin();
+  light_begin();
+  light_set_breath_mode(true);
+  sim_set_context(SIM_CTX_NET);
+
+  bench();
+  bool ok = no_blocking();
+  puts(ok ? "  ok" : "  FALLO");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// =====================================================
+//   Salida MQTT del log con la cola de salida llena (host)
+// =====================================================
+// Sustituye la cola de salida MQTT por una que admite o rechaza cada
+// publicación y comprueba, en binario y en texto, que:
+//   - con la cola llena no se pierde nada: los registros esperan en el
+//     anillo y salen todos, en orden, cuando vuelve a admitir;
+//   - solo se cuentan descartes (dropMqtt) cuando el anillo pasa por encima
+//     del cursor MQTT, y lo que llega es justo lo más reciente.
+// Sale con código 1 si falla alguna.
+//
+//   make -C tools/sim log
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+#include "config.h"
+#include "logx.h"
+#include "sim_stubs.h"
+
+static int s_fails = 0;
+static uint32_t s_refused = 0;
+static std::vector<int32_t> s_got;   // número de cada línea recibida
+
+static void check(const char* name, bool ok) {
+  printf("  %-5s  %s\n", ok ? "ok" : "FALLO", name);
+  if (!ok) s_fails++;
+}
+
+static bool refuse(const char*, const uint8_t*, size_t) {
+  s_refused++;
+  return false;
+}
+
+// Lote binario: [nivel][long. args][id u32][ms u32][args]*; aquí args = un int
+static bool accept(const char* topic, const uint8_t* p, size_t len) {
+  if (strcmp(topic, TOPIC_LOG_BIN) == 0) {
+    for (size_t i = 0; i + 2 <= len; ) {
+      uint8_t alen = p[i + 1];
+      int32_t v = -1;
+      if (alen == 4) memcpy(&v, p + i + 10, 4);
+      s_got.push_back(v);
+      i += 2 + 8 + alen;
+    }
+  } else if (strcmp(topic, TOPIC_LOG) == 0) {
+    int v = -1;
+    sscanf((const char*)p, "linea %d", &v);
+    s_got.push_back(v);
+  }
+  return true;
+}
+
+static void net_pass() {
+  sim_set_context(SIM_CTX_NET);
+  logx_flush();
+  sim_set_context(SIM_CTX_DRIVER);
+}
+
+static uint32_t drops() {
+  LogStats st;
+  logx_get_stats(st);
+  return st.dropMqtt;
+}
+
+static void log_lines(int from, int n) {
+  for (int i = from; i < from + n; ++i) LOGI("linea %d\n", i);
+}
+
+// Todas las recibidas son from, from+1, ... sin huecos
+static bool in_order(int from) {
+  for (size_t i = 0; i < s_got.size(); ++i)
+    if (s_got[i] != from + (int)i) return false;
+  return true;
+}
+
+static void run(bool binary) {
+  printf(" %s\n", binary ? "binario" : "texto");
+  logx_set_mqtt_binary(binary);
+  sim_mqtt_connect(accept);
+  net_pass();                 // vacía lo anterior
+  s_got.clear();
+
+  {
+    uint32_t d0 = drops();
+    s_refused = 0;
+    sim_mqtt_connect(refuse);
+    log_lines(0, 20);
+    for (int i = 0; i < 10; ++i) net_pass();
+    sim_mqtt_connect(accept);
+    for (int i = 0; i < 10; ++i) net_pass();
+    check("cola llena: esperan en el anillo y salen todas en orden",
+          s_refused > 0 && s_got.size() == 20 && in_order(0) && drops() == d0);
+  }
+
+  {
+    // Más de lo que cabe en el anillo mientras la cola rechaza
+    const int N = 2 * LOG_RING_BYTES / 16;
+    s_got.clear();
+    uint32_t d0 = drops();
+    sim_mqtt_connect(refuse);
+    log_lines(1000, N);
+    net_pass();
+    uint32_t lost = drops() - d0;
+    sim_mqtt_connect(accept);
+    for (int i = 0; i < N; ++i) net_pass();
+    printf("    %d líneas, %u descartadas por el anillo, %u recibidas\n", N, (unsigned)lost,
+           (unsigned)s_got.size());
+    check("anillo lleno: descartes = lo que falta, llega lo más reciente",
+          lost > 0 && lost + s_got.size() == (size_t)N && in_order(1000 + (int)lost));
+  }
+  sim_mqtt_connect(nullptr);
+}
+
+int main() {
+  sim_set_context(SIM_CTX_DRIVER);
+  printf("log_sink: anillo de %u bytes, %d publicaciones por pasada\n", LOG_RING_BYTES, LOG_MQTT_BURST);
+  run(true);
+  run(false);
+  puts(s_fails ? "  FALLO" : "  ok");
+  return s_fails ? 1 : 0;
+}
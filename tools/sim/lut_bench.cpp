@@ -0,0 +1,151 @@
+// =====================================================
+//   Conversión raw → mA: tabla entera frente al camino float (host)
+// =====================================================
+// Coste: ns por conversión del camino anterior (float por trama, VREF
+// nominal y modelo lineal) frente a current_raw_to_mA() (tabla de 257
+// puntos, interpolación entera y escala Q24), con raw en Q8 como el que
+// sale del filtro. Las cifras son del host, con FPU rápida: sirven para
+// comparar; en el ESP32 la división float es una secuencia de instrucciones.
+//
+// Exactitud frente a una curva de referencia del ADC a 11 dB (offset abajo,
+// pendiente por debajo de la nominal y curvatura), en todo el rango útil:
+//   - tabla desde la caracterización eFuse (la propia curva, mV enteros);
+//   - tabla por placa desde CAL_POINTS puntos medidos (comando "adclut"),
+//     que además se guarda en NVS y se recarga igual;
+//   - modelo lineal nominal, solo como referencia de lo que se corrige.
+// Sale con código 1 si alguna tabla supera su error máximo.
+//
+//   make -C tools/sim lut
+#include <Arduino.h>
+#include <chrono>
+#include <math.h>
+#include "config.h"
+#include "cfgstore.h"
+#include "current.h"
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+void setup();   // puerta.ino
+
+static const float   SENS_MV_PER_A = 100.0f;   // ACS712-20A (current.cpp)
+static const float   DIVIDER       = 1.5f;
+static const float   ZERO_MV       = 2500.0f;  // offset nominal a la salida del sensor
+static const int     RAW_LO        = 100;      // rango comprobado (fuera, el ADC satura)
+static const int     RAW_HI        = 4000;
+static const int     CAL_POINTS    = 9;
+static const int32_t EFUSE_MAX_MA  = 10;       // medido: ~8 mA (mV enteros del driver = 7,5 mA)
+static const int32_t POINTS_MAX_MA = 20;       // medido: ~11 mA con 9 puntos
+
+typedef std::chrono::steady_clock Clock;
+
+// mV en el pin del ADC para un raw (referencia "verdadera" del chip)
+static float ref_mv(float r) {
+  return 142.0f + 0.76f * r - 6.0e-6f * r * r + 1.5e-9f * r * r * r;
+}
+
+static float ref_mv_int(int raw) { return ref_mv((float)raw); }
+
+// mA que corresponden de verdad a un raw en Q8
+static float ref_ma(uint32_t rawQ8) {
+  float sensorMv = ref_mv(rawQ8 / 256.0f) * DIVIDER;
+  return fabsf(sensorMv - ZERO_MV) / SENS_MV_PER_A * 1000.0f;
+}
+
+// Camino anterior: float en cada trama con el modelo lineal nominal
+__attribute__((noinline)) static float old_raw_to_A(float raw) {
+  float vAdc = (raw / 4095.0f) * 3.3f;
+  float delta = vAdc * DIVIDER - ZERO_MV * 0.001f;
+  return fabsf(delta / (SENS_MV_PER_A * 0.001f));
+}
+
+static volatile float   s_sinkF;
+static volatile int32_t s_sinkI;
+
+static void bench() {
+  const int REPS = 64;
+  uint32_t n = 0;
+
+  Clock::time_point t0 = Clock::now();
+  for (int k = 0; k < REPS; ++k)
+    for (uint32_t q = (uint32_t)RAW_LO << 8; q < ((uint32_t)RAW_HI << 8); q += 97, ++n)
+      s_sinkF = old_raw_to_A(q / 256.0f);
+  double oldNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / n;
+
+  t0 = Clock::now();
+  for (int k = 0; k < REPS; ++k)
+    for (uint32_t q = (uint32_t)RAW_LO << 8; q < ((uint32_t)RAW_HI << 8); q += 97)
+      s_sinkI = current_raw_to_mA(q);
+  double newNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / n;
+
+  printf("  %-16s %6.2f ns/conversión\n", "float (anterior)", oldNs);
+  printf("  %-16s %6.2f ns/conversión\n", "tabla entera", newNs);
+}
+
+struct ErrStats {
+  int32_t maxMa = 0;
+  int     atRaw = 0;
+  double  sumMa = 0.0;
+  int     n = 0;
+};
+
+// Error de la tabla en uso (o del modelo lineal) frente a la referencia,
+// en cada raw entero y en puntos intermedios
+static ErrStats measure(bool linear) {
+  ErrStats e;
+  for (uint32_t q = (uint32_t)RAW_LO << 8; q <= ((uint32_t)RAW_HI << 8); q += 64) {
+    float got = linear ? old_raw_to_A(q / 256.0f) * 1000.0f : (float)current_raw_to_mA(q);
+    int32_t err = (int32_t)lroundf(fabsf(got - ref_ma(q)));
+    if (err > e.maxMa) { e.maxMa = err; e.atRaw = (int)(q >> 8); }
+    e.sumMa += err;
+    e.n++;
+  }
+  return e;
+}
+
+static bool report(const char* name, const ErrStats& e, int32_t limit) {
+  bool ok = limit == 0 || e.maxMa <= limit;
+  printf("  %-16s error máx %5d mA (raw %4d)  medio %6.1f mA  %s\n", name, (int)e.maxMa, e.atRaw,
+         e.sumMa / e.n, limit ? (ok ? "ok" : "FALLO") : "");
+  return ok;
+}
+
+int main() {
+  sim_seed(1);
+  sim_adc_set_cali(ref_mv_int);
+  setup();
+  printf("lut_bench: tabla %s, raw %d..%d\n", current_lut_source(), RAW_LO, RAW_HI);
+
+  bool ok = strcmp(current_lut_source(), "efuse") == 0;
+  bench();
+  ok &= report("eFuse", measure(false), EFUSE_MAX_MA);
+  report("lineal nominal", measure(true), 0);
+
+  // Tabla por placa: CAL_POINTS lecturas con su tensión medida (0,1 mV)
+  uint16_t raw[CAL_POINTS];
+  float    mV[CAL_POINTS];
+  for (int k = 0; k < CAL_POINTS; ++k) {
+    raw[k] = (uint16_t)(k * 4095 / (CAL_POINTS - 1));
+    mV[k]  = roundf(ref_mv(raw[k]) * 10.0f) / 10.0f;
+  }
+  sim_set_context(SIM_CTX_NET);
+  ok &= current_lut_from_points(raw, mV, CAL_POINTS);
+  sim_run_control(millis());   // CMD_ADC_LUT
+  ErrStats pts = measure(false);
+  ok &= report("adclut 9 puntos", pts, POINTS_MAX_MA);
+
+  // Persistencia: cfgstore la escribe y al arrancar se carga igual
+  int32_t before[RAW_HI];
+  for (int r = 0; r < RAW_HI; ++r) before[r] = current_raw_to_mA((uint32_t)r << 8);
+  sim_set_context(SIM_CTX_NET);
+  cfg_flush_now();
+  sim_adc_set_cali(nullptr);
+  sim_set_context(SIM_CTX_BOOT);
+  current_begin();
+  bool same = strcmp(current_lut_source(), "nvs") == 0;
+  for (int r = 0; r < RAW_HI && same; ++r) same = current_raw_to_mA((uint32_t)r << 8) == before[r];
+  printf("  recargada de NVS: %s\n", same ? "igual" : "DISTINTA");
+  ok &= same;
+
+  puts(ok ? "  ok" : "  FALLO");
+  return ok ? 0 : 1;
+}
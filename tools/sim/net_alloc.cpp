@@ -0,0 +1,297 @@
+// =====================================================
+//   Publicaciones de la red sin reservas de heap (host)
+// =====================================================
+// En el equipo, heapmon solo cuenta reservas con los hooks de heap de
+// ESP-IDF (CONFIG_HEAP_USE_HOOKS); sin ellos garage/sys/heap da "allocs"
+// -1. Esta prueba no depende de eso: compila el net.cpp real (con pubq.cpp
+// y ota_ctl.cpp) contra hal_net.cpp y sustituye malloc/calloc/realloc y
+// operator new del programa por versiones que cuentan. Con Wi-Fi y MQTT
+// conectados, cuenta las reservas en:
+//   - handleCmd("status"), directo y llegando por MQTT;
+//   - telemSignals() en marcha y al parar, y el resto de la telemetría;
+//   - la publicación del estado (setEstado → state_ui_tick);
+//   - una parada de seguridad (motor sin corriente), con su log y su estado;
+//   - las de OTA (ON, OFF y fin de la ventana);
+//   - un ciclo abrir/cerrar completo de las dos tareas con comandos MQTT.
+// Cada caso incluye el envío al outbox (pubq_flush). El avance del tiempo
+// virtual y el modelo de la puerta (sim_advance_us) quedan fuera de la
+// cuenta: son el simulador, no el firmware (la NVS simulada reserva al
+// crear una clave; el ciclo se cuenta tras uno de calentamiento). Sale con código 1 si alguna
+// ruta reserva o si el contador no ve una reserva hecha a propósito.
+//
+// Se incluye net.cpp para llamar a sus funciones internas.
+//
+//   make -C tools/sim alloc
+#include "../../net.cpp"
+#include <new>
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+void setup();   // puerta.ino
+
+// ---- Contador de reservas (todo el programa) ----
+static bool     s_counting = false;
+static uint32_t s_allocs = 0;
+
+extern "C" {
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t n, size_t m);
+void* __libc_realloc(void* p, size_t n);
+
+void* malloc(size_t n) noexcept {
+  if (s_counting) s_allocs++;
+  return __libc_malloc(n);
+}
+void* calloc(size_t n, size_t m) noexcept {
+  if (s_counting) s_allocs++;
+  return __libc_calloc(n, m);
+}
+void* realloc(void* p, size_t n) noexcept {
+  if (s_counting) s_allocs++;
+  return __libc_realloc(p, n);
+}
+}
+
+void* operator new(size_t n) {
+  if (s_counting) s_allocs++;
+  void* p = __libc_malloc(n);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+
+// Reservas desde el constructor hasta stop()
+struct AllocCount {
+  uint32_t n0;
+  AllocCount() : n0(s_allocs) { s_counting = true; }
+  uint32_t stop() { s_counting = false; return s_allocs - n0; }
+};
+
+static int s_fails = 0;
+
+static void check(const char* name, uint32_t allocs, bool ok = true) {
+  ok = ok && allocs == 0;
+  printf("  %-5s  %-50s %u reservas\n", ok ? "ok" : "FALLO", name, (unsigned)allocs);
+  if (!ok) s_fails++;
+}
+
+// ---- Tiempo: las dos tareas con sus periodos ----
+static bool s_armed = false;   // contar en los pasos de las tareas
+
+static void tick_1ms() {
+  sim_advance_us(1000);        // simulador: fuera de la cuenta
+  uint32_t now = millis();
+  s_counting = s_armed;
+  if (now % CONTROL_PERIOD_MS == 0) sim_run_control(now);
+  if (now % NET_TASK_DELAY_MS == 0) sim_run_net(now);
+  s_counting = false;
+}
+
+static void run_ms(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; ++i) tick_1ms();
+}
+
+static uint32_t run_counted_ms(uint32_t ms) {
+  uint32_t n0 = s_allocs;
+  s_armed = true;
+  run_ms(ms);
+  s_armed = false;
+  return s_allocs - n0;
+}
+
+static void post_estado(EstadoPuerta e) {
+  tasks_post_cmd(CMD_SET_ESTADO, e);
+}
+
+// Pasada de red fuera del planificador (dispatch de entradas y envío)
+static void net_pass() {
+  sim_set_context(SIM_CTX_NET);
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+}
+
+static uint32_t signal_pubs() {
+  uint32_t n = 0;
+  for (uint8_t i = 0; i < SIGNAL_COUNT; ++i) n += s_sig[i].pubs;
+  return n;
+}
+
+// ---- Casos ----
+static void case_counter() {
+  static void* volatile p;
+  AllocCount c;
+  p = malloc(64);
+  uint32_t n = c.stop();
+  free(p);
+  bool ok = n == 1;
+  printf("  %-5s  %-50s %u reservas\n", ok ? "ok" : "FALLO", "el contador ve una reserva", (unsigned)n);
+  if (!ok) s_fails++;
+}
+
+static void case_status() {
+  static const char CMD[] = "status";
+  uint32_t r0 = sim_broker_received();
+  AllocCount c;
+  sim_set_context(SIM_CTX_NET);
+  handleCmd(MsgView(CMD, sizeof(CMD) - 1));
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  uint32_t n = c.stop();
+  check("handleCmd(\"status\") y envío", n,
+        sim_broker_received() > r0 && strstr(sim_broker_last(TOPIC_INFO), "\"wifi\":\"ON\"") != nullptr);
+
+  r0 = sim_broker_received();
+  AllocCount c2;
+  sim_broker_send(TOPIC_CMD, "status");   // tarea MQTT: a la cola de entrada
+  net_pass();                             // manejador y envío
+  n = c2.stop();
+  check("\"status\" por MQTT (entrada, manejador, envío)", n, sim_broker_received() > r0);
+}
+
+static void case_signals() {
+  post_estado(ABRIENDO);
+  run_ms(500);
+  uint32_t p0 = signal_pubs();
+  for (uint8_t i = 0; i < SIGNAL_COUNT; ++i) s_sig[i].sent = false;   // todas vencidas
+  AllocCount c;
+  sim_set_context(SIM_CTX_NET);
+  telemSignals(millis());
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  uint32_t n = c.stop();
+  check("telemSignals en marcha (4 señales) y envío", n, signal_pubs() == p0 + SIGNAL_COUNT);
+
+  post_estado(DETENIDO);
+  run_ms(2 * CONTROL_PERIOD_MS);   // la instantánea ya dice DETENIDO
+  s_sigWasMoving = true;
+  p0 = signal_pubs();
+  AllocCount c2;
+  sim_set_context(SIM_CTX_NET);
+  telemSignals(millis());
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  n = c2.stop();
+  check("telemSignals al parar y envío", n, signal_pubs() == p0 + SIGNAL_COUNT);
+}
+
+static void case_telemetry() {
+  uint32_t r0 = sim_broker_received();
+  AllocCount c;
+  sim_set_context(SIM_CTX_NET);
+  uint32_t now = millis();
+  telemIoffset(now);
+  telemCtl(now);
+  telemProf(now);
+  telemSched(now);
+  telemSys(now);
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  uint32_t n = c.stop();
+  check("ioffset, ctl, prof, sched, sys y envío", n,
+        sim_broker_received() >= r0 + 10 && strstr(sim_broker_last(TOPIC_NET_STATS), "tick_max_us"));
+}
+
+static void case_state() {
+  AllocCount c;
+  sim_set_context(SIM_CTX_CONTROL);
+  setEstado(CERRANDO);
+  sim_set_context(SIM_CTX_NET);
+  state_ui_tick();
+  net_tick();
+  sim_set_context(SIM_CTX_CONTROL);
+  setEstado(DETENIDO);
+  sim_set_context(SIM_CTX_NET);
+  state_ui_tick();
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  uint32_t n = c.stop();
+  check("estado (setEstado → state_ui_tick) y envío", n,
+        strcmp(sim_broker_last(TOPIC_STATE), "DETENIDO") == 0);
+}
+
+static void case_safety() {
+  // Cable del motor suelto: en marcha sin corriente → parada de seguridad
+  DoorModel& door = sim_door();
+  float r = door.cfg.rOhm;
+  door.cfg.rOhm = 1e6f;
+  post_estado(ABRIENDO);
+  uint32_t n = run_counted_ms(params.safetyZeroIMs + 1000);
+  bool tripped = getEstado() == DETENIDO && strcmp(sim_broker_last(TOPIC_STATE), "DETENIDO") == 0;
+  door.cfg.rOhm = r;
+  run_ms(500);
+  check("parada de seguridad (log, estado, luz) y envío", n, tripped);
+}
+
+static void case_ota() {
+  AllocCount c;
+  sim_set_context(SIM_CTX_NET);
+  ota_enable_for(10);   // ya estaba ON (ventana del arranque): solo publica
+  ota_disable();
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  uint32_t n = c.stop();
+  bool off = strcmp(sim_broker_last(TOPIC_OTA), "OFF") == 0;
+
+  sim_set_context(SIM_CTX_NET);
+  ota_enable_for(1);    // prepara ArduinoOTA otra vez: fuera de la cuenta
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  bool on = strcmp(sim_broker_last(TOPIC_OTA), "ON") == 0;
+  sim_advance_us(61UL * 1000000UL);
+  AllocCount c2;
+  sim_set_context(SIM_CTX_NET);
+  ota_tick();           // fin de la ventana → OFF
+  net_tick();
+  sim_set_context(SIM_CTX_DRIVER);
+  n += c2.stop();
+  check("OTA: ON, OFF, fin de la ventana y envío", n,
+        off && on && strcmp(sim_broker_last(TOPIC_OTA), "OFF") == 0);
+}
+
+// Abrir y cerrar con comandos MQTT a mitad de cada movimiento
+static uint32_t cycle(bool counted) {
+  uint32_t n = 0;
+  for (EstadoPuerta e : { ABRIENDO, CERRANDO }) {
+    post_estado(e);
+    n += counted ? run_counted_ms(1000) : (run_ms(1000), 0);
+    AllocCount c;
+    sim_broker_send(TOPIC_LIGHT_CMD, "ON");
+    sim_broker_send(TOPIC_SPEED_CMD, e == ABRIENDO ? "80" : "100");
+    sim_broker_send(TOPIC_CMD, "status");
+    uint32_t k = c.stop();
+    n += counted ? k : 0;
+    n += counted ? run_counted_ms(29000) : (run_ms(29000), 0);
+  }
+  return n;
+}
+
+static void case_cycle() {
+  // La NVS simulada reserva al crear cada clave: un ciclo antes sin contar
+  cycle(false);
+  uint32_t r0 = sim_broker_received();
+  uint32_t n = cycle(true);
+  check("ciclo abrir/cerrar con comandos MQTT", n,
+        getEstado() == DETENIDO && sim_broker_received() > r0);
+}
+
+int main() {
+  sim_set_context(SIM_CTX_BOOT);
+  setup();
+  sim_wifi_set_up(true);
+  run_ms(100);                 // IP → arranca el cliente MQTT
+  sim_broker_connect();
+  run_ms(2000);                // retenidos, log pendiente, primeras señales
+
+  printf("net_alloc: net.cpp real, Wi-Fi y MQTT conectados (%u suscripciones)\n",
+         (unsigned)sim_broker_subscriptions());
+  case_counter();
+  case_status();
+  case_signals();
+  case_telemetry();
+  case_state();
+  case_safety();
+  case_ota();
+  case_cycle();
+  puts(s_fails ? "  FALLO" : "  ok");
+  return s_fails ? 1 : 0;
+}
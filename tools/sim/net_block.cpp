@@ -0,0 +1,128 @@
+// =====================================================
+//   net_tick() con un broker lento (host)
+// =====================================================
+// Versión automática de tools/mqtt_standin.py --connect-delay: compila el
+// net.cpp real contra hal_net.cpp, cuya tarea MQTT simulada tiene tomado el
+// cerrojo del cliente durante cada intento de conexión (DNS, TCP y un
+// CONNACK que tarda CONNECT_MS), como esp-mqtt. Si la tarea de red llamase
+// al cliente en ese intervalo, esperaría y net_tick() duraría lo que falte
+// de conexión. Con las dos tareas en marcha, la puerta moviéndose y
+// comandos MQTT entrando, comprueba que el peor net_tick() (s_tickMaxEverUs,
+// el tick_max_ever_us de garage/sys/net) no pasa de TICK_MAX_US en:
+//   - el arranque con el CONNACK retrasado;
+//   - un corte y la reconexión lenta;
+//   - el Wi-Fi perdido y recuperado a mitad de un intento.
+// Comprueba además que la medida ve un bloqueo: con net_mqtt_connected()
+// aún a true durante un intento (el DISCONNECTED todavía no ha llegado), el
+// envío de la cola espera al cerrojo. El tiempo es virtual: fuera de las
+// esperas, net_tick() dura 0 us. Sale con código 1 si falla alguna.
+//
+// Se incluye net.cpp para leer y reiniciar su medida.
+//
+//   make -C tools/sim block
+#include "../../net.cpp"
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+void setup();   // puerta.ino
+
+static const uint32_t CONNECT_MS  = 1500;    // como --connect-delay 1.5
+static const uint32_t SLOW_MS     = 4000;    // reconexión con el broker aún más lento
+static const uint32_t TICK_MAX_US = 20000;   // como --max-tick-us 20000
+
+static int s_fails = 0;
+
+static void check(const char* name, bool ok) {
+  printf("  %-5s  %-46s peor net_tick %6u us  esperas %u\n", ok ? "ok" : "FALLO", name,
+         (unsigned)s_tickMaxEverUs, (unsigned)sim_broker_waits());
+  if (!ok) s_fails++;
+}
+
+static void reset_tick_max() {
+  s_tickMaxUs = 0;
+  s_tickMaxEverUs = 0;
+}
+
+// Un milisegundo: tarea MQTT y las dos tareas del firmware con sus periodos
+static void tick_1ms() {
+  sim_advance_us(1000);
+  sim_broker_task();
+  uint32_t now = millis();
+  if (now % CONTROL_PERIOD_MS == 0) sim_run_control(now);
+  if (now % NET_TASK_DELAY_MS == 0) sim_run_net(now);
+}
+
+static void run_ms(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; ++i) tick_1ms();
+}
+
+// Movimiento con comandos entrando (si hay conexión) y publicaciones saliendo
+static void busy_ms(uint32_t ms, EstadoPuerta e) {
+  tasks_post_cmd(CMD_SET_ESTADO, e);
+  for (uint32_t t = 0; t < ms; t += 250) {
+    run_ms(250);
+    sim_broker_send(TOPIC_LIGHT_CMD, (t / 250) % 2 ? "ON" : "OFF");
+    sim_broker_send(TOPIC_CMD, "status");
+  }
+}
+
+// Hasta que la tarea MQTT empiece un intento de conexión
+static void until_connecting() {
+  for (uint32_t i = 0; i < 60000 && !sim_broker_connecting(); ++i) tick_1ms();
+}
+
+int main() {
+  sim_set_context(SIM_CTX_BOOT);
+  setup();
+  sim_broker_set_connect_ms(CONNECT_MS);
+
+  printf("net_block: CONNACK a %u ms (%u ms al reconectar), reintento cada %u ms, límite %u us\n",
+         (unsigned)CONNECT_MS, (unsigned)SLOW_MS, (unsigned)MQTT_RECONNECT_MS, (unsigned)TICK_MAX_US);
+
+  {
+    sim_wifi_set_up(true);
+    busy_ms(CONNECT_MS + 1000, ABRIENDO);
+    check("arranque con el CONNACK retrasado",
+          net_mqtt_connected() && s_tickMaxEverUs <= TICK_MAX_US && sim_broker_waits() == 0);
+    busy_ms(3000, DETENIDO);
+  }
+
+  {
+    reset_tick_max();
+    uint32_t c0 = s_mqttConnects;
+    sim_broker_set_connect_ms(SLOW_MS);
+    sim_broker_drop();
+    busy_ms(MQTT_RECONNECT_MS + SLOW_MS + 1000, CERRANDO);
+    check("corte y reconexión lenta",
+          net_mqtt_connected() && s_mqttConnects == c0 + 1 && s_tickMaxEverUs <= TICK_MAX_US &&
+          sim_broker_waits() == 0);
+  }
+
+  {
+    reset_tick_max();
+    sim_broker_drop();
+    until_connecting();
+    sim_wifi_set_up(false);          // el intento falla sin IP
+    busy_ms(SLOW_MS, ABRIENDO);
+    sim_wifi_set_up(true);
+    busy_ms(2 * (MQTT_RECONNECT_MS + SLOW_MS), DETENIDO);
+    check("Wi-Fi perdido a mitad de un intento",
+          net_mqtt_connected() && s_tickMaxEverUs <= TICK_MAX_US && sim_broker_waits() == 0);
+  }
+
+  {
+    // Control: el firmware cree que sigue conectado durante el intento
+    reset_tick_max();
+    uint32_t w0 = sim_broker_waits();
+    sim_broker_drop();
+    until_connecting();
+    s_mqttUp = true;
+    busy_ms(500, CERRANDO);
+    bool seen = sim_broker_waits() > w0 && s_tickMaxEverUs > TICK_MAX_US;
+    check("control: la medida ve la espera al cerrojo", seen);
+    run_ms(MQTT_RECONNECT_MS + SLOW_MS);
+  }
+
+  puts(s_fails ? "  FALLO" : "  ok");
+  return s_fails ? 1 : 0;
+}
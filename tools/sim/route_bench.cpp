@@ -0,0 +1,164 @@
+// =====================================================
+//   Coste de despacho de mensajes MQTT entrantes (host)
+// =====================================================
+// Compara, por mensaje, el callback anterior con el actual:
+//   antes: copia del topic y del payload (byte a byte) a cadenas con heap,
+//          trim y una cadena de comparaciones "t == TOPIC_..." en el orden
+//          del if/else original;
+//   ahora: findRoute() sobre una tabla como ROUTES de net.cpp (routes.h,
+//          mismos topics) y el payload leído en sitio con MsgView.
+// Cada fila recorre todos los topics de entrada con un payload típico. Los
+// ecos de TOPIC_ILIMIT y TOPIC_SPEED (retained propios) antes se suscribían
+// y recorrían la cadena entera; ahora no llegan, pero se mide igualmente lo
+// que costaría descartarlos. std::string hace de String de Arduino: con
+// payloads cortos no reserva heap, así que "antes" sale favorecido. Las
+// cifras son del host: sirven para comparar, no como tiempos del ESP32.
+// Comprueba además que cada topic llega a su manejador y que los prefijos y
+// extensiones de un topic no encajan. Sale con código 1 si falla.
+//
+//   make -C tools/sim route
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+#include "config.h"
+#include "msgbuf.h"
+#include "routes.h"
+
+static const int REPS = 200000;
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile uint32_t s_sink;
+static int s_hit = -1;   // índice del manejador llamado (comprobación)
+
+#define H(i) [](MsgView m) { s_hit = i; s_sink += (uint32_t)m.n; }
+
+static constexpr auto ROUTES = sortRoutes(std::array<TopicRoute, 14>{{
+  ROUTE(TOPIC_CMD,              H(0)),
+  ROUTE(TOPIC_OPEN_CMD,         H(1)),
+  ROUTE(TOPIC_CLOSE_CMD,        H(2)),
+  ROUTE(TOPIC_GOTO_CMD,         H(3)),
+  ROUTE(TOPIC_ILIMIT_CMD,       H(4)),
+  ROUTE(TOPIC_SPEED_CMD,        H(5)),
+  ROUTE(TOPIC_MARK_CLOSED_CMD,  H(6)),
+  ROUTE(TOPIC_MARK_OPEN_CMD,    H(7)),
+  ROUTE(TOPIC_HALL_EN_CMD,      H(8)),
+  ROUTE(TOPIC_LIGHT_CMD,        H(9)),
+  ROUTE(TOPIC_LIGHT_DIM_CMD,    H(10)),
+  ROUTE(TOPIC_LIGHT_BREATH_CMD, H(11)),
+  ROUTE(TOPIC_PARAM_GET,        H(12)),
+  ROUTE(TOPIC_PARAM_SET,        H(13)),
+}});
+static_assert(routesUnique(ROUTES), "Colisión de hash entre topics de ROUTES");
+
+struct Msg {
+  const char* topic;
+  const char* payload;
+  int         handler;   // índice esperado; -1 = no es de entrada
+};
+
+static const Msg MSGS[] = {
+  { TOPIC_CMD,              "status",              0 },
+  { TOPIC_OPEN_CMD,         "ON",                  1 },
+  { TOPIC_CLOSE_CMD,        "ON",                  2 },
+  { TOPIC_GOTO_CMD,         "55",                  3 },
+  { TOPIC_ILIMIT_CMD,       "8.50",                4 },
+  { TOPIC_SPEED_CMD,        "80",                  5 },
+  { TOPIC_MARK_CLOSED_CMD,  "ON",                  6 },
+  { TOPIC_MARK_OPEN_CMD,    "ON",                  7 },
+  { TOPIC_HALL_EN_CMD,      "ON",                  8 },
+  { TOPIC_LIGHT_CMD,        "OFF",                 9 },
+  { TOPIC_LIGHT_DIM_CMD,    "40",                 10 },
+  { TOPIC_LIGHT_BREATH_CMD, "ON",                 11 },
+  { TOPIC_PARAM_GET,        "",                   12 },
+  { TOPIC_PARAM_SET,        "motor.kp=0.80",      13 },
+};
+static const Msg ECHOES[] = {
+  { TOPIC_ILIMIT, "8.50", -1 },
+  { TOPIC_SPEED,  "80",   -1 },
+};
+
+// ---- Antes: copias a cadenas y cadena de comparaciones ----
+static void trim(std::string& s) {
+  size_t a = s.find_first_not_of(" \t\r\n");
+  size_t b = s.find_last_not_of(" \t\r\n");
+  s = (a == std::string::npos) ? std::string() : s.substr(a, b - a + 1);
+}
+
+__attribute__((noinline)) static void old_dispatch(const char* topic, const uint8_t* payload, size_t len) {
+  std::string t(topic);
+  std::string msg;
+  msg.reserve(len);
+  for (size_t i = 0; i < len; i++)
+    msg += (char)payload[i];
+  trim(msg);
+
+  int h = -1;
+  if      (t == TOPIC_CMD)              h = 0;
+  else if (t == TOPIC_OPEN_CMD)         h = 1;
+  else if (t == TOPIC_CLOSE_CMD)        h = 2;
+  else if (t == TOPIC_GOTO_CMD)         h = 3;
+  else if (t == TOPIC_ILIMIT_CMD)       h = 4;
+  else if (t == TOPIC_SPEED_CMD)        h = 5;
+  else if (t == TOPIC_MARK_CLOSED_CMD)  h = 6;
+  else if (t == TOPIC_MARK_OPEN_CMD)    h = 7;
+  else if (t == TOPIC_HALL_EN_CMD)      h = 8;
+  else if (t == TOPIC_LIGHT_CMD)        h = 9;
+  else if (t == TOPIC_LIGHT_BREATH_CMD) h = 11;
+  else if (t == TOPIC_LIGHT_DIM_CMD)    h = 10;
+  else if (t == TOPIC_PARAM_GET)        h = 12;
+  else if (t == TOPIC_PARAM_SET)        h = 13;
+  s_hit = h;
+  s_sink += (uint32_t)msg.size();
+}
+
+// ---- Ahora: tabla ordenada y payload en sitio ----
+__attribute__((noinline)) static void new_dispatch(const char* topic, const uint8_t* payload, size_t len) {
+  const TopicRoute* r = findRoute(ROUTES, topic, strlen(topic));
+  if (!r) { s_hit = -1; return; }
+  r->fn(MsgView((const char*)payload, len).trimmed());
+}
+
+typedef void (*DispatchFn)(const char*, const uint8_t*, size_t);
+
+static double time_ns(DispatchFn fn, const Msg* msgs, size_t n) {
+  Clock::time_point t0 = Clock::now();
+  for (int k = 0; k < REPS; ++k)
+    for (size_t i = 0; i < n; ++i)
+      fn(msgs[i].topic, (const uint8_t*)msgs[i].payload, strlen(msgs[i].payload));
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ((double)REPS * n);
+}
+
+static void row(const char* name, const Msg* msgs, size_t n) {
+  double before = time_ns(old_dispatch, msgs, n);
+  double after  = time_ns(new_dispatch, msgs, n);
+  printf("  %-22s antes %7.1f ns/msg   ahora %6.1f ns/msg   x%.1f\n", name, before, after, before / after);
+}
+
+static bool routes_ok() {
+  bool ok = true;
+  for (const Msg& m : MSGS) {
+    new_dispatch(m.topic, (const uint8_t*)m.payload, strlen(m.payload));
+    ok &= (s_hit == m.handler);
+  }
+  for (const Msg& m : ECHOES) ok &= (findRoute(ROUTES, m.topic, strlen(m.topic)) == nullptr);
+  // Prefijo y extensión de un topic válido
+  std::string t = TOPIC_CMD;
+  ok &= findRoute(ROUTES, t.c_str(), t.size() - 1) == nullptr;
+  t += "x";
+  ok &= findRoute(ROUTES, t.c_str(), t.size()) == nullptr;
+  // Topic sin terminador (esp-mqtt da puntero + longitud)
+  t = std::string(TOPIC_GOTO_CMD) + "garbage";
+  const TopicRoute* r = findRoute(ROUTES, t.c_str(), strlen(TOPIC_GOTO_CMD));
+  ok &= (r != nullptr && strcmp(r->topic, TOPIC_GOTO_CMD) == 0);
+  return ok;
+}
+
+int main() {
+  printf("route_bench: %u topics de entrada, %d repeticiones\n", (unsigned)ROUTES.size(), REPS);
+  row("comandos (14 topics)", MSGS, sizeof(MSGS) / sizeof(MSGS[0]));
+  row("ecos de estado", ECHOES, sizeof(ECHOES) / sizeof(ECHOES[0]));
+  bool ok = routes_ok();
+  puts(ok ? "  ok" : "  FALLO: topic mal despachado");
+  return ok ? 0 : 1;
+}
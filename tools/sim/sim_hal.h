@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+#include "door_model.h"
+
+// =====================================================
+//   Control del HAL simulado (lo usa sim_main.cpp)
+// =====================================================
+
+DoorModel& sim_door();
+
+void     sim_seed(uint32_t seed);
+uint64_t sim_now_us();
+
+// Avanza el tiempo virtual: integra la física en pasos de SIM_PHYS_STEP_US,
+// genera las tramas del ADC continuo y los flancos del encoder (ISR).
+static const uint32_t SIM_PHYS_STEP_US = 100;
+void sim_advance_us(uint32_t us);
+
+// Salida de Serial (logs del firmware) a stdout
+void sim_set_console(bool on);
+
+// Duty aplicado por el firmware a cada lado del puente (0..1)
+float sim_duty_open();
+float sim_duty_close();
+
+// Operaciones LEDC (escrituras directas / fades hardware programados)
+uint32_t sim_ledc_writes();
+uint32_t sim_ledc_fades();
+uint32_t sim_ledc_blocked();   // escrituras/fades con un fade en curso (en el equipo esperan)
+
+// ADC continuo: pool de tramas del driver (ver hal.cpp). Para las pruebas de
+// adquisición se inyectan tramas sin avanzar el tiempo (sin el modelo).
+static const size_t SIM_ADC_POOL_FRAMES = 2;   // pocas tramas, como el pool del core
+void     sim_adc_set_pool(size_t frames);
+void     sim_adc_inject(int raw);               // trama con este raw + ISR
+size_t   sim_adc_pending();                     // tramas en el pool
+uint32_t sim_adc_reads();                       // lecturas con trama
+uint32_t sim_adc_empty_reads();                 // lecturas con el pool vacío (timeout)
+uint32_t sim_adc_overflows();                   // tramas perdidas por pool lleno
+void     sim_adc_on_next_read(void (*cb)(void)); // una vez, dentro de la próxima lectura
+
+// Curva de la caracterización eFuse (mV en el pin para cada raw). Sin curva
+// la creación del esquema falla y current.cpp usa el modelo lineal.
+void sim_adc_set_cali(float (*mvOfRaw)(int raw));
+
+// Red (hal_net.cpp): WiFi, esp-mqtt y ArduinoOTA para las pruebas que
+// compilan el net.cpp real. La prueba hace de tarea de eventos y de tarea
+// MQTT; lo que net.cpp deja en el outbox se guarda sin reservar heap.
+void        sim_wifi_set_up(bool up);                         // GOT_IP / DISCONNECTED
+void        sim_broker_connect();                             // CONNECTED (se suscribe a todo)
+void        sim_broker_drop();                                // DISCONNECTED
+void        sim_broker_send(const char* topic, const char* payload);   // DATA
+// Conexión automática como la tarea de esp-mqtt: cada intento tiene tomado
+// el cerrojo del cliente connectMs (DNS, TCP, CONNACK) y tras un corte se
+// reintenta a los reconnect_timeout_ms de la configuración. Una llamada de
+// otra tarea al cliente durante el intento espera (avanza el tiempo).
+void        sim_broker_set_connect_ms(uint32_t connectMs);
+void        sim_broker_task();                                // paso de la tarea MQTT
+bool        sim_broker_connecting();
+uint32_t    sim_broker_waits();                               // llamadas que esperaron al cerrojo
+uint32_t    sim_broker_subscriptions();                       // desde el arranque
+uint32_t    sim_broker_received();                            // publicaciones en el outbox
+const char* sim_broker_last(const char* topic);               // último payload ("" si ninguno)
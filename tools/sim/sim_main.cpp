@@ -0,0 +1,227 @@
+// =====================================================
+//   Simulador en Linux del controlador de la puerta
+// =====================================================
+// Compila los módulos del firmware (motor, hall, current, safety, state,
+// traj, ienv, cfgstore, params, logx...) y el propio puerta.ino contra el
+// HAL de hal/, conectado al modelo físico de door_model.h. Ejecuta ciclos
+// abrir/cerrar en tiempo virtual, mucho más rápido que el real, y resume
+// duración, pico de corriente y precisión en los topes.
+//
+//   make -C tools/sim
+//   tools/sim/puerta_sim --cycles 1000 --seed 7
+//   tools/sim/puerta_sim --goto --set "traj.acc_max=1200 motor.vel_kp=1.0"
+//
+// Sale con código 1 si algún movimiento no termina bien en su tope.
+#include <Arduino.h>
+#include <chrono>
+#include <random>
+#include "config.h"
+#include "state.h"
+#include "hall.h"
+#include "motor.h"
+#include "current.h"
+#include "traj.h"
+#include "tasks.h"
+#include "params.h"
+#include "msgbuf.h"
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+void setup();   // puerta.ino
+
+struct Options {
+  long        cycles   = 100;      // pares abrir + cerrar
+  uint32_t    seed     = 1;
+  int         speed    = 100;      // velocidad base (%)
+  bool        useGoto  = false;    // movimientos por el planificador (CMD_GOTO)
+  uint32_t    pauseMs  = 3000;     // reposo entre movimientos
+  uint32_t    timeoutMs = 120000;
+  long        tolCounts = 100;     // error máximo en el tope (≈1% del recorrido)
+  float       jitter   = 0.10f;    // variación de rozamiento entre movimientos (±)
+  float       limitA   = 0.0f;     // 0 = el del firmware
+  const char* set      = nullptr;  // "nombre=valor ..." para el registro de parámetros
+  const char* csv      = nullptr;
+  bool        verbose  = false;
+};
+
+struct MoveResult {
+  bool     open;
+  bool     ok;
+  bool     obstacle;   // pasó por OBSTACULO (corte de corriente al cerrar)
+  bool     timeout;
+  uint32_t ms;         // desde la orden hasta la parada
+  float    peakA;      // pico real (modelo)
+  float    peakMeasA;  // pico visto por current_read_mA()
+  float    endErr;     // posición final real - tope (cuentas)
+};
+
+struct Agg {
+  long  n = 0, fails = 0, obstacles = 0;
+  float tMin = 1e9f, tMax = 0, tSum = 0;
+  float iMax = 0, iSum = 0, iMeasMax = 0;
+  float eAbsMax = 0, eSum = 0, eAbsSum = 0;
+
+  void add(const MoveResult& r) {
+    float t = r.ms * 0.001f;
+    n++;
+    if (!r.ok) fails++;
+    if (r.obstacle) obstacles++;
+    tMin = fminf(tMin, t); tMax = fmaxf(tMax, t); tSum += t;
+    iMax = fmaxf(iMax, r.peakA); iSum += r.peakA;
+    iMeasMax = fmaxf(iMeasMax, r.peakMeasA);
+    eAbsMax = fmaxf(eAbsMax, fabsf(r.endErr)); eSum += r.endErr; eAbsSum += fabsf(r.endErr);
+  }
+};
+
+static std::mt19937 s_rng;
+
+// Un milisegundo de tiempo virtual con los periodos de las dos tareas
+static void tick_1ms() {
+  sim_advance_us(1000);
+  uint32_t now = millis();
+  if (now % CONTROL_PERIOD_MS == 0) sim_run_control(now);
+  if (now % NET_TASK_DELAY_MS == 0) sim_run_net(now);
+}
+
+static void idle_for(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; ++i) tick_1ms();
+}
+
+static bool moving_state() {
+  EstadoPuerta e = getEstado();
+  return e == ABRIENDO || e == CERRANDO || e == OBSTACULO || traj_active();
+}
+
+static MoveResult run_move(bool open, const Options& o) {
+  static const uint32_t SETTLE_MS = 300;   // parada = DETENIDO y sin velocidad este tiempo
+  DoorModel& door = sim_door();
+  std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+  door.cfg.frictionScale = 1.0f + o.jitter * u(s_rng);
+
+  MoveResult r = {};
+  r.open = open;
+
+  if (o.useGoto) tasks_post_cmd(CMD_GOTO, open ? hall_open_pulses : 0);
+  else           tasks_post_cmd(CMD_SET_ESTADO, open ? ABRIENDO : CERRANDO);
+
+  uint32_t t0 = millis();
+  uint32_t stillSince = 0;
+  bool started = false;
+  for (;;) {
+    tick_1ms();
+    uint32_t now = millis();
+    r.peakA     = fmaxf(r.peakA, fabsf(door.current()));
+    r.peakMeasA = fmaxf(r.peakMeasA, current_read_mA() * 0.001f);
+    if (getEstado() == OBSTACULO) r.obstacle = true;
+
+    bool mv = moving_state();
+    if (mv) started = true;
+    if (started && !mv && door.vel() == 0.0f) {
+      if (stillSince == 0) stillSince = now;
+      if (now - stillSince >= SETTLE_MS) break;
+    } else {
+      stillSince = 0;
+    }
+    if (now - t0 >= o.timeoutMs) { r.timeout = true; break; }
+  }
+
+  if (r.timeout) {
+    sim_set_context(SIM_CTX_CONTROL);
+    setEstado(DETENIDO);
+    sim_set_context(SIM_CTX_DRIVER);
+    idle_for(SETTLE_MS);
+  }
+
+  r.ms     = (stillSince ? stillSince : millis()) - t0;
+  r.endErr = door.pos() - (open ? (float)door.cfg.travel : 0.0f);
+  r.ok     = !r.timeout && !r.obstacle && fabsf(r.endErr) <= (float)o.tolCounts;
+  return r;
+}
+
+static void print_agg(const char* name, const Agg& a) {
+  if (a.n == 0) return;
+  printf("  %-7s %5ld mov  %4ld fallos  %4ld obst.  t=%.2f/%.2f/%.2f s  Ipico=%.2f/%.2f A (medido %.2f)  "
+         "tope=%+.1f med, %.1f med|.|, %.1f máx cuentas\n",
+         name, a.n, a.fails, a.obstacles, a.tMin, a.tSum / a.n, a.tMax,
+         a.iSum / a.n, a.iMax, a.iMeasMax, a.eSum / a.n, a.eAbsSum / a.n, a.eAbsMax);
+}
+
+static void usage() {
+  puts("uso: puerta_sim [--cycles N] [--seed S] [--speed PCT] [--goto] [--pause MS]\n"
+       "                [--timeout MS] [--tol CUENTAS] [--jitter F] [--noise MV] [--tight A]\n"
+       "                [--limit A] [--set \"param=valor ...\"] [--csv FICHERO] [--verbose]");
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  DoorModel& door = sim_door();
+
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    bool more = (i + 1 < argc);
+    if      (!strcmp(a, "--cycles")  && more) o.cycles    = atol(argv[++i]);
+    else if (!strcmp(a, "--seed")    && more) o.seed      = (uint32_t)atol(argv[++i]);
+    else if (!strcmp(a, "--speed")   && more) o.speed     = atoi(argv[++i]);
+    else if (!strcmp(a, "--pause")   && more) o.pauseMs   = (uint32_t)atol(argv[++i]);
+    else if (!strcmp(a, "--timeout") && more) o.timeoutMs = (uint32_t)atol(argv[++i]);
+    else if (!strcmp(a, "--tol")     && more) o.tolCounts = atol(argv[++i]);
+    else if (!strcmp(a, "--jitter")  && more) o.jitter    = (float)atof(argv[++i]);
+    else if (!strcmp(a, "--noise")   && more) door.cfg.noiseMv = (float)atof(argv[++i]);
+    else if (!strcmp(a, "--tight")   && more) door.cfg.tightA  = (float)atof(argv[++i]);
+    else if (!strcmp(a, "--limit")   && more) o.limitA    = (float)atof(argv[++i]);
+    else if (!strcmp(a, "--set")     && more) o.set       = argv[++i];
+    else if (!strcmp(a, "--csv")     && more) o.csv       = argv[++i];
+    else if (!strcmp(a, "--goto"))    o.useGoto = true;
+    else if (!strcmp(a, "--verbose")) o.verbose = true;
+    else { usage(); return 2; }
+  }
+
+  sim_seed(o.seed);
+  s_rng.seed(o.seed ^ 0x5eedu);
+  sim_set_console(o.verbose);
+  door.cfg.travel = (long)HALL_OPEN_PULSES_DEFAULT * HALL_COUNTS_PER_PULSE;
+  door.reset(0.0f);   // arranca cerrada
+
+  setup();
+
+  // Lo que en la instalación llega por MQTT
+  sim_set_context(SIM_CTX_NET);
+  motor_set_speed_target(o.speed);
+  if (o.limitA > 0.0f) current_set_limit(o.limitA);
+  if (o.set) params_handle_set(MsgView(o.set, strlen(o.set)));
+  sim_set_context(SIM_CTX_DRIVER);
+
+  FILE* csv = o.csv ? fopen(o.csv, "w") : nullptr;
+  if (o.csv && !csv) { perror(o.csv); return 2; }
+  if (csv) fputs("move,dir,ok,obstacle,timeout,ms,peak_a,peak_meas_a,end_err\n", csv);
+
+  idle_for(o.pauseMs);   // offset del sensor y arranque de los módulos
+
+  Agg aggOpen, aggClose;
+  auto w0 = std::chrono::steady_clock::now();
+  uint64_t v0 = sim_now_us();
+
+  for (long c = 0; c < o.cycles * 2; ++c) {
+    bool open = (c % 2) == 0;
+    MoveResult r = run_move(open, o);
+    (open ? aggOpen : aggClose).add(r);
+    if (csv) {
+      fprintf(csv, "%ld,%s,%d,%d,%d,%u,%.3f,%.3f,%.1f\n", c, open ? "open" : "close",
+              r.ok, r.obstacle, r.timeout, (unsigned)r.ms, r.peakA, r.peakMeasA, r.endErr);
+    }
+    idle_for(o.pauseMs);
+  }
+
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - w0).count();
+  double simS  = (sim_now_us() - v0) * 1e-6;
+  if (csv) fclose(csv);
+
+  printf("puerta_sim: %ld ciclos (%s, velocidad %d%%, semilla %u)\n",
+         o.cycles, o.useGoto ? "goto" : "abrir/cerrar", o.speed, (unsigned)o.seed);
+  print_agg("abrir", aggOpen);
+  print_agg("cerrar", aggClose);
+  printf("  %.0f s simulados en %.2f s (x%.0f tiempo real), %u publicaciones MQTT\n",
+         simS, wallS, wallS > 0 ? simS / wallS : 0.0, (unsigned)sim_publish_count());
+
+  return (aggOpen.fails + aggClose.fails) ? 1 : 0;
+}
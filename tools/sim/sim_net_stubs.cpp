@@ -0,0 +1,40 @@
+// =====================================================
+//   Sustitutos de red y OTA para el simulador
+// =====================================================
+// Sin net.cpp ni ota_ctl.cpp: las publicaciones se cuentan y, con
+// sim_mqtt_connect(), pasan por una función de la prueba. Las pruebas de
+// la propia red (net_alloc, net_block) compilan los de verdad contra
+// hal_net.cpp y no enlazan este archivo.
+#include <Arduino.h>
+#include "config.h"
+#include "net.h"
+#include "ota_ctl.h"
+#include "logx.h"
+#include "sim_stubs.h"
+
+// ---------------- Red ----------------
+static uint32_t s_publishes = 0;
+static SimPublishFn s_mqtt = nullptr;
+
+void net_begin() {}
+void net_tick() { logx_flush(); }      // como net.cpp: vacía el log en cada pasada
+bool net_wifi_connected() { return s_mqtt != nullptr; }
+bool net_mqtt_connected() { return s_mqtt != nullptr; }
+void net_publish_state() {}
+bool net_mqtt_publish(const char* topic, const uint8_t* payload, size_t len, bool, bool) {
+  if (s_mqtt && !s_mqtt(topic, payload, len)) return false;
+  s_publishes++;
+  return true;
+}
+bool net_mqtt_publish(const char* topic, const char* payload, bool retain) {
+  return net_mqtt_publish(topic, (const uint8_t*)payload, strlen(payload), retain);
+}
+uint32_t sim_publish_count() { return s_publishes; }
+void sim_mqtt_connect(SimPublishFn fn) { s_mqtt = fn; }
+
+// ---------------- OTA ----------------
+void     ota_enable_for(uint32_t) {}
+void     ota_disable() {}
+void     ota_tick() {}
+bool     ota_is_on() { return false; }
+uint32_t ota_seconds_left() { return 0; }
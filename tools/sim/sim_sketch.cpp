@@ -0,0 +1,3 @@
+// El sketch tal cual: setup(), controlStep() y netStep() son los del firmware
+#include <Arduino.h>
+#include "puerta.ino"
@@ -0,0 +1,93 @@
+// =====================================================
+//   Sustitutos de display y tareas para el simulador
+// =====================================================
+// Los módulos de control se compilan tal cual; lo que depende del MAX7219
+// o de FreeRTOS se reduce aquí a lo mínimo (red y OTA: sim_net_stubs.cpp).
+// Las tareas se emulan en un solo hilo: sim_main.cpp llama a los pasos de
+// control y red con sus periodos, y los comandos se aplican al principio
+// del paso de control igual que en tasks.cpp.
+#include <Arduino.h>
+#include "config.h"
+#include "display.h"
+#include "tasks.h"
+#include "state.h"
+#include "hall.h"
+#include "motor.h"
+#include "current.h"
+#include "traj.h"
+#include "ienv.h"
+#include "telem.h"
+#include "sim_stubs.h"
+
+// ---------------- Display ----------------
+void display_begin() {}
+void renderEstado(EstadoPuerta) {}
+void display_tick() {}
+
+// ---------------- Tareas ----------------
+struct SimCmd { TaskCmdType type; int32_t arg; };
+
+static TaskStepFn  s_controlStep = nullptr;
+static TaskNetStepFn s_netStep   = nullptr;
+static SimContext  s_ctx = SIM_CTX_BOOT;
+static SimCmd      s_cmds[16];
+static uint8_t     s_cmdCount = 0;
+static CtlSnapshot s_snap = {};
+
+void tasks_begin(TaskStepFn controlStep, TaskNetStepFn netStep) {
+  s_controlStep = controlStep;
+  s_netStep     = netStep;
+  s_ctx = SIM_CTX_DRIVER;
+}
+
+// Antes de tasks_begin() todo vale (como en tasks.cpp, sin tareas creadas)
+bool tasks_in_control_context() { return s_ctx == SIM_CTX_BOOT || s_ctx == SIM_CTX_CONTROL; }
+bool tasks_in_net_context()     { return s_ctx == SIM_CTX_BOOT || s_ctx == SIM_CTX_NET; }
+
+bool tasks_post_cmd(TaskCmdType type, int32_t arg) {
+  if (s_cmdCount >= sizeof(s_cmds) / sizeof(s_cmds[0])) return false;
+  s_cmds[s_cmdCount++] = { type, arg };
+  return true;
+}
+
+const CtlSnapshot& tasks_snapshot() { return s_snap; }
+void tasks_get_timing(CtlTiming& out, bool) { out = {}; }
+
+static void apply_cmd(const SimCmd& c) {
+  switch (c.type) {
+    case CMD_SET_ESTADO:       setEstado((EstadoPuerta)c.arg); break;
+    case CMD_HALL_MARK_CLOSED: hall_mark_closed();             break;
+    case CMD_HALL_MARK_OPEN:   hall_mark_open();               break;
+    case CMD_GOTO:             traj_start(c.arg);              break;
+    case CMD_IENV_RESET:       ienv_reset();                   break;
+    case CMD_ADC_LUT:          current_lut_apply();            break;
+  }
+}
+
+void sim_run_control(uint32_t nowMs) {
+  s_ctx = SIM_CTX_CONTROL;
+  for (uint8_t i = 0; i < s_cmdCount; ++i) apply_cmd(s_cmds[i]);
+  s_cmdCount = 0;
+  s_controlStep(nowMs);
+
+  s_snap.ms     = nowMs;
+  s_snap.pos    = hall_get_count();
+  s_snap.dir    = (int8_t)hall_get_dir();
+  s_snap.vel    = hall_get_velocity();
+  s_snap.estado = (uint8_t)getEstado();
+  s_snap.speed  = (uint8_t)motor_get_speed();
+  s_snap.mA     = current_read_mA();
+  s_snap.duty   = (uint16_t)lroundf(motor_get_duty() * 100.0f);
+  s_snap.flags  = telem_ctl_flags();
+  s_ctx = SIM_CTX_NET;
+  telem_push(s_snap);   // la tarea de red recibe cada captura
+  s_ctx = SIM_CTX_DRIVER;
+}
+
+void sim_run_net(uint32_t nowMs) {
+  s_ctx = SIM_CTX_NET;
+  s_netStep(nowMs);
+  s_ctx = SIM_CTX_DRIVER;
+}
+
+void sim_set_context(SimContext c) { s_ctx = c; }
@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Quién "está ejecutando" según tasks_in_*_context()
+enum SimContext : uint8_t {
+  SIM_CTX_BOOT,      // setup(): antes de tasks_begin()
+  SIM_CTX_CONTROL,   // paso de control
+  SIM_CTX_NET,       // paso de red/UI
+  SIM_CTX_DRIVER,    // el escenario (como si llegara por MQTT)
+};
+
+void sim_set_context(SimContext c);
+
+// Un paso de cada tarea (aplica antes los comandos encolados)
+void sim_run_control(uint32_t nowMs);
+void sim_run_net(uint32_t nowMs);
+
+// Red sustituida (sim_net_stubs.cpp; no en las pruebas con el net.cpp real)
+uint32_t sim_publish_count();
+
+// MQTT "conectado": cada publicación pasa por fn, que devuelve si la cola de
+// salida la admite. nullptr = desconectado (por defecto, todo se admite).
+typedef bool (*SimPublishFn)(const char* topic, const uint8_t* payload, size_t len);
+void sim_mqtt_connect(SimPublishFn fn);
@@ -0,0 +1,131 @@
+// =====================================================
+//   Respuesta a escalón del lazo de velocidad (host)
+// =====================================================
+// Con la puerta en marcha a mitad de recorrido cambia la consigna del lazo
+// cerrado (motor_set_profile) de STEP_LO a STEP_HI y vuelta, en los dos
+// sentidos y con el rozamiento del modelo a 0.8, 1.0 y 1.2 veces el nominal.
+// Mide sobre la velocidad real del modelo:
+//   sobreoscilación = pico más allá de la consigna / tamaño del escalón
+//   establecimiento = último instante fuera de ±SETTLE_BAND del escalón
+// Sale con código 1 si algún escalón supera OVERSHOOT_MAX o SETTLE_MAX_MS.
+//
+//   make -C tools/sim step
+#include <Arduino.h>
+#include <math.h>
+#include "config.h"
+#include "state.h"
+#include "hall.h"
+#include "motor.h"
+#include "tasks.h"
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+void setup();   // puerta.ino
+
+static const float    STEP_LO       = 40.0f;   // % de MOTOR_VEL_MAX_CPS
+static const float    STEP_HI       = 80.0f;
+static const uint32_t HOLD_MS       = 1000;    // duración de cada escalón
+static const long     OPEN_FROM     = 3000;    // los escalones al abrir empiezan aquí...
+static const long     LEAD_COUNTS   = 600;     // ...y tras este recorrido a STEP_LO
+static const float    SETTLE_BAND   = 0.05f;   // ±5% del escalón
+static const float    OVERSHOOT_MAX = 0.20f;   // medido: ~16 % al bajar, <10 % al subir
+static const uint32_t SETTLE_MAX_MS = 800;     // medido: 360..720 ms
+
+struct StepResult {
+  float    overshoot;   // fracción del escalón
+  uint32_t settleMs;
+};
+
+static void tick_1ms() {
+  sim_advance_us(1000);
+  uint32_t now = millis();
+  if (now % CONTROL_PERIOD_MS == 0) sim_run_control(now);
+  if (now % NET_TASK_DELAY_MS == 0) sim_run_net(now);
+}
+
+static void idle_for(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; ++i) tick_1ms();
+}
+
+static void set_profile(float pct) {
+  sim_set_context(SIM_CTX_CONTROL);
+  if (pct < 0.0f) motor_clear_profile();
+  else            motor_set_profile(pct);
+  sim_set_context(SIM_CTX_DRIVER);
+}
+
+// Velocidad real en el sentido de marcha (cuentas/s)
+static float fwd_vel(bool open) {
+  return open ? sim_door().vel() : -sim_door().vel();
+}
+
+static StepResult run_step(bool open, float fromPct, float toPct) {
+  const float v0 = MOTOR_VEL_MAX_CPS * fromPct / 100.0f;
+  const float v1 = MOTOR_VEL_MAX_CPS * toPct / 100.0f;
+  const float step = fabsf(v1 - v0);
+  const float up = (v1 > v0) ? 1.0f : -1.0f;
+
+  set_profile(toPct);
+  StepResult r = {};
+  float peak = 0.0f;
+  for (uint32_t t = 1; t <= HOLD_MS; ++t) {
+    tick_1ms();
+    float v = fwd_vel(open);
+    peak = fmaxf(peak, (v - v1) * up);
+    if (fabsf(v - v1) > SETTLE_BAND * step) r.settleMs = t;
+  }
+  r.overshoot = peak / step;
+  return r;
+}
+
+static bool report(const char* name, float scale, const StepResult& r) {
+  bool ok = r.overshoot <= OVERSHOOT_MAX && r.settleMs <= SETTLE_MAX_MS;
+  printf("  %-14s roz x%.1f  sobreosc. %5.1f %%  establ. %4u ms  %s\n", name, scale,
+         100.0f * r.overshoot, (unsigned)r.settleMs, ok ? "ok" : "FALLO");
+  return ok;
+}
+
+// Arranca en STEP_LO, escalón arriba y abajo lejos de los topes, y para.
+// Abriendo desde cerrada se llega a OPEN_FROM; cerrando queda recorrido de sobra.
+static bool test_direction(bool open, float scale) {
+  DoorModel& door = sim_door();
+  const long start = door.counts();
+  set_profile(STEP_LO);
+  tasks_post_cmd(CMD_SET_ESTADO, open ? ABRIENDO : CERRANDO);
+  while (labs(door.counts() - start) < LEAD_COUNTS || (open && door.counts() < OPEN_FROM))
+    tick_1ms();
+
+  bool ok = true;
+  ok &= report(open ? "abrir  40->80" : "cerrar 40->80", scale, run_step(open, STEP_LO, STEP_HI));
+  ok &= report(open ? "abrir  80->40" : "cerrar 80->40", scale, run_step(open, STEP_HI, STEP_LO));
+
+  tasks_post_cmd(CMD_SET_ESTADO, DETENIDO);
+  idle_for(500);
+  set_profile(-1.0f);
+  return ok;
+}
+
+int main() {
+  sim_seed(1);
+  DoorModel& door = sim_door();
+  door.cfg.travel = (long)HALL_OPEN_PULSES_DEFAULT * HALL_COUNTS_PER_PULSE;
+  door.reset(0.0f);
+  setup();
+  idle_for(3000);
+
+  printf("speed_step: escalones %.0f%% <-> %.0f%% (%u ms), banda ±%.0f%%\n",
+         STEP_LO, STEP_HI, (unsigned)HOLD_MS, 100.0f * SETTLE_BAND);
+
+  bool ok = true;
+  const float scales[] = { 0.8f, 1.0f, 1.2f };
+  for (float s : scales) {
+    door.cfg.frictionScale = s;
+    ok &= test_direction(true, s);
+    ok &= test_direction(false, s);
+    // Vuelta al tope cerrado con la rampa normal para la siguiente tanda
+    tasks_post_cmd(CMD_SET_ESTADO, CERRANDO);
+    while (getEstado() != DETENIDO || door.vel() != 0.0f) tick_1ms();
+    idle_for(500);
+  }
+  return ok ? 0 : 1;
+}
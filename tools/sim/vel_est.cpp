@@ -0,0 +1,72 @@
+// =====================================================
+//   Estimador de velocidad por periodo a velocidad constante (host)
+// =====================================================
+// Mueve la posición del modelo a velocidad fija (sin la física: solo
+// importan los flancos del encoder) y llama a hall_tick() cada periodo de
+// control. Compara hall_get_velocity() con la velocidad real una vez
+// lleno el anillo de flancos, de las velocidades bajas (periodos largos)
+// a las altas (ventana de VEL_WINDOW_US). Los flancos del HAL llevan la marca
+// de su paso de física (SIM_PHYS_STEP_US), así que el error esperable con
+// marcas de flanco es de ese orden; con marcas por lectura (periodo de
+// control) llega al 5-15 % por debajo de 100 cuentas/s.
+// Sale con código 1 si el error supera ERR_MAX en alguna.
+//
+//   make -C tools/sim vel
+#include <Arduino.h>
+#include <math.h>
+#include "config.h"
+#include "cfgstore.h"
+#include "params.h"
+#include "hall.h"
+#include "sim_hal.h"
+#include "sim_stubs.h"
+
+static const float    SPEEDS[]  = { 13.0f, 17.0f, 33.0f, 70.0f, 333.0f, 1000.0f, -17.0f, -333.0f };
+static const float    ERR_MAX   = 0.02f;    // medido: <0,4 % con marcas de flanco
+static const uint32_t SETTLE_MS = 1500;     // anillo lleno a 13 cuentas/s
+static const uint32_t MEASURE_MS = 2000;
+static const float    START_POS = 5000.0f;
+
+// Error relativo máximo con la puerta a v cuentas/s
+static float run(float v) {
+  uint64_t t0 = sim_now_us();
+  sim_door().reset(START_POS);
+  float errMax = 0.0f;
+  for (uint32_t t = 1; t <= SETTLE_MS + MEASURE_MS; ++t) {
+    for (uint32_t k = 0; k < 1000; k += SIM_PHYS_STEP_US) {
+      // Sin física: posición impuesta (en double, sin acumular redondeos)
+      double pos = START_POS + v * (double)(sim_now_us() + SIM_PHYS_STEP_US - t0) * 1e-6;
+      sim_door().reset((float)pos);
+      sim_advance_us(SIM_PHYS_STEP_US);
+    }
+    uint32_t now = millis();
+    if (now % CONTROL_PERIOD_MS != 0) continue;
+    sim_set_context(SIM_CTX_CONTROL);
+    hall_tick(now);
+    sim_set_context(SIM_CTX_DRIVER);
+    if (t > SETTLE_MS) errMax = fmaxf(errMax, fabsf(hall_get_velocity() - v) / fabsf(v));
+  }
+  return errMax;
+}
+
+int main() {
+  sim_set_context(SIM_CTX_BOOT);
+  cfg_begin();
+  params_begin();
+  hall_begin();
+  sim_set_context(SIM_CTX_DRIVER);
+
+  printf("vel_est: periodo de control %u ms, flancos cada %u us como mínimo\n",
+         (unsigned)CONTROL_PERIOD_MS, (unsigned)SIM_PHYS_STEP_US);
+  bool ok = true;
+  for (float v : SPEEDS) {
+    float e = run(v);
+    bool pass = e <= ERR_MAX;
+    ok &= pass;
+    printf("  %7.0f cuentas/s  error máx %5.2f %%  %s\n", v, e * 100.0f, pass ? "ok" : "FALLO");
+    // Parada entre velocidades: el anillo se vacía por tiempo
+    sim_advance_us(1000000);
+  }
+  puts(ok ? "  ok" : "  FALLO");
+  return ok ? 0 : 1;
+}
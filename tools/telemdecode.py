@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""Decodificador de la telemetría binaria del ESP32 (topic garage/telem/bin).
+
+Cada publicación es un lote (little-endian, ver telem.h):
+    [versión u8][tamaño de trama u8][seq u16] trama*
+    trama v1 = [ms u32][pos i32][vel i16][mA i16][duty u16][estado u8][flags u8]
+vel en cuentas/s, duty en 0.01 %. Un salto en seq indica lotes perdidos.
+
+Uso:
+    telemdecode.py lote.bin ...              # decodificar ficheros (CSV)
+    telemdecode.py --mqtt broker[:puerto]    # escuchar en vivo (paho-mqtt)
+    telemdecode.py --bench [segundos]        # bytes y coste frente al formato de texto
+
+Como librería: decode_batch(payload) -> (seq, [dict por trama]).
+"""
+import argparse
+import struct
+import sys
+import time
+
+TOPIC_BIN = "garage/telem/bin"
+VERSION = 1
+HEADER = struct.Struct("<BBH")
+FRAME_V1 = struct.Struct("<IihhHBB")
+FIELDS = ("ms", "pos", "vel", "mA", "duty", "estado", "flags")
+ESTADOS = {0: "ABRIENDO", 1: "CERRANDO", 2: "DETENIDO", 3: "OBSTACULO"}
+FLAGS = {0x01: "hall", 0x02: "slow", 0x04: "traj", 0x08: "ioff_ok", 0x10: "closing"}
+
+# Rates del firmware (config.h)
+MOVE_MS = 20
+BATCH_FRAMES = 5
+
+
+class DecodeError(ValueError):
+    pass
+
+
+def decode_batch(data):
+    """Devuelve (seq, tramas). Versiones futuras con tramas más largas se
+    leen igual: los campos v1 son prefijo y el resto se ignora."""
+    if len(data) < HEADER.size:
+        raise DecodeError("lote corto (%d bytes)" % len(data))
+    ver, size, seq = HEADER.unpack_from(data, 0)
+    if ver < VERSION or size < FRAME_V1.size:
+        raise DecodeError("versión %d / trama de %d bytes no soportada" % (ver, size))
+    body = len(data) - HEADER.size
+    if body % size:
+        raise DecodeError("%d bytes de tramas no es múltiplo de %d" % (body, size))
+    frames = []
+    for off in range(HEADER.size, len(data), size):
+        f = dict(zip(FIELDS, FRAME_V1.unpack_from(data, off)))
+        f["duty"] = f["duty"] / 100.0
+        frames.append(f)
+    return seq, frames
+
+
+def encode_batch(seq, frames):
+    """Inverso de decode_batch (pruebas y benchmark)."""
+    out = bytearray(HEADER.pack(VERSION, FRAME_V1.size, seq & 0xFFFF))
+    for f in frames:
+        out += FRAME_V1.pack(f["ms"], f["pos"], f["vel"], f["mA"], int(round(f["duty"] * 100)),
+                             f["estado"], f["flags"])
+    return bytes(out)
+
+
+def flag_names(flags):
+    return "|".join(n for b, n in sorted(FLAGS.items()) if flags & b) or "-"
+
+
+def csv_rows(seq, frames):
+    for f in frames:
+        yield "%d,%.3f,%d,%d,%d,%.2f,%s,%s\n" % (
+            seq, f["ms"] / 1000.0, f["pos"], f["vel"], f["mA"], f["duty"],
+            ESTADOS.get(f["estado"], str(f["estado"])), flag_names(f["flags"]))
+
+
+CSV_HEADER = "seq,t_s,pos,vel,mA,duty,estado,flags\n"
+
+
+# ---------------- Benchmark frente al texto ----------------
+
+def mqtt_publish_bytes(topic, payload_len):
+    """Tamaño de un PUBLISH QoS 0 en el cable (cabecera fija + topic + datos)."""
+    rem = 2 + len(topic) + payload_len
+    n, r = 1, rem
+    while r >= 128:          # longitud restante en varint de 7 bits
+        r >>= 7
+        n += 1
+    return 1 + n + rem
+
+
+def synth_move(seconds):
+    """Un recorrido sintético: rampa, crucero y frenada."""
+    frames = []
+    n = int(seconds * 1000 / MOVE_MS)
+    pos = 0
+    for i in range(n):
+        x = i / max(1, n - 1)
+        vel = int(900 * min(1.0, 4 * x, 4 * (1 - x)))
+        pos += vel * MOVE_MS // 1000
+        frames.append({"ms": 100000 + i * MOVE_MS, "pos": pos, "vel": vel,
+                       "mA": 2500 + vel * 3, "duty": min(100.0, vel / 9.0),
+                       "estado": 0, "flags": 0x0D})
+    return frames
+
+
+def text_publishes(f):
+    """Lo que publicaría el formato de texto por muestra (como net.cpp)."""
+    return [("garage/current/value", "%.2f" % (f["mA"] * 0.001)),
+            ("garage/encoder/pos", "%d" % f["pos"]),
+            ("garage/encoder/dir", "1" if f["vel"] >= 0 else "-1"),
+            ("garage/encoder/vel", "%.1f" % f["vel"])]
+
+
+def bench(seconds):
+    frames = synth_move(seconds)
+    n = len(frames)
+
+    t0 = time.perf_counter()
+    text = [p for f in frames for p in text_publishes(f)]
+    t1 = time.perf_counter()
+    for topic, payload in text:
+        float(payload)
+    t2 = time.perf_counter()
+    text_bytes = sum(mqtt_publish_bytes(t, len(p)) for t, p in text)
+
+    t3 = time.perf_counter()
+    batches = [encode_batch(i, frames[j:j + BATCH_FRAMES])
+               for i, j in enumerate(range(0, n, BATCH_FRAMES))]
+    t4 = time.perf_counter()
+    decoded = sum(len(decode_batch(b)[1]) for b in batches)
+    t5 = time.perf_counter()
+    bin_bytes = sum(mqtt_publish_bytes(TOPIC_BIN, len(b)) for b in batches)
+    assert decoded == n
+
+    print("recorrido de %.1f s a %d Hz: %d muestras" % (seconds, 1000 // MOVE_MS, n))
+    print("  %-8s %6s %9s %8s %12s %12s" % ("formato", "pubs", "bytes", "B/mues.", "cod. mues/s", "dec. mues/s"))
+    print("  %-8s %6d %9d %8.1f %12.0f %12.0f  (sin duty/estado/flags)" % (
+        "texto", len(text), text_bytes, text_bytes / n, n / (t1 - t0), n / (t2 - t1)))
+    print("  %-8s %6d %9d %8.1f %12.0f %12.0f" % (
+        "binario", len(batches), bin_bytes, bin_bytes / n, n / (t4 - t3), n / (t5 - t4)))
+    print("  binario/texto: %.0f %% de bytes, %.0f %% de publicaciones" % (
+        100.0 * bin_bytes / text_bytes, 100.0 * len(batches) / len(text)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("files", nargs="*", help="lotes binarios (payloads de %s)" % TOPIC_BIN)
+    ap.add_argument("--mqtt", metavar="HOST[:PORT]", help="suscribirse a %s y decodificar en vivo" % TOPIC_BIN)
+    ap.add_argument("--bench", metavar="SEG", type=float, nargs="?", const=10.0,
+                    help="comparar con el formato de texto en un recorrido de SEG s (10)")
+    a = ap.parse_args()
+
+    if a.bench:
+        bench(a.bench)
+        return
+
+    sys.stdout.write(CSV_HEADER)
+    for name in a.files:
+        with open(name, "rb") as f:
+            seq, frames = decode_batch(f.read())
+            sys.stdout.writelines(csv_rows(seq, frames))
+
+    if a.mqtt:
+        import paho.mqtt.client as mqtt
+        host, _, port = a.mqtt.partition(":")
+
+        def on_message(c, u, msg):
+            try:
+                sys.stdout.writelines(csv_rows(*decode_batch(msg.payload)))
+            except DecodeError as e:
+                print("# %s" % e, file=sys.stderr)
+            sys.stdout.flush()
+
+        cli = mqtt.Client()
+        cli.on_message = on_message
+        cli.connect(host, int(port or 1883))
+        cli.subscribe(TOPIC_BIN)
+        cli.loop_forever()
+
+
+if __name__ == "__main__":
+    main()
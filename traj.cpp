@@ -0,0 +1,138 @@
+#include "traj.h"
+#include <math.h>
+#include "config.h"
+#include "params.h"
+#include "state.h"
+#include "hall.h"
+#include "motor.h"
+#include "logx.h"
+#include "ienv.h"
+
+// Margen sobre la distancia de frenado: la referencia va con retraso por el
+// límite de jerk y el lazo de velocidad, así que se frena algo antes
+static const float BRAKE_MARGIN = 0.8f;
+// Constante de tiempo del seguimiento de velocidad (s)
+static const float VEL_TC_S     = 0.15f;
+
+static bool  s_active = false;
+static long  s_target = 0;
+static float s_vRef   = 0.0f;   // velocidad de referencia (cuentas/s, + abrir)
+static float s_aRef   = 0.0f;   // aceleración de referencia (cuentas/s²)
+static float s_vMax   = 0.0f;
+static EstadoPuerta s_estado = DETENIDO;   // último estado fijado por el planificador
+
+// Máxima velocidad desde la que se puede parar en 'd' cuentas con un
+// frenado en S (aceleración inicial y final nulas):
+// - sin llegar a la deceleración máxima A: d = v·sqrt(v/J)      → v = cbrt(J·d²)
+// - llegando a A:                         d = v/2·(v/A + A/J)  → v = -A²/2J + sqrt((A²/2J)² + 2·A·d)
+static float v_stop(float d) {
+  const float A = params.trajAccMax;
+  const float J = params.trajJerkMax;
+  const float vT = A * A / J;
+  const float dT = vT * sqrtf(vT / J);
+  if (d <= dT) return cbrtf(J * d * d);
+  const float k = A * A / (2.0f * J);
+  return -k + sqrtf(k * k + 2.0f * A * d);
+}
+
+static void finish(const char* why) {
+  s_active = false;
+  s_vRef = s_aRef = 0.0f;
+  motor_clear_profile();
+  s_estado = DETENIDO;
+  setEstado(DETENIDO);
+  logPrintf("[TRAJ] %s (pos=%ld, objetivo=%ld)\n", why, hall_get_count(), s_target);
+}
+
+bool traj_start(long target) {
+  if (!hall_is_enabled()) return false;
+
+  if (target < 0) target = 0;
+  if (target > hall_open_pulses) target = hall_open_pulses;
+
+  s_target = target;
+  s_vMax   = MOTOR_VEL_MAX_CPS * (float)motor_get_speed_target() / 100.0f;
+  if (s_vMax < params.trajVMin) s_vMax = params.trajVMin;
+
+  if (!s_active) {
+    // Continuidad: partir de la velocidad real (puede estar ya en marcha)
+    s_vRef = hall_get_velocity();
+    s_aRef = 0.0f;
+    s_estado = getEstado();
+  }
+  s_active = true;
+  logPrintf("[TRAJ] Goto %ld (desde %ld)\n", s_target, hall_get_count());
+  return true;
+}
+
+void traj_cancel() {
+  if (s_active) finish("Cancelado");
+}
+
+bool traj_active() { return s_active; }
+long traj_target() { return s_target; }
+
+void traj_tick(uint32_t /*nowMs*/) {
+  if (!s_active) return;
+
+  // Otro actor (botón, MQTT, safety, guardia, topes) cambió el estado: cede
+  if (getEstado() != s_estado) {
+    s_active = false;
+    s_vRef = s_aRef = 0.0f;
+    motor_clear_profile();
+    logPrintln("[TRAJ] Interrumpido por cambio de estado");
+    return;
+  }
+  if (!hall_is_enabled()) { finish("Hall deshabilitado"); return; }
+
+  const float dt = MOTOR_TICK_MS / 1000.0f;
+  float err = (float)s_target - hall_get_position_interp();
+  float d   = fabsf(err);
+  float s   = (err >= 0.0f) ? 1.0f : -1.0f;
+
+  if (d <= params.trajPosTol && fabsf(s_vRef) <= params.trajVMin) {
+    finish("Objetivo alcanzado");
+    ienv_end_cycle(true);
+    return;
+  }
+
+  // Velocidad deseada: la máxima que aún permite parar en el objetivo
+  float vDes = 0.0f;
+  if (d > params.trajPosTol) {
+    vDes = v_stop(d * BRAKE_MARGIN);
+    if (vDes > s_vMax)        vDes = s_vMax;
+    if (vDes < params.trajVMin) vDes = params.trajVMin;
+    vDes *= s;
+  }
+
+  // Seguimiento de vDes con aceleración y jerk limitados. Si el objetivo
+  // está detrás, vDes cambia de signo y la referencia pasa suavemente por 0
+  // antes de invertir (el motor aplica además su dead-time).
+  float aDes = (vDes - s_vRef) / VEL_TC_S;
+  if (aDes >  params.trajAccMax) aDes =  params.trajAccMax;
+  if (aDes < -params.trajAccMax) aDes = -params.trajAccMax;
+  float da = aDes - s_aRef;
+  const float daMax = params.trajJerkMax * dt;
+  if (da >  daMax) da =  daMax;
+  if (da < -daMax) da = -daMax;
+  s_aRef += da;
+
+  float vPrev = s_vRef;
+  s_vRef += s_aRef * dt;
+  // No rebasar vDes (evita oscilar alrededor de la referencia)
+  if ((vPrev - vDes) * (s_vRef - vDes) < 0.0f) {
+    s_vRef = vDes;
+    s_aRef = 0.0f;
+  }
+
+  // Sentido según el signo de la referencia
+  EstadoPuerta want = s_estado;
+  if (s_vRef > 0.0f)      want = ABRIENDO;
+  else if (s_vRef < 0.0f) want = CERRANDO;
+  if (want != s_estado) {
+    s_estado = want;
+    setEstado(want);
+  }
+
+  motor_set_profile(100.0f * fabsf(s_vRef) / MOTOR_VEL_MAX_CPS);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+
+// =====================================================
+//   Planificador de trayectorias (goto a posición)
+// =====================================================
+// Genera en cada tick de motor una velocidad de referencia con aceleración
+// y jerk limitados (perfil en S) desde la posición actual hasta un objetivo
+// cualquiera entre 0 y hall_open_pulses. Antes de invertir el sentido frena
+// hasta 0. Sin memoria dinámica; requiere el Hall habilitado.
+
+// Arranca (o redirige) un movimiento hacia 'target' (cuentas del encoder).
+// Solo desde la tarea de control. false si el Hall está deshabilitado.
+bool traj_start(long target);
+
+// Cancela el movimiento en curso y deja la puerta DETENIDA
+void traj_cancel();
+
+bool traj_active();
+long traj_target();
+
+// Llamar cada MOTOR_TICK_MS, justo antes de motor_tick()
+void traj_tick(uint32_t nowMs);